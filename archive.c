@@ -0,0 +1,444 @@
+#include "archive.h"
+
+#include <string.h>
+
+#include "crc16.h"
+
+#define PAGE_DATA_END (ARCHIVE_PAGE_SIZE - ARCHIVE_PAGE_CRC_SIZE) /**< 记录区的结束偏移。 */
+
+static uint32_t le32_decode(uint8_t const *p_data)
+{
+    return (uint32_t)p_data[0] | ((uint32_t)p_data[1] << 8) | ((uint32_t)p_data[2] << 16) | ((uint32_t)p_data[3] << 24);
+}
+
+static void le32_encode(uint32_t value, uint8_t *p_data)
+{
+    p_data[0] = (uint8_t)value;
+    p_data[1] = (uint8_t)(value >> 8);
+    p_data[2] = (uint8_t)(value >> 16);
+    p_data[3] = (uint8_t)(value >> 24);
+}
+
+/**
+ * @brief 位置对应的flash地址。
+ */
+static uint32_t pos_to_addr(archive_t const *p_archive, uint32_t pos)
+{
+    uint32_t seq = pos / ARCHIVE_SECTOR_SIZE;
+
+    return (seq % p_archive->p_backend->sector_count) * ARCHIVE_SECTOR_SIZE + pos % ARCHIVE_SECTOR_SIZE;
+}
+
+/**
+ * @brief 页中第一条记录的偏移，扇区的第一页以扇区头开始。
+ */
+static uint16_t page_records_start(uint32_t page_pos)
+{
+    return (page_pos % ARCHIVE_SECTOR_SIZE == 0) ? ARCHIVE_SECTOR_HEADER_SIZE : 0;
+}
+
+static bool page_crc_check(uint8_t const *p_page)
+{
+    uint16_t crc = crc16_compute(p_page, PAGE_DATA_END, NULL);
+
+    return p_page[PAGE_DATA_END] == (uint8_t)crc && p_page[PAGE_DATA_END + 1] == (uint8_t)(crc >> 8);
+}
+
+static bool page_erased(uint8_t const *p_page)
+{
+    for (uint16_t i = 0; i < ARCHIVE_PAGE_SIZE; i++)
+    {
+        if (p_page[i] != 0xFF)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 开始填充fill_pos处的新页。
+ */
+static void page_begin(archive_t *p_archive)
+{
+    uint8_t *p_page = p_archive->pages[p_archive->fill];
+
+    memset(p_page, 0xFF, ARCHIVE_PAGE_SIZE);
+    p_archive->fill_len = page_records_start(p_archive->fill_pos);
+    if (p_archive->fill_len != 0)
+    {
+        le32_encode(ARCHIVE_MAGIC, &p_page[0]);
+        le32_encode(p_archive->fill_pos / ARCHIVE_SECTOR_SIZE, &p_page[4]);
+    }
+}
+
+static void write_fail(archive_t *p_archive)
+{
+    p_archive->writing = false;
+    p_archive->status.state = ARCHIVE_FAILED;
+}
+
+static void page_program(archive_t *p_archive)
+{
+    ret_code_t err_code;
+
+    p_archive->status.state = ARCHIVE_PROGRAMMING;
+    err_code = p_archive->p_backend->program(p_archive->p_backend->p_context, pos_to_addr(p_archive, p_archive->write_pos),
+                                             p_archive->pages[p_archive->fill ^ 1], ARCHIVE_PAGE_SIZE);
+    if (err_code != NRF_SUCCESS)
+    {
+        write_fail(p_archive);
+    }
+}
+
+/**
+ * @brief 写入write_pos处的页，扇区的第一页先擦除扇区，覆盖最早的数据。
+ */
+static void write_start(archive_t *p_archive)
+{
+    archive_backend_t const *p_backend = p_archive->p_backend;
+    uint32_t                 seq = p_archive->write_pos / ARCHIVE_SECTOR_SIZE;
+    ret_code_t               err_code;
+
+    if (p_archive->write_pos % ARCHIVE_SECTOR_SIZE != 0)
+    {
+        page_program(p_archive);
+        return;
+    }
+
+    if (seq >= p_backend->sector_count && p_archive->oldest_seq <= seq - p_backend->sector_count)
+    {
+        p_archive->oldest_seq = seq - p_backend->sector_count + 1;
+    }
+
+    p_archive->status.state = ARCHIVE_ERASING;
+    err_code = p_backend->erase(p_backend->p_context, pos_to_addr(p_archive, p_archive->write_pos));
+    if (err_code != NRF_SUCCESS)
+    {
+        write_fail(p_archive);
+    }
+}
+
+/**
+ * @brief 结束正在填充的页并开始写入，之后的记录填充另一个页缓冲区。
+ */
+static ret_code_t page_seal(archive_t *p_archive)
+{
+    uint8_t *p_page = p_archive->pages[p_archive->fill];
+    uint16_t crc;
+
+    if (p_archive->writing)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    crc = crc16_compute(p_page, PAGE_DATA_END, NULL);
+    p_page[PAGE_DATA_END] = (uint8_t)crc;
+    p_page[PAGE_DATA_END + 1] = (uint8_t)(crc >> 8);
+
+    p_archive->write_pos = p_archive->fill_pos;
+    p_archive->writing = true;
+    p_archive->fill ^= 1;
+    p_archive->fill_pos += ARCHIVE_PAGE_SIZE;
+    page_begin(p_archive);
+
+    write_start(p_archive);
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 找到最新的扇区和其中第一个空页，新记录从该页开始写入。
+ *
+ * @details 只读取扇区头和最新扇区中的页，不写入flash。
+ */
+ret_code_t archive_init(archive_t *p_archive, archive_backend_t const *p_backend)
+{
+    uint8_t    header[ARCHIVE_SECTOR_HEADER_SIZE];
+    uint32_t   newest_seq = 0;
+    uint32_t   oldest_seq = UINT32_MAX;
+    ret_code_t err_code;
+
+    if (p_backend->sector_count < 2)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    memset(p_archive, 0, sizeof(archive_t));
+    p_archive->p_backend = p_backend;
+
+    for (uint32_t i = 0; i < p_backend->sector_count; i++)
+    {
+        err_code = p_backend->read(p_backend->p_context, i * ARCHIVE_SECTOR_SIZE, header, sizeof(header));
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+
+        uint32_t seq = le32_decode(&header[4]);
+        if (le32_decode(&header[0]) != ARCHIVE_MAGIC || seq % p_backend->sector_count != i)
+        {
+            continue;
+        }
+        if (oldest_seq == UINT32_MAX || seq > newest_seq)
+        {
+            newest_seq = seq;
+        }
+        if (seq < oldest_seq)
+        {
+            oldest_seq = seq;
+        }
+    }
+
+    if (oldest_seq == UINT32_MAX)
+    {
+        // 空的flash，从第0个扇区开始。
+        p_archive->oldest_seq = 0;
+        p_archive->fill_pos = 0;
+    }
+    else
+    {
+        p_archive->oldest_seq = oldest_seq;
+        p_archive->fill_pos = (newest_seq + 1) * ARCHIVE_SECTOR_SIZE;
+
+        for (uint32_t pos = newest_seq * ARCHIVE_SECTOR_SIZE + ARCHIVE_PAGE_SIZE; pos < p_archive->fill_pos; pos += ARCHIVE_PAGE_SIZE)
+        {
+            err_code = p_backend->read(p_backend->p_context, pos_to_addr(p_archive, pos), p_archive->scratch, ARCHIVE_PAGE_SIZE);
+            if (err_code != NRF_SUCCESS)
+            {
+                return err_code;
+            }
+            if (page_erased(p_archive->scratch))
+            {
+                p_archive->fill_pos = pos;
+                break;
+            }
+        }
+    }
+
+    page_begin(p_archive);
+    p_archive->status.state = ARCHIVE_IDLE;
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 写入或擦除失败后重新挂载，从最新扇区中第一个空页继续写入，保留启动以来的统计。
+ *
+ * @details 写入失败的页校验不通过，读取时跳过；擦除失败的扇区没有有效的扇区头，下次使用时重新擦除。
+ *          页缓冲区中还没有写入的记录丢失。
+ *
+ * @retval NRF_ERROR_INVALID_STATE 存档没有失败。
+ */
+ret_code_t archive_remount(archive_t *p_archive)
+{
+    archive_backend_t const *p_backend = p_archive->p_backend;
+    archive_status_t         status = p_archive->status;
+    ret_code_t               err_code;
+
+    if (status.state != ARCHIVE_FAILED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    err_code = archive_init(p_archive, p_backend);
+    if (err_code != NRF_SUCCESS)
+    {
+        // 保持失败状态，之后可以再次重试。
+        p_archive->p_backend = p_backend;
+        p_archive->status = status;
+        return err_code;
+    }
+
+    status.state = p_archive->status.state;
+    p_archive->status = status;
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 追加一条记录。记录先放在RAM中，填满一页后才写入flash。
+ *
+ * @retval NRF_ERROR_NO_MEM 上一页还没有写完，记录被丢弃。
+ */
+ret_code_t archive_append(archive_t *p_archive, uint8_t type, void const *p_data, uint8_t len)
+{
+    uint8_t *p_record;
+
+    if (p_archive->status.state == ARCHIVE_UNMOUNTED || p_archive->status.state == ARCHIVE_FAILED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (type == ARCHIVE_TYPE_FREE || len > ARCHIVE_RECORD_MAX_LEN)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    if (p_archive->fill_len + ARCHIVE_RECORD_HEADER_SIZE + len > PAGE_DATA_END && page_seal(p_archive) != NRF_SUCCESS)
+    {
+        p_archive->status.dropped++;
+        return NRF_ERROR_NO_MEM;
+    }
+
+    p_record = &p_archive->pages[p_archive->fill][p_archive->fill_len];
+    p_record[0] = type;
+    p_record[1] = len;
+    memcpy(&p_record[ARCHIVE_RECORD_HEADER_SIZE], p_data, len);
+    p_archive->fill_len += ARCHIVE_RECORD_HEADER_SIZE + len;
+    p_archive->status.records++;
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 把未填满的页写入flash，剩余部分不再使用。用于长时间没有填满一页时，避免复位丢失记录。
+ */
+ret_code_t archive_flush(archive_t *p_archive)
+{
+    if (p_archive->status.state == ARCHIVE_UNMOUNTED || p_archive->status.state == ARCHIVE_FAILED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_archive->fill_len == page_records_start(p_archive->fill_pos))
+    {
+        return NRF_SUCCESS;
+    }
+
+    return page_seal(p_archive);
+}
+
+/**
+ * @brief 取得一页的内容，还没有写入flash的页直接使用RAM中的缓冲区。
+ *
+ * @param[out] pp_page 页的内容，校验失败或未写入时为NULL。
+ */
+static ret_code_t page_get(archive_t *p_archive, uint32_t page_pos, uint8_t const **pp_page)
+{
+    ret_code_t err_code;
+
+    if (page_pos == p_archive->fill_pos)
+    {
+        *pp_page = p_archive->pages[p_archive->fill];
+        return NRF_SUCCESS;
+    }
+    if (p_archive->writing && page_pos == p_archive->write_pos)
+    {
+        *pp_page = p_archive->pages[p_archive->fill ^ 1];
+        return NRF_SUCCESS;
+    }
+
+    err_code = p_archive->p_backend->read(p_archive->p_backend->p_context, pos_to_addr(p_archive, page_pos), p_archive->scratch,
+                                          ARCHIVE_PAGE_SIZE);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    *pp_page = page_crc_check(p_archive->scratch) ? p_archive->scratch : NULL;
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 从游标处读取完整的记录，格式与flash中相同：[类型][长度][数据...]。
+ *
+ * @param[inout] p_cursor 输入为读取的位置，早于最早的记录时从最早的记录开始；输出为下一次读取的位置。
+ * @param[out]   p_data   记录。
+ * @param[inout] p_len    输入为p_data的长度；输出为读取的长度，为0时没有更多记录。
+ *
+ * @retval NRF_ERROR_BUSY      正在写入flash，稍后再读。
+ * @retval NRF_ERROR_DATA_SIZE 下一条记录比p_data长，游标不变。
+ */
+ret_code_t archive_read(archive_t *p_archive, uint32_t *p_cursor, uint8_t *p_data, uint16_t *p_len)
+{
+    uint32_t   oldest = p_archive->oldest_seq * ARCHIVE_SECTOR_SIZE;
+    uint32_t   cursor = (*p_cursor > oldest) ? *p_cursor : oldest;
+    uint32_t   head = p_archive->fill_pos + p_archive->fill_len;
+    uint16_t   max_len = *p_len;
+    uint16_t   len = 0;
+    ret_code_t err_code = NRF_SUCCESS;
+
+    if (p_archive->status.state == ARCHIVE_UNMOUNTED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    while (cursor < head)
+    {
+        uint32_t       page_pos = cursor - cursor % ARCHIVE_PAGE_SIZE;
+        uint16_t       offset = page_records_start(page_pos);
+        uint8_t const *p_page;
+
+        err_code = page_get(p_archive, page_pos, &p_page);
+        if (err_code != NRF_SUCCESS)
+        {
+            break;
+        }
+
+        // 从页首开始遍历，游标不在记录边界上时从之后的第一条记录开始。
+        while (p_page != NULL && offset + ARCHIVE_RECORD_HEADER_SIZE <= PAGE_DATA_END && p_page[offset] != ARCHIVE_TYPE_FREE)
+        {
+            uint16_t record_len = ARCHIVE_RECORD_HEADER_SIZE + p_page[offset + 1];
+
+            if (offset + record_len > PAGE_DATA_END)
+            {
+                break;
+            }
+            if (page_pos + offset >= cursor)
+            {
+                if (len + record_len > max_len)
+                {
+                    *p_cursor = page_pos + offset;
+                    *p_len = len;
+                    return (len > 0) ? NRF_SUCCESS : NRF_ERROR_DATA_SIZE;
+                }
+                memcpy(&p_data[len], &p_page[offset], record_len);
+                len += record_len;
+            }
+            offset += record_len;
+        }
+
+        cursor = (page_pos == p_archive->fill_pos) ? head : page_pos + ARCHIVE_PAGE_SIZE;
+    }
+
+    *p_cursor = cursor;
+    *p_len = len;
+
+    // 已经读到记录时先返回，下一次读取再报告错误。
+    return (len > 0) ? NRF_SUCCESS : err_code;
+}
+
+/**
+ * @brief 后端完成擦除或写入后调用，擦除完成后接着写入该扇区的第一页。
+ */
+void archive_op_done(archive_t *p_archive, ret_code_t result)
+{
+    if (result != NRF_SUCCESS)
+    {
+        write_fail(p_archive);
+        return;
+    }
+
+    switch (p_archive->status.state)
+    {
+    case ARCHIVE_ERASING:
+        p_archive->status.erases++;
+        page_program(p_archive);
+        break;
+
+    case ARCHIVE_PROGRAMMING:
+        p_archive->status.pages++;
+        p_archive->writing = false;
+        p_archive->status.state = ARCHIVE_IDLE;
+        break;
+
+    default:
+        break;
+    }
+}
+
+void archive_status_get(archive_t const *p_archive, archive_status_t *p_status)
+{
+    *p_status = p_archive->status;
+    p_status->oldest = p_archive->oldest_seq * ARCHIVE_SECTOR_SIZE;
+    p_status->head = p_archive->fill_pos + p_archive->fill_len;
+}
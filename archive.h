@@ -0,0 +1,96 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+/**
+ * 外部NOR flash上只追加的日志存档，格式（小端序）由tools/archive_read.py读取：
+ *
+ * flash按4 KB扇区循环使用，写满后擦除最早的扇区，每个扇区的擦除次数相同。
+ * 每个扇区的第一页以扇区头开始：[magic:u32 "ARC1"][序号:u32]，序号每使用一个新扇区加1。
+ * 每页只写入一次，内容为一串记录：[类型:u8][长度:u8][数据...]，类型为0xFF表示之后没有记录。
+ * 记录不跨页，页的最后两个字节为前面内容的CRC16（CCITT），写入中断的页校验失败后跳过。
+ *
+ * 记录的位置（游标）= 扇区序号 * ARCHIVE_SECTOR_SIZE + 扇区内偏移，只增不减。
+ *
+ * 本文件不依赖SoftDevice和flash，通过archive_backend_t访问存储，可以配合archive_ram在主机上编译测试。
+ */
+
+#define ARCHIVE_MAGIC 0x31435241 /**< "ARC1" */
+#define ARCHIVE_PAGE_SIZE 256
+#define ARCHIVE_SECTOR_SIZE 4096
+#define ARCHIVE_SECTOR_HEADER_SIZE 8
+#define ARCHIVE_RECORD_HEADER_SIZE 2
+#define ARCHIVE_PAGE_CRC_SIZE 2
+#define ARCHIVE_RECORD_MAX_LEN 224 /**< 记录数据的最大长度，使一条记录总能放进最大MTU的一次BLE通知。 */
+#define ARCHIVE_TYPE_FREE 0xFF
+
+/**
+ * @brief 写入或擦除完成的回调，可以在中断中调用，也可以在操作函数返回前调用。
+ */
+typedef void (*archive_op_handler_t)(ret_code_t result);
+
+/**
+ * @brief 存储后端，地址为从0开始的字节偏移。
+ */
+typedef struct
+{
+    uint32_t sector_count; /**< 扇区数，至少为2。 */
+    void    *p_context;
+    ret_code_t (*read)(void *p_context, uint32_t addr, void *p_data, uint32_t len);            /**< 同步读取，写入或擦除进行中时返回NRF_ERROR_BUSY。 */
+    ret_code_t (*program)(void *p_context, uint32_t addr, void const *p_data, uint32_t len);   /**< 写入一页，完成后调用完成回调。 */
+    ret_code_t (*erase)(void *p_context, uint32_t addr);                                       /**< 擦除一个扇区，完成后调用完成回调。 */
+} archive_backend_t;
+
+/**
+ * @brief 存档的状态。
+ */
+typedef enum
+{
+    ARCHIVE_UNMOUNTED,   /**< 未初始化。 */
+    ARCHIVE_IDLE,        /**< 没有进行中的写入。 */
+    ARCHIVE_ERASING,     /**< 正在擦除下一个扇区。 */
+    ARCHIVE_PROGRAMMING, /**< 正在写入一页。 */
+    ARCHIVE_FAILED,      /**< 写入或擦除出错，停止写入，直到archive_remount。 */
+} archive_state_t;
+
+typedef struct
+{
+    uint8_t  state;   /**< @ref archive_state_t */
+    uint32_t oldest;  /**< 最早的记录的位置。 */
+    uint32_t head;    /**< 下一条记录的位置。 */
+    uint32_t records; /**< 启动以来追加的记录数。 */
+    uint32_t dropped; /**< 写入跟不上而丢弃的记录数。 */
+    uint32_t pages;   /**< 启动以来写入的页数。 */
+    uint32_t erases;  /**< 启动以来擦除的扇区数。 */
+} archive_status_t;
+
+/**
+ * @brief 存档的状态，调用者不应直接访问。
+ */
+typedef struct
+{
+    archive_backend_t const *p_backend;
+    uint8_t                  pages[2][ARCHIVE_PAGE_SIZE]; /**< 正在填充的页和正在写入的页。 */
+    uint8_t                  scratch[ARCHIVE_PAGE_SIZE];  /**< 读取flash中的页。 */
+    uint8_t                  fill;        /**< 正在填充的页缓冲区。 */
+    bool                     writing;     /**< 另一个页缓冲区正在写入。 */
+    uint16_t                 fill_len;    /**< 正在填充的页已使用的长度。 */
+    uint32_t                 fill_pos;    /**< 正在填充的页的位置。 */
+    uint32_t                 write_pos;   /**< 正在写入的页的位置。 */
+    uint32_t                 oldest_seq;  /**< 最早的有效扇区的序号。 */
+    archive_status_t         status;
+} archive_t;
+
+ret_code_t archive_init(archive_t *p_archive, archive_backend_t const *p_backend);
+ret_code_t archive_remount(archive_t *p_archive);
+ret_code_t archive_append(archive_t *p_archive, uint8_t type, void const *p_data, uint8_t len);
+ret_code_t archive_flush(archive_t *p_archive);
+ret_code_t archive_read(archive_t *p_archive, uint32_t *p_cursor, uint8_t *p_data, uint16_t *p_len);
+void       archive_op_done(archive_t *p_archive, ret_code_t result);
+void       archive_status_get(archive_t const *p_archive, archive_status_t *p_status);
+
+#endif
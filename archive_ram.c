@@ -0,0 +1,61 @@
+#include "archive_ram.h"
+
+#include <string.h>
+
+static ret_code_t ram_read(void *p_context, uint32_t addr, void *p_data, uint32_t len)
+{
+    archive_ram_t *p_ram = (archive_ram_t *)p_context;
+
+    memcpy(p_data, &p_ram->p_mem[addr], len);
+
+    return NRF_SUCCESS;
+}
+
+static ret_code_t ram_program(void *p_context, uint32_t addr, void const *p_data, uint32_t len)
+{
+    archive_ram_t *p_ram = (archive_ram_t *)p_context;
+    uint8_t const *p_src = (uint8_t const *)p_data;
+    ret_code_t     result = NRF_SUCCESS;
+
+    if (p_ram->fail_after > 0 && --p_ram->fail_after == 0)
+    {
+        len /= 2;
+        result = NRF_ERROR_INTERNAL;
+    }
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        p_ram->p_mem[addr + i] &= p_src[i];
+    }
+
+    p_ram->done_handler(result);
+
+    return NRF_SUCCESS;
+}
+
+static ret_code_t ram_erase(void *p_context, uint32_t addr)
+{
+    archive_ram_t *p_ram = (archive_ram_t *)p_context;
+
+    memset(&p_ram->p_mem[addr - addr % ARCHIVE_SECTOR_SIZE], 0xFF, ARCHIVE_SECTOR_SIZE);
+    p_ram->done_handler(NRF_SUCCESS);
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 初始化RAM后端。p_mem的内容保留，可以先载入一份flash镜像再挂载。
+ */
+void archive_ram_init(archive_ram_t *p_ram, archive_backend_t *p_backend, uint8_t *p_mem, uint32_t sector_count,
+                      archive_op_handler_t done_handler)
+{
+    p_ram->p_mem = p_mem;
+    p_ram->done_handler = done_handler;
+    p_ram->fail_after = 0;
+
+    p_backend->sector_count = sector_count;
+    p_backend->p_context = p_ram;
+    p_backend->read = ram_read;
+    p_backend->program = ram_program;
+    p_backend->erase = ram_erase;
+}
@@ -0,0 +1,23 @@
+#ifndef ARCHIVE_RAM_H
+#define ARCHIVE_RAM_H
+
+#include <stdint.h>
+
+#include "archive.h"
+
+/**
+ * @brief 在RAM中模拟NOR flash的存档后端，用于在主机上测试存档格式和恢复逻辑。
+ *
+ * @details 写入只能把1变为0，擦除把整个扇区置为0xFF，与NOR flash相同。操作在函数返回前完成并调用完成回调。
+ */
+typedef struct
+{
+    uint8_t             *p_mem;        /**< 长度为sector_count * ARCHIVE_SECTOR_SIZE。 */
+    archive_op_handler_t done_handler;
+    uint32_t             fail_after;   /**< 大于0时，第fail_after次写入只写一半并返回错误，模拟写入中断。 */
+} archive_ram_t;
+
+void archive_ram_init(archive_ram_t *p_ram, archive_backend_t *p_backend, uint8_t *p_mem, uint32_t sector_count,
+                      archive_op_handler_t done_handler);
+
+#endif
@@ -0,0 +1,358 @@
+#include "archive_spim.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "app_timer.h"
+#include "app_util.h"
+#include "boards.h"
+#include "nrf_delay.h"
+#include "nrf_log.h"
+#include "nrfx_spim.h"
+
+#define NOR_CMD_WRITE_ENABLE 0x06
+#define NOR_CMD_PAGE_PROGRAM 0x02
+#define NOR_CMD_SECTOR_ERASE 0x20
+#define NOR_CMD_READ 0x03
+#define NOR_CMD_READ_STATUS 0x05
+#define NOR_CMD_READ_ID 0x9F
+#define NOR_CMD_POWER_DOWN 0xB9
+#define NOR_CMD_RELEASE 0xAB
+
+#define NOR_STATUS_WIP 0x01
+
+#define NOR_CAPACITY_MIN 0x10 /**< JEDEC容量代码，64 KB。 */
+#define NOR_CAPACITY_MAX 0x18 /**< 16 MB，更大的容量需要4字节地址。 */
+
+/**
+ * @brief 写入和擦除的步骤，在SPIM和app_timer中断中推进。
+ */
+typedef enum
+{
+    STEP_IDLE,         /**< 没有进行中的写入或擦除，可以同步读取。 */
+    STEP_WRITE_ENABLE, /**< 发送写使能。 */
+    STEP_COMMAND,      /**< 发送页写入或扇区擦除命令。 */
+    STEP_STATUS,       /**< 查询状态寄存器，等待写入或擦除完成。 */
+    STEP_POWER_DOWN,   /**< 完成后进入深度睡眠。 */
+} step_t;
+
+APP_TIMER_DEF(m_poll_timer_id);
+
+static nrfx_spim_t const    m_spim = NRFX_SPIM_INSTANCE(ARCHIVE_SPIM_INSTANCE);
+static archive_op_handler_t m_done_handler;
+static uint8_t              m_tx[4 + ARCHIVE_SPIM_CHUNK];
+static uint8_t              m_rx[4 + ARCHIVE_SPIM_CHUNK];
+static volatile bool        m_xfer_done;
+static volatile uint8_t     m_step;
+static bool                 m_sleeping;
+static bool                 m_erase;     /**< 进行中的是擦除而不是写入。 */
+static uint32_t             m_addr;      /**< 下一块数据的地址。 */
+static uint8_t const       *m_p_data;    /**< 下一块数据。 */
+static uint32_t             m_remaining; /**< 还没有写入的长度。 */
+static uint8_t              m_chunk;     /**< 正在写入的长度。 */
+
+static void command_set(uint8_t cmd, uint32_t addr)
+{
+    m_tx[0] = cmd;
+    m_tx[1] = (uint8_t)(addr >> 16);
+    m_tx[2] = (uint8_t)(addr >> 8);
+    m_tx[3] = (uint8_t)addr;
+}
+
+static ret_code_t xfer_start(uint8_t tx_len, uint8_t rx_len)
+{
+    nrfx_spim_xfer_desc_t xfer = NRFX_SPIM_XFER_TRX(m_tx, tx_len, m_rx, rx_len);
+
+    return nrfx_spim_xfer(&m_spim, &xfer, 0);
+}
+
+/**
+ * @brief 在主循环中等待一次传输完成，最长一块数据约130 us。
+ */
+static ret_code_t xfer_wait(uint8_t tx_len, uint8_t rx_len)
+{
+    ret_code_t err_code;
+
+    m_xfer_done = false;
+    err_code = xfer_start(tx_len, rx_len);
+    VERIFY_SUCCESS(err_code);
+
+    while (!m_xfer_done)
+    {
+    }
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 退出深度睡眠，空闲时flash保持深度睡眠（约1 uA）。
+ */
+static ret_code_t wake(void)
+{
+    ret_code_t err_code;
+
+    if (!m_sleeping)
+    {
+        return NRF_SUCCESS;
+    }
+
+    m_tx[0] = NOR_CMD_RELEASE;
+    err_code = xfer_wait(1, 0);
+    VERIFY_SUCCESS(err_code);
+
+    nrf_delay_us(ARCHIVE_SPIM_RESUME_US);
+    m_sleeping = false;
+
+    return NRF_SUCCESS;
+}
+
+static ret_code_t power_down(void)
+{
+    m_tx[0] = NOR_CMD_POWER_DOWN;
+    m_sleeping = true;
+
+    return xfer_wait(1, 0);
+}
+
+static void op_finish(ret_code_t result)
+{
+    m_step = STEP_IDLE;
+    m_done_handler(result);
+}
+
+/**
+ * @brief 推进写入或擦除。写入按ARCHIVE_SPIM_CHUNK分块，每块都需要写使能并等待完成。
+ */
+static void step_next(void)
+{
+    ret_code_t err_code = NRF_SUCCESS;
+
+    switch (m_step)
+    {
+    case STEP_WRITE_ENABLE:
+        m_step = STEP_COMMAND;
+        if (m_erase)
+        {
+            command_set(NOR_CMD_SECTOR_ERASE, m_addr);
+            err_code = xfer_start(4, 0);
+        }
+        else
+        {
+            m_chunk = (uint8_t)MIN(m_remaining, ARCHIVE_SPIM_CHUNK);
+            command_set(NOR_CMD_PAGE_PROGRAM, m_addr);
+            memcpy(&m_tx[4], m_p_data, m_chunk);
+            err_code = xfer_start(4 + m_chunk, 0);
+        }
+        break;
+
+    case STEP_COMMAND:
+        m_step = STEP_STATUS;
+        if (!m_erase)
+        {
+            m_addr += m_chunk;
+            m_p_data += m_chunk;
+            m_remaining -= m_chunk;
+        }
+        err_code = app_timer_start(m_poll_timer_id, APP_TIMER_TICKS(m_erase ? ARCHIVE_SPIM_ERASE_POLL_MS : ARCHIVE_SPIM_PROGRAM_POLL_MS), NULL);
+        break;
+
+    case STEP_STATUS:
+        if (m_rx[1] & NOR_STATUS_WIP)
+        {
+            err_code = app_timer_start(m_poll_timer_id, APP_TIMER_TICKS(m_erase ? ARCHIVE_SPIM_ERASE_POLL_MS : ARCHIVE_SPIM_PROGRAM_POLL_MS), NULL);
+        }
+        else if (!m_erase && m_remaining > 0)
+        {
+            m_step = STEP_WRITE_ENABLE;
+            m_tx[0] = NOR_CMD_WRITE_ENABLE;
+            err_code = xfer_start(1, 0);
+        }
+        else
+        {
+            m_step = STEP_POWER_DOWN;
+            m_tx[0] = NOR_CMD_POWER_DOWN;
+            m_sleeping = true;
+            err_code = xfer_start(1, 0);
+        }
+        break;
+
+    case STEP_POWER_DOWN:
+        op_finish(NRF_SUCCESS);
+        return;
+
+    default:
+        return;
+    }
+
+    if (err_code != NRF_SUCCESS)
+    {
+        op_finish(err_code);
+    }
+}
+
+static void spim_evt_handler(nrfx_spim_evt_t const *p_event, void *p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    if (p_event->type != NRFX_SPIM_EVENT_DONE)
+    {
+        return;
+    }
+
+    if (m_step == STEP_IDLE)
+    {
+        m_xfer_done = true;
+    }
+    else
+    {
+        step_next();
+    }
+}
+
+/**
+ * @brief 查询状态寄存器，结果在spim_evt_handler中处理。
+ */
+static void poll_timeout_handler(void *p_context)
+{
+    ret_code_t err_code;
+
+    UNUSED_PARAMETER(p_context);
+
+    m_tx[0] = NOR_CMD_READ_STATUS;
+    err_code = xfer_start(1, 2);
+    if (err_code != NRF_SUCCESS)
+    {
+        op_finish(err_code);
+    }
+}
+
+static ret_code_t op_start(uint32_t addr, uint8_t const *p_data, uint32_t len, bool erase)
+{
+    ret_code_t err_code;
+
+    if (m_step != STEP_IDLE)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    err_code = wake();
+    VERIFY_SUCCESS(err_code);
+
+    m_addr = addr;
+    m_p_data = p_data;
+    m_remaining = len;
+    m_erase = erase;
+
+    m_step = STEP_WRITE_ENABLE;
+    m_tx[0] = NOR_CMD_WRITE_ENABLE;
+    err_code = xfer_start(1, 0);
+    if (err_code != NRF_SUCCESS)
+    {
+        m_step = STEP_IDLE;
+    }
+
+    return err_code;
+}
+
+static ret_code_t spim_program(void *p_context, uint32_t addr, void const *p_data, uint32_t len)
+{
+    UNUSED_PARAMETER(p_context);
+
+    return op_start(addr, (uint8_t const *)p_data, len, false);
+}
+
+static ret_code_t spim_erase(void *p_context, uint32_t addr)
+{
+    UNUSED_PARAMETER(p_context);
+
+    return op_start(addr, NULL, 0, true);
+}
+
+/**
+ * @brief 同步读取，每块约130 us，写入或擦除进行中时返回NRF_ERROR_BUSY。
+ */
+static ret_code_t spim_read(void *p_context, uint32_t addr, void *p_data, uint32_t len)
+{
+    uint8_t   *p_dst = (uint8_t *)p_data;
+    ret_code_t err_code;
+
+    UNUSED_PARAMETER(p_context);
+
+    if (m_step != STEP_IDLE)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    err_code = wake();
+    VERIFY_SUCCESS(err_code);
+
+    while (len > 0)
+    {
+        uint8_t chunk = (uint8_t)MIN(len, ARCHIVE_SPIM_CHUNK);
+
+        // 前4个字节在发送命令和地址时收到，没有意义。
+        command_set(NOR_CMD_READ, addr);
+        err_code = xfer_wait(4, 4 + chunk);
+        VERIFY_SUCCESS(err_code);
+        memcpy(p_dst, &m_rx[4], chunk);
+
+        addr += chunk;
+        p_dst += chunk;
+        len -= chunk;
+    }
+
+    return power_down();
+}
+
+/**
+ * @brief 初始化SPIM并读取JEDEC ID，按flash的容量设置扇区数。
+ *
+ * @retval NRF_ERROR_NOT_FOUND     没有应答。
+ * @retval NRF_ERROR_NOT_SUPPORTED 容量超出3字节地址的范围。
+ */
+ret_code_t archive_spim_init(archive_backend_t *p_backend, archive_op_handler_t done_handler)
+{
+    ret_code_t         err_code;
+    nrfx_spim_config_t config = NRFX_SPIM_DEFAULT_CONFIG;
+
+    m_done_handler = done_handler;
+
+    config.sck_pin = BOARD_ARCHIVE_SCK_PIN;
+    config.mosi_pin = BOARD_ARCHIVE_MOSI_PIN;
+    config.miso_pin = BOARD_ARCHIVE_MISO_PIN;
+    config.ss_pin = BOARD_ARCHIVE_CS_PIN;
+    config.frequency = NRF_SPIM_FREQ_8M;
+    err_code = nrfx_spim_init(&m_spim, &config, spim_evt_handler, NULL);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = app_timer_create(&m_poll_timer_id, APP_TIMER_MODE_SINGLE_SHOT, poll_timeout_handler);
+    VERIFY_SUCCESS(err_code);
+
+    // 上次运行可能让flash停在深度睡眠。
+    m_sleeping = true;
+    err_code = wake();
+    VERIFY_SUCCESS(err_code);
+
+    m_tx[0] = NOR_CMD_READ_ID;
+    err_code = xfer_wait(1, 4);
+    VERIFY_SUCCESS(err_code);
+
+    if (m_rx[1] == 0x00 || m_rx[1] == 0xFF)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    if (m_rx[3] < NOR_CAPACITY_MIN || m_rx[3] > NOR_CAPACITY_MAX)
+    {
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+
+    NRF_LOG_INFO("Archive flash 0x%02x%02x, %d KB.", m_rx[1], m_rx[2], (1UL << m_rx[3]) / 1024);
+
+    p_backend->sector_count = (1UL << m_rx[3]) / ARCHIVE_SECTOR_SIZE;
+    p_backend->p_context = NULL;
+    p_backend->read = spim_read;
+    p_backend->program = spim_program;
+    p_backend->erase = spim_erase;
+
+    return power_down();
+}
@@ -0,0 +1,14 @@
+#ifndef ARCHIVE_SPIM_H
+#define ARCHIVE_SPIM_H
+
+#include "archive.h"
+
+#define ARCHIVE_SPIM_INSTANCE 2        /**< SPIM2，不与TWIM共用外设。 */
+#define ARCHIVE_SPIM_CHUNK 128         /**< 每次传输的数据长度，nRF52832的EasyDMA单次最多255字节。 */
+#define ARCHIVE_SPIM_PROGRAM_POLL_MS 1 /**< 写入一页时查询状态的间隔，典型写入时间0.7 ms。 */
+#define ARCHIVE_SPIM_ERASE_POLL_MS 10  /**< 擦除扇区时查询状态的间隔，典型擦除时间45 ms。 */
+#define ARCHIVE_SPIM_RESUME_US 30      /**< 退出深度睡眠后到可以接收命令的时间（tRES1）。 */
+
+ret_code_t archive_spim_init(archive_backend_t *p_backend, archive_op_handler_t done_handler);
+
+#endif
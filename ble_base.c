@@ -5,7 +5,6 @@
 #include "nrf_power.h"
 #include "nrf_pwr_mgmt.h"
 
-#include "app_scheduler.h"
 #include "nrf_sdh.h"
 #include "nrf_sdh_ble.h"
 #include "nrf_sdh_soc.h"
@@ -17,6 +16,7 @@
 
 #include "nrf_log.h"
 
+#include "app_timer.h"
 #include "ble_advdata.h"
 #include "ble_advertising.h"
 #include "ble_conn_params.h"
@@ -28,18 +28,33 @@
 #include "utils.h"
 
 #include "ble_lbs.h"
-#include "nrf_gpio.h"
-#include "nrf_delay.h"
-#include "boards.h"
+#include "ble_sws.h"
+#include "command.h"
+#include "channel.h"
+#include "metrics.h"
+#include "phy_policy.h"
+#include "stack_monitor.h"
+#include "tx_power.h"
 
 NRF_BLE_QWR_DEF(m_qwr);                                                                     /**< Context for the Queued Write module.*/
 NRF_BLE_GATT_DEF(m_gatt);                                                                   /**< GATT module instance. */
 BLE_ADVERTISING_DEF(m_advertising);                                                         /**< Advertising module instance. */
 NRF_BLE_GQ_DEF(m_ble_gatt_queue, NRF_SDH_BLE_PERIPHERAL_LINK_COUNT, NRF_BLE_GQ_QUEUE_SIZE); /**< BLE GATT Queue instance. */
 BLE_LBS_DEF(m_lbs);                                                                         /**< LED Button Service instance. */
+BLE_SWS_DEF(m_sws);                                                                         /**< Switch Service instance. */
 
 static ble_gap_addr_t p_addr;
-static uint16_t com_current_ble_connection_handle; /**< Handle of the current connection. */
+static uint16_t com_current_ble_connection_handle = BLE_CONN_HANDLE_INVALID; /**< Handle of the current connection. */
+static ble_base_link_info_t m_link_info;                                      /**< 当前连接协商后的链路参数。 */
+
+static ble_advdata_manuf_data_t m_manuf_data;     /**< 广播中的厂商数据：设备地址或中继帧，Coded PHY时后接应用数据。 */
+static ble_advdata_manuf_data_t m_rsp_manuf_data; /**< 扫描响应中的厂商数据：应用数据。 */
+static uint8_t                  m_manuf_payload[BLE_BASE_ADV_RELAY_MAX + BLE_BASE_ADV_APP_DATA_MAX];
+static uint8_t                  m_app_data[BLE_BASE_ADV_APP_DATA_MAX];
+static uint8_t                  m_app_data_len;
+static uint8_t                  m_relay_frame[BLE_BASE_ADV_RELAY_MAX];
+static uint8_t                  m_relay_len;
+static int8_t                   m_tx_power_level;
 
 /**
  * @brief 处理BLE事件的回调函数。
@@ -55,33 +70,55 @@ static void ble_evt_handler(ble_evt_t const *p_ble_evt, void *p_context)
     {
     case BLE_GAP_EVT_CONNECTED:
         NRF_LOG_INFO("Connected.");
+        metrics_inc(METRIC_CONNECTS);
 
         com_current_ble_connection_handle = p_ble_evt->evt.gap_evt.conn_handle;
         err_code = nrf_ble_qwr_conn_handle_assign(&m_qwr, com_current_ble_connection_handle);
         APP_ERROR_CHECK(err_code);
+
+        m_link_info = (ble_base_link_info_t){
+            .att_mtu = BLE_GATT_ATT_MTU_DEFAULT,
+            .max_tx_octets = BLE_GAP_DATA_LENGTH_DEFAULT,
+            .max_rx_octets = BLE_GAP_DATA_LENGTH_DEFAULT,
+            .tx_phy = BLE_GAP_PHY_1MBPS,
+            .rx_phy = BLE_GAP_PHY_1MBPS,
+            .conn_interval = p_ble_evt->evt.gap_evt.params.connected.conn_params.max_conn_interval,
+            .peer_id = uint16_decode(p_ble_evt->evt.gap_evt.params.connected.peer_addr.addr),
+        };
         break;
 
     case BLE_GAP_EVT_DISCONNECTED:
         NRF_LOG_INFO("Disconnected.");
         com_current_ble_connection_handle = BLE_CONN_HANDLE_INVALID;
+        metrics_inc(METRIC_DISCONNECTS);
+        if (p_ble_evt->evt.gap_evt.params.disconnected.reason == BLE_HCI_CONNECTION_TIMEOUT)
+        {
+            metrics_inc(METRIC_LINK_LOSSES);
+        }
 
         break; // BLE_GAP_EVT_DISCONNECTED
 
-    case BLE_GAP_EVT_PHY_UPDATE_REQUEST:
-    {
-        NRF_LOG_DEBUG("PHY update request.");
-        ble_gap_phys_t const phys = {
-            .rx_phys = BLE_GAP_PHY_AUTO,
-            .tx_phys = BLE_GAP_PHY_AUTO,
-        };
-        err_code = sd_ble_gap_phy_update(p_ble_evt->evt.gap_evt.conn_handle, &phys);
-        APP_ERROR_CHECK(err_code);
-    }
-    break;
+    case BLE_GAP_EVT_PHY_UPDATE:
+        m_link_info.tx_phy = p_ble_evt->evt.gap_evt.params.phy_update.tx_phy;
+        m_link_info.rx_phy = p_ble_evt->evt.gap_evt.params.phy_update.rx_phy;
+        NRF_LOG_INFO("PHY updated, status %d, tx %d, rx %d.", p_ble_evt->evt.gap_evt.params.phy_update.status, m_link_info.tx_phy, m_link_info.rx_phy);
+        break;
+
+    case BLE_GAP_EVT_DATA_LENGTH_UPDATE:
+        m_link_info.max_tx_octets = p_ble_evt->evt.gap_evt.params.data_length_update.effective_params.max_tx_octets;
+        m_link_info.max_rx_octets = p_ble_evt->evt.gap_evt.params.data_length_update.effective_params.max_rx_octets;
+        NRF_LOG_INFO("Data length updated, tx %d, rx %d.", m_link_info.max_tx_octets, m_link_info.max_rx_octets);
+        break;
+
+    case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+        m_link_info.conn_interval = p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params.max_conn_interval;
+        NRF_LOG_INFO("Connection interval %d (1.25 ms).", m_link_info.conn_interval);
+        break;
 
     case BLE_GATTC_EVT_TIMEOUT:
         // Disconnect on GATT Client timeout event.
         NRF_LOG_DEBUG("GATT Client Timeout.");
+        metrics_inc(METRIC_GATTC_TIMEOUTS);
         com_current_ble_connection_handle = BLE_CONN_HANDLE_INVALID;
         err_code = sd_ble_gap_disconnect(p_ble_evt->evt.gattc_evt.conn_handle, BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
         APP_ERROR_CHECK(err_code);
@@ -90,6 +127,7 @@ static void ble_evt_handler(ble_evt_t const *p_ble_evt, void *p_context)
     case BLE_GATTS_EVT_TIMEOUT:
         // Disconnect on GATT Server timeout event.
         NRF_LOG_DEBUG("GATT Server Timeout.");
+        metrics_inc(METRIC_GATTS_TIMEOUTS);
         err_code = sd_ble_gap_disconnect(p_ble_evt->evt.gatts_evt.conn_handle, BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
         APP_ERROR_CHECK(err_code);
         break;
@@ -122,6 +160,12 @@ static void ble_stack_init(void)
     err_code = nrf_sdh_ble_enable(&ram_start);
     APP_ERROR_CHECK(err_code);
 
+    // 开启连接事件扩展，有数据时在连接间隔内连续收发，配合较大的数据长度提高吞吐量。
+    ble_opt_t opt = {0};
+    opt.common_opt.conn_evt_ext.enable = 1;
+    err_code = sd_ble_opt_set(BLE_COMMON_OPT_CONN_EVT_EXT, &opt);
+    APP_ERROR_CHECK(err_code);
+
     // Register a handler for BLE events.
     NRF_SDH_BLE_OBSERVER(m_ble_observer, APP_BLE_OBSERVER_PRIO, ble_evt_handler, NULL);
 }
@@ -145,10 +189,12 @@ static void on_adv_evt(ble_adv_evt_t ble_adv_evt)
 
     case BLE_ADV_EVT_FAST:
         NRF_LOG_INFO("Fast advertising");
+        metrics_inc(METRIC_ADV_STARTS);
         break;
 
     case BLE_ADV_EVT_SLOW:
         NRF_LOG_INFO("Slow advertising");
+        metrics_inc(METRIC_ADV_STARTS);
         break;
 
     case BLE_ADV_EVT_IDLE:
@@ -169,35 +215,72 @@ void on_advertising_error(uint32_t nrf_error)
 }
 
 /**
- * @brief 初始化广播功能。
+ * @brief 填写广播数据和扫描响应。
+ *
+ * @details 应用数据（分组命令的确认）放在扫描响应的厂商数据中。Coded PHY的扩展广播不能同时
+ *          可连接和可扫描，应用数据接在广播数据中设备地址的后面。
+ *          有中继帧时厂商数据中用中继帧代替设备地址，并去掉外观和发射功率，使其放得进31字节，
+ *          设备名称被截短。
  */
-static void advertising_init(void)
+static void advdata_fill(ble_advdata_t *p_advdata, ble_advdata_t *p_srdata)
 {
-    ret_code_t err_code;
-
-    // static int8_t tx_power_level = 4;
+    uint8_t len;
 
-    // err_code = sd_ble_gap_tx_power_set(BLE_GAP_TX_POWER_ROLE_ADV, 0, tx_power_level);
-    // APP_ERROR_CHECK(err_code);
+    memset(p_advdata, 0, sizeof(ble_advdata_t));
+    memset(p_srdata, 0, sizeof(ble_advdata_t));
 
-    ble_advdata_manuf_data_t manuf_specific_data;
+    m_tx_power_level = tx_power_adv_get();
+    if (m_relay_len > 0)
+    {
+        memcpy(m_manuf_payload, m_relay_frame, m_relay_len);
+        len = m_relay_len;
+    }
+    else
+    {
+        memcpy(m_manuf_payload, p_addr.addr, BLE_GAP_ADDR_LEN);
+        len = BLE_GAP_ADDR_LEN;
+        p_advdata->include_appearance = true;
+        p_advdata->p_tx_power_level = &m_tx_power_level; // 发送功率
+    }
 
     // Company id，Nordic id is: 0x0059
-    manuf_specific_data.company_identifier = 0x0059;
-    manuf_specific_data.data.p_data = p_addr.addr;
-    manuf_specific_data.data.size = sizeof(p_addr.addr);
+    m_manuf_data.company_identifier = 0x0059;
+    m_manuf_data.data.p_data = m_manuf_payload;
+    m_manuf_data.data.size = len;
+
+    p_advdata->name_type = BLE_ADVDATA_FULL_NAME;
+    p_advdata->flags = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
+    p_advdata->uuids_complete.uuid_cnt = 0;
+    p_advdata->uuids_complete.p_uuids = NULL;
+    p_advdata->p_manuf_specific_data = &m_manuf_data;
+
+    if (m_app_data_len == 0)
+    {
+        return;
+    }
+    memcpy(&m_manuf_payload[len], m_app_data, m_app_data_len);
+#if PHY_POLICY_CODED_ENABLED
+    m_manuf_data.data.size += m_app_data_len;
+#else
+    m_rsp_manuf_data.company_identifier = 0x0059;
+    m_rsp_manuf_data.data.p_data = &m_manuf_payload[len];
+    m_rsp_manuf_data.data.size = m_app_data_len;
+    p_srdata->p_manuf_specific_data = &m_rsp_manuf_data;
+#endif
+}
+
+/**
+ * @brief 初始化广播功能。
+ */
+static void advertising_init(void)
+{
+    ret_code_t err_code;
 
     ble_advertising_init_t init;
 
     memset(&init, 0, sizeof(init));
 
-    init.advdata.name_type = BLE_ADVDATA_FULL_NAME;
-    init.advdata.include_appearance = true;
-    init.advdata.flags = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
-    init.advdata.uuids_complete.uuid_cnt = 0;
-    init.advdata.uuids_complete.p_uuids = NULL;
-    init.advdata.p_manuf_specific_data = &manuf_specific_data;
-    // init.advdata.p_tx_power_level        = &tx_power_level;  // 发送功率
+    advdata_fill(&init.advdata, &init.srdata);
 
     init.config.ble_adv_fast_enabled = true;
     init.config.ble_adv_fast_interval = APP_ADV_FAST_INTERVAL;
@@ -205,6 +288,12 @@ static void advertising_init(void)
     init.config.ble_adv_slow_enabled = true;
     init.config.ble_adv_slow_interval = APP_ADV_SLOW_INTERVAL;
     init.config.ble_adv_slow_timeout = APP_ADV_SLOW_DURATION;
+#if PHY_POLICY_CODED_ENABLED
+    // 远距离广播，只有支持Coded PHY的主机能发现。
+    init.config.ble_adv_extended_enabled = true;
+    init.config.ble_adv_primary_phy = BLE_GAP_PHY_CODED;
+    init.config.ble_adv_secondary_phy = BLE_GAP_PHY_CODED;
+#endif
 
     init.evt_handler = on_adv_evt;
     init.error_handler = on_advertising_error;
@@ -213,6 +302,27 @@ static void advertising_init(void)
     APP_ERROR_CHECK(err_code);
 
     ble_advertising_conn_cfg_tag_set(&m_advertising, APP_BLE_CONN_CFG_TAG);
+
+    // 广播集在ble_advertising_init中创建，之后才能设置发射功率。
+    err_code = tx_power_adv_init(m_advertising.adv_handle);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**
+ * @brief 把一个字节按%X格式写入缓冲区（大写，不补0），返回写入的字符数。
+ */
+static uint8_t hex_format(uint8_t value, char *p_str)
+{
+    static char const digits[] = "0123456789ABCDEF";
+    uint8_t           len = 0;
+
+    if (value >= 0x10)
+    {
+        p_str[len++] = digits[value >> 4];
+    }
+    p_str[len++] = digits[value & 0x0F];
+
+    return len;
 }
 
 /**
@@ -232,10 +342,15 @@ static void gap_params_init(void)
 
     BLE_GAP_CONN_SEC_MODE_SET_OPEN(&sec_mode);
 
-    char device_name[12];
+    char    device_name[12] = "BLE_";
+    uint8_t name_len = 4;
 
-    sprintf(device_name, "BLE_%X%X%X%X", p_addr.addr[5], p_addr.addr[4], p_addr.addr[3], p_addr.addr[2]);
-    err_code = sd_ble_gap_device_name_set(&sec_mode, (const uint8_t *)device_name, strlen(device_name));
+    // 与"BLE_%X%X%X%X"相同（每字节不补0），不使用sprintf以免链接printf。
+    for (int8_t i = 5; i >= 2; i--)
+    {
+        name_len += hex_format(p_addr.addr[i], &device_name[name_len]);
+    }
+    err_code = sd_ble_gap_device_name_set(&sec_mode, (const uint8_t *)device_name, name_len);
     APP_ERROR_CHECK(err_code);
 
     memset(&gap_conn_params, 0, sizeof(gap_conn_params));
@@ -249,24 +364,40 @@ static void gap_params_init(void)
     APP_ERROR_CHECK(err_code);
 }
 
+/**
+ * @brief 处理gatt模块事件，记录协商后的MTU。
+ */
+static void gatt_evt_handler(nrf_ble_gatt_t *p_gatt, nrf_ble_gatt_evt_t const *p_evt)
+{
+    if (p_evt->evt_id == NRF_BLE_GATT_EVT_ATT_MTU_UPDATED)
+    {
+        m_link_info.att_mtu = p_evt->params.att_mtu_effective;
+        NRF_LOG_INFO("ATT MTU updated to %d.", m_link_info.att_mtu);
+    }
+}
+
 /**
  * @brief 初始化gatt模块的函数。
  */
 static void gatt_init(void)
 {
-    ret_code_t err_code = nrf_ble_gatt_init(&m_gatt, NULL);
+    ret_code_t err_code = nrf_ble_gatt_init(&m_gatt, gatt_evt_handler);
     APP_ERROR_CHECK(err_code);
 
     err_code = nrf_ble_gatt_att_mtu_periph_set(&m_gatt, NRF_SDH_BLE_GATT_MAX_MTU_SIZE);
     APP_ERROR_CHECK(err_code);
+
+    // 连接建立后由gatt模块主动发起数据长度协商。
+    err_code = nrf_ble_gatt_data_length_set(&m_gatt, BLE_CONN_HANDLE_INVALID, NRF_SDH_BLE_GAP_DATA_LENGTH);
+    APP_ERROR_CHECK(err_code);
 }
 
 /**
- * @brief 开启广播的函数。
+ * @brief 开始广播，先快速广播APP_ADV_FAST_DURATION，之后转为慢速广播。
  */
 ret_code_t advertising_start()
 {
-    return ble_advertising_start(&m_advertising, BLE_ADV_MODE_SLOW);
+    return ble_advertising_start(&m_advertising, BLE_ADV_MODE_FAST);
 }
 
 ret_code_t advertising_stop()
@@ -274,6 +405,135 @@ ret_code_t advertising_stop()
     return sd_ble_gap_adv_stop(m_advertising.adv_handle);
 }
 
+/**
+ * @brief 设置广播中的应用数据，长度为0时去掉。广播进行中时立即更新。
+ */
+ret_code_t ble_base_adv_app_data_set(uint8_t const *p_data, uint8_t len)
+{
+    if (len > BLE_BASE_ADV_APP_DATA_MAX)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    memcpy(m_app_data, p_data, len);
+    m_app_data_len = len;
+
+    return ble_base_adv_data_refresh();
+}
+
+/**
+ * @brief 重新生成广播数据，发射功率等字段变化后调用。
+ */
+ret_code_t ble_base_adv_data_refresh(void)
+{
+    ble_advdata_t advdata;
+    ble_advdata_t srdata;
+
+    advdata_fill(&advdata, &srdata);
+
+    return ble_advertising_advdata_update(&m_advertising, &advdata, &srdata);
+}
+
+/**
+ * @brief 在广播中发送一个中继帧，长度为0时恢复设备地址。
+ *
+ * @details 从快速广播重新开始，使附近扫描中的开关尽快收到。连接时不广播，返回NRF_ERROR_INVALID_STATE，
+ *          由调用者在断开后重新设置。
+ */
+ret_code_t ble_base_adv_relay_set(uint8_t const *p_frame, uint8_t len)
+{
+    ret_code_t err_code;
+
+    if (len > BLE_BASE_ADV_RELAY_MAX)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    if (len > 0 && com_current_ble_connection_handle != BLE_CONN_HANDLE_INVALID)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    memcpy(m_relay_frame, p_frame, len);
+    m_relay_len = len;
+
+    err_code = ble_base_adv_data_refresh();
+    VERIFY_SUCCESS(err_code);
+
+    if (len == 0)
+    {
+        return NRF_SUCCESS;
+    }
+
+    (void)sd_ble_gap_adv_stop(m_advertising.adv_handle);
+    return ble_advertising_start(&m_advertising, BLE_ADV_MODE_FAST);
+}
+
+/**
+ * @brief 开关ID，设备地址的低32位。
+ */
+uint32_t ble_base_switch_id_get(void)
+{
+    return uint32_decode(p_addr.addr);
+}
+
+/**
+ * @brief 通过Switch Service向当前连接发送一条事件通知。
+ *
+ * @retval NRF_ERROR_INVALID_STATE 当前没有连接。
+ */
+ret_code_t ble_base_evt_send(uint8_t const *p_data, uint16_t len)
+{
+    if (com_current_ble_connection_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    ret_code_t err_code = ble_sws_evt_send(com_current_ble_connection_handle, &m_sws, p_data, len);
+    if (err_code == NRF_ERROR_RESOURCES)
+    {
+        phy_policy_tx_stall();
+    }
+    if (err_code != NRF_SUCCESS)
+    {
+        metrics_inc(METRIC_EVT_SEND_FAILED);
+    }
+
+    return err_code;
+}
+
+/**
+ * @brief 通过Switch Service的日志特征值发送一段日志。
+ *
+ * @retval NRF_ERROR_INVALID_STATE 当前没有连接或主机没有开启日志通知。
+ */
+ret_code_t ble_base_log_send(uint8_t const *p_data, uint16_t len)
+{
+    if (com_current_ble_connection_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    return ble_sws_log_send(com_current_ble_connection_handle, &m_sws, p_data, len);
+}
+
+/**
+ * @brief 读取当前连接协商后的链路参数。
+ *
+ * @retval NRF_ERROR_INVALID_STATE 当前没有连接。
+ */
+ret_code_t ble_base_link_info_get(ble_base_link_info_t *p_info)
+{
+    if (com_current_ble_connection_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    *p_info = m_link_info;
+
+    return NRF_SUCCESS;
+}
+
 /**
  * @brief 处理连接参数错误的回调函数。
  *
@@ -319,42 +579,60 @@ static void advertising_config_get(ble_adv_modes_config_t *p_config)
     p_config->ble_adv_fast_timeout = APP_ADV_DURATION;
 }
 
-static void scheduler_controller(void *p_event_data, uint16_t event_size)
+/**@brief Function for handling write events to the LED characteristic.
+ *
+ * @details 兼容旧的单字节协议：低4位为动作（1短按，2长按），高4位为通道编号。
+ *
+ * @param[in] p_lbs     Instance of LED Button Service to which the write applies.
+ * @param[in] led_state Written/desired state of the LED.
+ */
+static void led_write_handler(uint16_t conn_handle, ble_lbs_t *p_lbs, uint8_t state)
 {
-    UNUSED_PARAMETER(event_size);
+    UNUSED_PARAMETER(p_lbs);
 
-    uint8_t state = *(uint8_t *)p_event_data;
+    uint16_t duration_ms;
 
-    switch (state)
+    switch (state & 0x0F)
     {
     case 1: // 短按
-        nrf_gpio_cfg(BOADER_CONTROL_PIN, NRF_GPIO_PIN_DIR_OUTPUT, NRF_GPIO_PIN_INPUT_DISCONNECT, NRF_GPIO_PIN_PULLDOWN, NRF_GPIO_PIN_S0S1, NRF_GPIO_PIN_NOSENSE);
-        nrf_delay_ms(600);
-        nrf_gpio_cfg(BOADER_CONTROL_PIN, NRF_GPIO_PIN_DIR_INPUT, NRF_GPIO_PIN_INPUT_DISCONNECT, NRF_GPIO_PIN_NOPULL, NRF_GPIO_PIN_S0S1, NRF_GPIO_PIN_NOSENSE);
-
+        duration_ms = CHANNEL_SHORT_PRESS_MS;
         break;
 
     case 2: // 长按
-        nrf_gpio_cfg(BOADER_CONTROL_PIN, NRF_GPIO_PIN_DIR_OUTPUT, NRF_GPIO_PIN_INPUT_DISCONNECT, NRF_GPIO_PIN_PULLDOWN, NRF_GPIO_PIN_S0S1, NRF_GPIO_PIN_NOSENSE);
-        nrf_delay_ms(4000);
-        nrf_gpio_cfg(BOADER_CONTROL_PIN, NRF_GPIO_PIN_DIR_INPUT, NRF_GPIO_PIN_INPUT_DISCONNECT, NRF_GPIO_PIN_NOPULL, NRF_GPIO_PIN_S0S1, NRF_GPIO_PIN_NOSENSE);
+        duration_ms = CHANNEL_LONG_PRESS_MS;
         break;
 
     default:
-        break;
+        return;
     }
+
+    uint8_t cmd[4] = {CMD_OP_PULSE, state >> 4};
+    uint16_encode(duration_ms, &cmd[2]);
+
+    LOG_ERROR("Submit command", command_submit(conn_handle, cmd, sizeof(cmd)));
 }
 
-/**@brief Function for handling write events to the LED characteristic.
- *
- * @param[in] p_lbs     Instance of LED Button Service to which the write applies.
- * @param[in] led_state Written/desired state of the LED.
+/**
+ * @brief 处理Switch Service命令写入的回调函数。
  */
-static void led_write_handler(uint16_t conn_handle, ble_lbs_t *p_lbs, uint8_t state)
+static void sws_cmd_handler(uint16_t conn_handle, ble_sws_t *p_sws, uint8_t const *p_data, uint16_t len)
 {
-    UNUSED_PARAMETER(conn_handle);
+    UNUSED_PARAMETER(p_sws);
 
-    app_sched_event_put(&state, sizeof(state), scheduler_controller);
+    LOG_ERROR("Submit command", command_submit(conn_handle, p_data, len));
+}
+
+/**
+ * @brief 读取指标快照的回调函数，先更新只在读取时计算的指标。
+ */
+static uint16_t metrics_read_handler(uint8_t *p_data, uint16_t max_len)
+{
+    (void)stack_monitor_update();
+#if APP_TIMER_WITH_PROFILER
+    metrics_gauge_max(METRIC_TIMER_QUEUE_HIGH_WATER, app_timer_op_queue_utilization_get());
+#endif
+
+    return metrics_snapshot(p_data, max_len);
 }
 
 /**
@@ -389,6 +667,15 @@ static void services_init(void)
 
     err_code = ble_lbs_init(&m_lbs, &init);
     APP_ERROR_CHECK(err_code);
+
+    ble_sws_init_t sws_init = {0};
+
+    // Initialize Switch Service.
+    sws_init.cmd_handler = sws_cmd_handler;
+    sws_init.metrics_handler = metrics_read_handler;
+
+    err_code = ble_sws_init(&m_sws, &sws_init);
+    APP_ERROR_CHECK(err_code);
 }
 
 ret_code_t ble_base_init()
@@ -6,6 +6,8 @@
 #define APP_BLE_OBSERVER_PRIO 3     /**< Application's BLE observer priority. You shouldn't need to modify this value. */
 #define APP_BLE_CONN_CFG_TAG 1      /**< A tag identifying the SoftDevice BLE configuration. */
 #define MANUFACTURER_NAME "ECO_NRF" /**< Manufacturer. Will be passed to Device Information Service. */
+#define BLE_BASE_ADV_APP_DATA_MAX 20 /**< 广播中应用数据的最大长度（字节）。 */
+#define BLE_BASE_ADV_RELAY_MAX 16    /**< 广播中中继帧的最大长度（字节）。 */
 
 #define SLAVE_LATENCY 0                                  /**< Slave latency. */
 #define CONN_SUP_TIMEOUT MSEC_TO_UNITS(4000, UNIT_10_MS) /**< Connection supervisory timeout (4 seconds). */
@@ -27,9 +29,30 @@
 #define NEXT_CONN_PARAMS_UPDATE_DELAY APP_TIMER_TICKS(30000) /**< Time between each call to sd_ble_gap_conn_param_update after the first call (30 seconds). */
 #define MAX_CONN_PARAMS_UPDATE_COUNT 3                       /**< Number of attempts before giving up the connection parameter negotiation. */
 
+/**
+ * @brief 当前连接协商后的链路参数。
+ */
+typedef struct
+{
+    uint16_t att_mtu;       /**< 有效ATT MTU。 */
+    uint16_t max_tx_octets; /**< 链路层发送的最大载荷（字节）。 */
+    uint16_t max_rx_octets; /**< 链路层接收的最大载荷（字节）。 */
+    uint8_t  tx_phy;        /**< BLE_GAP_PHY_1MBPS或BLE_GAP_PHY_2MBPS。 */
+    uint8_t  rx_phy;
+    uint16_t conn_interval; /**< 连接间隔（1.25ms）。 */
+    uint16_t peer_id;       /**< 对端地址的低16位，用于在日志中区分主机。 */
+} ble_base_link_info_t;
+
 ret_code_t advertising_start();
 ret_code_t advertising_stop();
 void       disconnect(uint16_t conn_handle, void* p_context);
+ret_code_t ble_base_evt_send(uint8_t const* p_data, uint16_t len);
+ret_code_t ble_base_log_send(uint8_t const* p_data, uint16_t len);
+ret_code_t ble_base_link_info_get(ble_base_link_info_t* p_info);
+ret_code_t ble_base_adv_app_data_set(uint8_t const* p_data, uint8_t len);
+ret_code_t ble_base_adv_data_refresh(void);
+ret_code_t ble_base_adv_relay_set(uint8_t const* p_frame, uint8_t len);
+uint32_t   ble_base_switch_id_get(void);
 ret_code_t ble_base_init();
 
 #endif
\ No newline at end of file
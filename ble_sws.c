@@ -0,0 +1,194 @@
+#include "ble_sws.h"
+
+#include <string.h>
+
+#include "ble_srv_common.h"
+#include "sdk_common.h"
+
+/**
+ * @brief 处理写事件。
+ */
+static void on_write(ble_sws_t *p_sws, ble_evt_t const *p_ble_evt)
+{
+    ble_gatts_evt_write_t const *p_evt_write = &p_ble_evt->evt.gatts_evt.params.write;
+
+    if ((p_evt_write->handle == p_sws->cmd_char_handles.value_handle) && (p_evt_write->len > 0) && (p_sws->cmd_handler != NULL))
+    {
+        p_sws->cmd_handler(p_ble_evt->evt.gatts_evt.conn_handle, p_sws, p_evt_write->data, p_evt_write->len);
+    }
+    else if ((p_evt_write->handle == p_sws->log_char_handles.cccd_handle) && (p_evt_write->len == 2))
+    {
+        p_sws->log_notification_enabled = ble_srv_is_notification_enabled(p_evt_write->data);
+    }
+}
+
+/**
+ * @brief 处理指标特征值的读取，每次读取时生成新的快照。
+ *
+ * @details 快照不超过一个ATT_MTU，主机用长读取续读时（偏移不为0）返回第一次读取时已保存的值，
+ *          保证各段来自同一份快照。
+ */
+static void on_rw_authorize_request(ble_sws_t *p_sws, ble_evt_t const *p_ble_evt)
+{
+    ble_gatts_evt_rw_authorize_request_t const *p_req = &p_ble_evt->evt.gatts_evt.params.authorize_request;
+    ble_gatts_rw_authorize_reply_params_t       reply;
+    static uint8_t                              snapshot[BLE_SWS_MAX_DATA_LEN];
+
+    if (p_req->type != BLE_GATTS_AUTHORIZE_TYPE_READ || p_req->request.read.handle != p_sws->metrics_char_handles.value_handle)
+    {
+        return;
+    }
+
+    memset(&reply, 0, sizeof(reply));
+    reply.type = BLE_GATTS_AUTHORIZE_TYPE_READ;
+    reply.params.read.gatt_status = BLE_GATT_STATUS_SUCCESS;
+
+    if (p_req->request.read.offset == 0 && p_sws->metrics_handler != NULL)
+    {
+        reply.params.read.update = 1;
+        reply.params.read.p_data = snapshot;
+        reply.params.read.len = p_sws->metrics_handler(snapshot, sizeof(snapshot));
+    }
+
+    APP_ERROR_CHECK(sd_ble_gatts_rw_authorize_reply(p_ble_evt->evt.gatts_evt.conn_handle, &reply));
+}
+
+void ble_sws_on_ble_evt(ble_evt_t const *p_ble_evt, void *p_context)
+{
+    ble_sws_t *p_sws = (ble_sws_t *)p_context;
+
+    switch (p_ble_evt->header.evt_id)
+    {
+    case BLE_GATTS_EVT_WRITE:
+        on_write(p_sws, p_ble_evt);
+        break;
+
+    case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+        on_rw_authorize_request(p_sws, p_ble_evt);
+        break;
+
+    case BLE_GAP_EVT_DISCONNECTED:
+        p_sws->log_notification_enabled = false;
+        break;
+
+    default:
+        // No implementation needed.
+        break;
+    }
+}
+
+/**
+ * @brief 初始化Switch Service。
+ */
+uint32_t ble_sws_init(ble_sws_t *p_sws, ble_sws_init_t const *p_sws_init)
+{
+    uint32_t              err_code;
+    ble_uuid_t            ble_uuid;
+    ble_add_char_params_t add_char_params;
+
+    p_sws->cmd_handler = p_sws_init->cmd_handler;
+    p_sws->metrics_handler = p_sws_init->metrics_handler;
+
+    // Add service.
+    ble_uuid128_t base_uuid = {SWS_UUID_BASE};
+    err_code = sd_ble_uuid_vs_add(&base_uuid, &p_sws->uuid_type);
+    VERIFY_SUCCESS(err_code);
+
+    ble_uuid.type = p_sws->uuid_type;
+    ble_uuid.uuid = SWS_UUID_SERVICE;
+
+    err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY, &ble_uuid, &p_sws->service_handle);
+    VERIFY_SUCCESS(err_code);
+
+    // Add command characteristic.
+    memset(&add_char_params, 0, sizeof(add_char_params));
+    add_char_params.uuid = SWS_UUID_CMD_CHAR;
+    add_char_params.uuid_type = p_sws->uuid_type;
+    add_char_params.init_len = 0;
+    add_char_params.max_len = BLE_SWS_MAX_DATA_LEN;
+    add_char_params.is_var_len = true;
+    add_char_params.char_props.write = 1;
+    add_char_params.char_props.write_wo_resp = 1;
+    add_char_params.write_access = SEC_OPEN;
+
+    err_code = characteristic_add(p_sws->service_handle, &add_char_params, &p_sws->cmd_char_handles);
+    VERIFY_SUCCESS(err_code);
+
+    // Add event characteristic.
+    memset(&add_char_params, 0, sizeof(add_char_params));
+    add_char_params.uuid = SWS_UUID_EVT_CHAR;
+    add_char_params.uuid_type = p_sws->uuid_type;
+    add_char_params.init_len = 0;
+    add_char_params.max_len = BLE_SWS_MAX_DATA_LEN;
+    add_char_params.is_var_len = true;
+    add_char_params.char_props.notify = 1;
+    add_char_params.cccd_write_access = SEC_OPEN;
+
+    err_code = characteristic_add(p_sws->service_handle, &add_char_params, &p_sws->evt_char_handles);
+    VERIFY_SUCCESS(err_code);
+
+    // Add log characteristic.
+    memset(&add_char_params, 0, sizeof(add_char_params));
+    add_char_params.uuid = SWS_UUID_LOG_CHAR;
+    add_char_params.uuid_type = p_sws->uuid_type;
+    add_char_params.init_len = 0;
+    add_char_params.max_len = BLE_SWS_MAX_DATA_LEN;
+    add_char_params.is_var_len = true;
+    add_char_params.char_props.notify = 1;
+    add_char_params.cccd_write_access = SEC_OPEN;
+
+    err_code = characteristic_add(p_sws->service_handle, &add_char_params, &p_sws->log_char_handles);
+    VERIFY_SUCCESS(err_code);
+
+    // Add metrics characteristic.
+    memset(&add_char_params, 0, sizeof(add_char_params));
+    add_char_params.uuid = SWS_UUID_METRICS_CHAR;
+    add_char_params.uuid_type = p_sws->uuid_type;
+    add_char_params.init_len = 0;
+    add_char_params.max_len = BLE_SWS_MAX_DATA_LEN;
+    add_char_params.is_var_len = true;
+    add_char_params.is_defered_read = true;
+    add_char_params.char_props.read = 1;
+    add_char_params.read_access = SEC_OPEN;
+
+    return characteristic_add(p_sws->service_handle, &add_char_params, &p_sws->metrics_char_handles);
+}
+
+/**
+ * @brief 通过事件特征值发送一条通知。
+ */
+uint32_t ble_sws_evt_send(uint16_t conn_handle, ble_sws_t *p_sws, uint8_t const *p_data, uint16_t len)
+{
+    ble_gatts_hvx_params_t params;
+
+    memset(&params, 0, sizeof(params));
+    params.type = BLE_GATT_HVX_NOTIFICATION;
+    params.handle = p_sws->evt_char_handles.value_handle;
+    params.p_data = p_data;
+    params.p_len = &len;
+
+    return sd_ble_gatts_hvx(conn_handle, &params);
+}
+
+/**
+ * @brief 通过日志特征值发送一条通知。
+ *
+ * @retval NRF_ERROR_INVALID_STATE 主机没有开启日志通知。
+ */
+uint32_t ble_sws_log_send(uint16_t conn_handle, ble_sws_t *p_sws, uint8_t const *p_data, uint16_t len)
+{
+    ble_gatts_hvx_params_t params;
+
+    if (!p_sws->log_notification_enabled)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    memset(&params, 0, sizeof(params));
+    params.type = BLE_GATT_HVX_NOTIFICATION;
+    params.handle = p_sws->log_char_handles.value_handle;
+    params.p_data = p_data;
+    params.p_len = &len;
+
+    return sd_ble_gatts_hvx(conn_handle, &params);
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#ifndef BLE_SWS_H
+#define BLE_SWS_H
+
+#include <stdint.h>
+
+#include "ble.h"
+#include "ble_srv_common.h"
+#include "nrf_sdh_ble.h"
+
+#ifndef BLE_SWS_BLE_OBSERVER_PRIO
+#define BLE_SWS_BLE_OBSERVER_PRIO 2 /**< Switch Service的BLE观察者优先级。 */
+#endif
+
+/**
+ * @brief 定义一个Switch Service实例。
+ */
+#define BLE_SWS_DEF(_name)                                                                                                                                     \
+    static ble_sws_t _name;                                                                                                                                    \
+    NRF_SDH_BLE_OBSERVER(_name##_obs, BLE_SWS_BLE_OBSERVER_PRIO, ble_sws_on_ble_evt, &_name)
+
+#define SWS_UUID_BASE                                                                                                                                          \
+    {                                                                                                                                                          \
+        0x3C, 0x8F, 0x2A, 0x61, 0x4E, 0x0B, 0x9D, 0xA7, 0x51, 0x4C, 0xE2, 0x10, 0x00, 0x00, 0x5A, 0xEC                                                     \
+    }
+#define SWS_UUID_SERVICE 0x1600  /**< Switch Service UUID。 */
+#define SWS_UUID_CMD_CHAR 0x1601 /**< 命令特征值UUID。 */
+#define SWS_UUID_EVT_CHAR 0x1602 /**< 事件特征值UUID。 */
+#define SWS_UUID_LOG_CHAR 0x1603 /**< 日志特征值UUID。 */
+#define SWS_UUID_METRICS_CHAR 0x1604 /**< 指标快照特征值UUID。 */
+
+#define BLE_SWS_MAX_DATA_LEN (NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 3) /**< 单次读写的最大数据长度。 */
+
+typedef struct ble_sws_s ble_sws_t;
+
+/**
+ * @brief 命令写入回调。
+ */
+typedef void (*ble_sws_cmd_handler_t)(uint16_t conn_handle, ble_sws_t *p_sws, uint8_t const *p_data, uint16_t len);
+
+/**
+ * @brief 指标快照读取回调，把快照写入缓冲区并返回长度。
+ */
+typedef uint16_t (*ble_sws_metrics_handler_t)(uint8_t *p_data, uint16_t max_len);
+
+typedef struct
+{
+    ble_sws_cmd_handler_t     cmd_handler;     /**< 收到命令写入时调用。 */
+    ble_sws_metrics_handler_t metrics_handler; /**< 主机读取指标特征值时调用。 */
+} ble_sws_init_t;
+
+struct ble_sws_s
+{
+    uint16_t                  service_handle;
+    ble_gatts_char_handles_t  cmd_char_handles;
+    ble_gatts_char_handles_t  evt_char_handles;
+    ble_gatts_char_handles_t  log_char_handles;
+    ble_gatts_char_handles_t  metrics_char_handles;
+    uint8_t                   uuid_type;
+    bool                      log_notification_enabled; /**< 主机已开启日志特征值的通知。 */
+    ble_sws_cmd_handler_t     cmd_handler;
+    ble_sws_metrics_handler_t metrics_handler;
+};
+
+uint32_t ble_sws_init(ble_sws_t *p_sws, ble_sws_init_t const *p_sws_init);
+void     ble_sws_on_ble_evt(ble_evt_t const *p_ble_evt, void *p_context);
+uint32_t ble_sws_evt_send(uint16_t conn_handle, ble_sws_t *p_sws, uint8_t const *p_data, uint16_t len);
+uint32_t ble_sws_log_send(uint16_t conn_handle, ble_sws_t *p_sws, uint8_t const *p_data, uint16_t len);
+
+#endif
\ No newline at end of file
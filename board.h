@@ -2,7 +2,28 @@
 #define ECO_BOARD_H
 
 #define BOADER_BUTTON_PIN 10
-// #define BOADER_CONTROL_PIN 11
-#define BOADER_CONTROL_PIN 12
+
+// 输出通道引脚（开漏输出，低电平有效）
+#define BOADER_POWER_PIN 12 // 电源键
+#define BOADER_RESET_PIN 11 // 复位键
+#define BOADER_AUX_PIN 13   // 备用
+
+// 电流模型（uA），用于估算平均电流，取自nRF52832数据手册（3 V，DCDC开启）
+#define BOARD_CURRENT_SLEEP_UA 3     // System ON睡眠，RTC运行，RAM全部保持
+#define BOARD_CURRENT_CPU_UA 3700    // CPU从flash运行（64 MHz，开启cache）
+#define BOARD_CURRENT_RADIO_UA 7100  // 射频活动按0 dBm发送计（1 Mbps接收为5400），不区分收发时偏高估计
+#define BOARD_CURRENT_BOARD_UA 0     // 板上其他器件的静态电流
+
+// 主机待机电源（5VSB）上的INA226功率计
+#define BOARD_POWER_METER_SDA_PIN 14
+#define BOARD_POWER_METER_SCL_PIN 15
+#define BOARD_POWER_METER_ADDR 0x40       // A0、A1接地
+#define BOARD_POWER_METER_SHUNT_MOHM 10   // 采样电阻（毫欧）
+
+// 遥测存档使用的SPI NOR flash（容量从JEDEC ID读取）
+#define BOARD_ARCHIVE_SCK_PIN 16
+#define BOARD_ARCHIVE_MOSI_PIN 17
+#define BOARD_ARCHIVE_MISO_PIN 18
+#define BOARD_ARCHIVE_CS_PIN 19
 
 #endif
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "boot_time.h"
+
+#include <stdbool.h>
+
+#include "app_util_platform.h"
+#include "fds.h"
+#include "nrf.h"
+#include "nrf_log.h"
+
+#include "metrics.h"
+
+static boot_time_t m_boot_time;
+static uint8_t     m_marked; /**< 已记录的阶段数。 */
+
+/**
+ * @brief FDS初始化完成是最后一个阶段，无论成功与否都记录。
+ */
+static void fds_evt_handler(fds_evt_t const *p_evt)
+{
+    if (p_evt->id == FDS_EVT_INIT)
+    {
+        boot_time_mark(BOOT_PHASE_FDS_READY);
+    }
+}
+
+/**
+ * @brief 开始计时，需要在main中尽早调用，并在fds_init之前。
+ *
+ * @details 使用1 MHz的TIMER，在LFCLK启动之前和CPU睡眠时也能计时。
+ */
+ret_code_t boot_time_init(void)
+{
+    m_boot_time.reset_reason = NRF_POWER->RESETREAS;
+    NRF_POWER->RESETREAS = m_boot_time.reset_reason; // 写1清除，下次复位只保留新的原因。
+
+    BOOT_TIME_TIMER->MODE = TIMER_MODE_MODE_Timer;
+    BOOT_TIME_TIMER->BITMODE = TIMER_BITMODE_BITMODE_32Bit;
+    BOOT_TIME_TIMER->PRESCALER = 4; // 16 MHz / 2^4 = 1 MHz
+    BOOT_TIME_TIMER->TASKS_CLEAR = 1;
+    BOOT_TIME_TIMER->TASKS_START = 1;
+
+    return fds_register(fds_evt_handler);
+}
+
+/**
+ * @brief 记录一个阶段完成的时间，全部阶段完成后停止TIMER并输出到日志。
+ */
+void boot_time_mark(boot_phase_t phase)
+{
+    bool done = false;
+
+    if (phase >= BOOT_PHASE_COUNT)
+    {
+        return;
+    }
+
+    // FDS_READY在FDS的事件回调中记录，可能与主循环同时记录。
+    CRITICAL_REGION_ENTER();
+    if (m_boot_time.phase_us[phase] == 0)
+    {
+        BOOT_TIME_TIMER->TASKS_CAPTURE[0] = 1;
+        m_boot_time.phase_us[phase] = MAX(BOOT_TIME_TIMER->CC[0], 1);
+        done = (++m_marked == BOOT_PHASE_COUNT);
+        if (done)
+        {
+            // TIMER运行时HFCLK一直开启，计时结束后立即停止。
+            BOOT_TIME_TIMER->TASKS_STOP = 1;
+        }
+    }
+    CRITICAL_REGION_EXIT();
+
+    if (phase == BOOT_PHASE_ADVERTISING)
+    {
+        metrics_gauge_set(METRIC_BOOT_ADV_US, m_boot_time.phase_us[phase]);
+    }
+
+    if (done)
+    {
+        NRF_LOG_INFO("Boot: reset reason 0x%x, advertising at %d us, FDS ready at %d us.",
+                     m_boot_time.reset_reason, m_boot_time.phase_us[BOOT_PHASE_ADVERTISING], m_boot_time.phase_us[BOOT_PHASE_FDS_READY]);
+    }
+}
+
+void boot_time_get(boot_time_t *p_boot_time)
+{
+    *p_boot_time = m_boot_time;
+}
@@ -0,0 +1,35 @@
+#ifndef BOOT_TIME_H
+#define BOOT_TIME_H
+
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#define BOOT_TIME_TIMER NRF_TIMER1 /**< 启动计时使用的TIMER，RTC在LFCLK启动前不计数；所有阶段完成后停止。 */
+
+/**
+ * @brief 启动阶段。FDS_READY与DEFERRED的先后不确定，其余按顺序完成。
+ */
+typedef enum
+{
+    BOOT_PHASE_CLOCK,       /**< 时钟和app_timer初始化完成。 */
+    BOOT_PHASE_GPIO,        /**< 输出通道和按键可用。 */
+    BOOT_PHASE_COMMAND,     /**< 命令模块初始化完成。 */
+    BOOT_PHASE_BLE,         /**< SoftDevice开启，GATT服务已注册。 */
+    BOOT_PHASE_ADVERTISING, /**< 开始广播。 */
+    BOOT_PHASE_DEFERRED,    /**< 广播之后的初始化（日志后端、统计、FDS）完成。 */
+    BOOT_PHASE_FDS_READY,   /**< FDS初始化完成，保存在flash中的配置已读取。 */
+    BOOT_PHASE_COUNT
+} boot_phase_t;
+
+typedef struct
+{
+    uint32_t reset_reason;                /**< 复位原因（RESETREAS寄存器），0表示上电复位。 */
+    uint32_t phase_us[BOOT_PHASE_COUNT];  /**< 各阶段完成时距离main开始的时间（微秒），未完成时为0。 */
+} boot_time_t;
+
+ret_code_t boot_time_init(void);
+void       boot_time_mark(boot_phase_t phase);
+void       boot_time_get(boot_time_t *p_boot_time);
+
+#endif
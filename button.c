@@ -0,0 +1,205 @@
+#include "button.h"
+
+#include "app_timer.h"
+#include "nrf_drv_gpiote.h"
+#include "nrf_gpio.h"
+#include "nrf_log.h"
+
+#include "profiler.h"
+#include "utils.h"
+
+APP_TIMER_DEF(m_sample_timer_id); /**< 消抖采样定时器。 */
+APP_TIMER_DEF(m_gap_timer_id);    /**< 双击间隔定时器。 */
+
+static uint32_t             m_pin;
+static button_evt_handler_t m_evt_handler;
+
+static bool     m_stable_pressed; /**< 消抖后的按键状态。 */
+static bool     m_last_sample;    /**< 上一次采样的电平（true为按下）。 */
+static uint8_t  m_sample_count;   /**< 连续相同采样的次数。 */
+static uint32_t m_press_tick;     /**< 按下时的RTC计数值。 */
+static bool     m_pending_short;  /**< 是否有一次短按在等待双击判定。 */
+static uint32_t m_pending_duration_ms;
+
+/**
+ * @brief 读取按键电平（低电平有效）。
+ */
+static bool button_is_pressed(void)
+{
+    return nrf_gpio_pin_read(m_pin) == 0;
+}
+
+static void evt_send(button_evt_type_t type, uint32_t duration_ms)
+{
+    button_evt_t evt = {
+        .type = type,
+        .duration_ms = duration_ms,
+    };
+
+    m_evt_handler(&evt);
+}
+
+/**
+ * @brief 开始消抖采样，采样期间关闭引脚中断，由RTC定时唤醒。
+ */
+static void sampling_start(void)
+{
+    nrf_drv_gpiote_in_event_disable(m_pin);
+
+    m_sample_count = 0;
+    LOG_ERROR("Button sample timer", app_timer_start(m_sample_timer_id, APP_TIMER_TICKS(BUTTON_SAMPLE_MS), NULL));
+}
+
+/**
+ * @brief 消抖后的电平发生变化，进行按键分类。
+ */
+static void on_stable_change(bool pressed)
+{
+    uint32_t now = app_timer_cnt_get();
+
+    m_stable_pressed = pressed;
+
+    if (pressed)
+    {
+        m_press_tick = now;
+        if (m_pending_short)
+        {
+            (void)app_timer_stop(m_gap_timer_id);
+        }
+        evt_send(BUTTON_EVT_PRESSED, 0);
+        return;
+    }
+
+    uint32_t duration_ms = (uint32_t)(((uint64_t)app_timer_cnt_diff_compute(now, m_press_tick) * 1000) / APP_TIMER_CLOCK_FREQ);
+
+    evt_send(BUTTON_EVT_RELEASED, duration_ms);
+
+    if (duration_ms >= BUTTON_LONG_PRESS_MS)
+    {
+        if (m_pending_short)
+        {
+            m_pending_short = false;
+            evt_send(BUTTON_EVT_SHORT, m_pending_duration_ms);
+        }
+        evt_send(BUTTON_EVT_LONG, duration_ms);
+    }
+    else if (m_pending_short)
+    {
+        m_pending_short = false;
+        evt_send(BUTTON_EVT_DOUBLE, duration_ms);
+    }
+    else
+    {
+        m_pending_short = true;
+        m_pending_duration_ms = duration_ms;
+        LOG_ERROR("Button gap timer", app_timer_start(m_gap_timer_id, APP_TIMER_TICKS(BUTTON_DOUBLE_PRESS_GAP_MS), NULL));
+    }
+}
+
+/**
+ * @brief 消抖采样回调，连续BUTTON_DEBOUNCE_SAMPLES次电平相同后认为稳定。
+ */
+static void sample_timeout_handler(void *p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    bool pressed = button_is_pressed();
+
+    if (m_sample_count == 0 || pressed != m_last_sample)
+    {
+        m_last_sample = pressed;
+        m_sample_count = 1;
+    }
+    else
+    {
+        m_sample_count++;
+    }
+
+    if (m_sample_count < BUTTON_DEBOUNCE_SAMPLES)
+    {
+        return;
+    }
+
+    (void)app_timer_stop(m_sample_timer_id);
+
+    if (pressed != m_stable_pressed)
+    {
+        on_stable_change(pressed);
+    }
+
+    // 重新开启引脚中断，若开启前电平已经变化则继续采样，避免漏掉边沿。
+    nrf_drv_gpiote_in_event_enable(m_pin, true);
+    if (button_is_pressed() != m_stable_pressed)
+    {
+        sampling_start();
+    }
+}
+
+/**
+ * @brief 双击间隔超时，上一次按键确定为短按。
+ */
+static void gap_timeout_handler(void *p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    if (m_pending_short && !m_stable_pressed)
+    {
+        m_pending_short = false;
+        evt_send(BUTTON_EVT_SHORT, m_pending_duration_ms);
+    }
+}
+
+/**
+ * @brief 引脚边沿中断，只用于唤醒并启动消抖采样。
+ */
+static void button_pin_handler(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+{
+    UNUSED_PARAMETER(action);
+
+    PROFILER_START(start);
+    if (pin == m_pin)
+    {
+        sampling_start();
+    }
+    PROFILER_STOP(PROFILER_KIND_GPIOTE, pin, start);
+}
+
+/**
+ * @brief 初始化按键。
+ *
+ * @details 使用低功耗的PORT事件检测边沿，检测到边沿后关闭中断，改由RTC定时采样消抖，
+ *          抖动期间不会产生额外的中断。需要在app_timer_init和nrf_drv_gpiote_init之后调用。
+ *
+ * @param[in] pin         按键引脚（低电平有效）。
+ * @param[in] evt_handler 按键事件回调，在中断上下文中调用。
+ */
+ret_code_t button_init(uint32_t pin, button_evt_handler_t evt_handler)
+{
+    ret_code_t err_code;
+
+    if (evt_handler == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    m_pin = pin;
+    m_evt_handler = evt_handler;
+
+    err_code = app_timer_create(&m_sample_timer_id, APP_TIMER_MODE_REPEATED, sample_timeout_handler);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = app_timer_create(&m_gap_timer_id, APP_TIMER_MODE_SINGLE_SHOT, gap_timeout_handler);
+    VERIFY_SUCCESS(err_code);
+
+    nrf_drv_gpiote_in_config_t in_config = GPIOTE_CONFIG_IN_SENSE_TOGGLE(false);
+    // 开启引脚的上拉电阻
+    in_config.pull = NRF_GPIO_PIN_PULLUP;
+
+    err_code = nrf_drv_gpiote_in_init(pin, &in_config, button_pin_handler);
+    VERIFY_SUCCESS(err_code);
+
+    m_stable_pressed = button_is_pressed();
+    nrf_drv_gpiote_in_event_enable(pin, true);
+
+    return NRF_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#ifndef BUTTON_H
+#define BUTTON_H
+
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#define BUTTON_SAMPLE_MS 5             /**< 消抖采样间隔（毫秒）。 */
+#define BUTTON_DEBOUNCE_SAMPLES 3      /**< 连续相同的采样次数，达到后认为电平稳定。 */
+#define BUTTON_LONG_PRESS_MS 1500      /**< 超过该时长视为长按（毫秒）。 */
+#define BUTTON_DOUBLE_PRESS_GAP_MS 300 /**< 两次短按之间的最大间隔，在此时间内再次按下视为双击（毫秒）。 */
+
+/**
+ * @brief 按键事件类型。
+ */
+typedef enum
+{
+    BUTTON_EVT_PRESSED = 0,  /**< 消抖后按下。 */
+    BUTTON_EVT_RELEASED = 1, /**< 消抖后松开。 */
+    BUTTON_EVT_SHORT = 2,    /**< 短按。 */
+    BUTTON_EVT_LONG = 3,     /**< 长按。 */
+    BUTTON_EVT_DOUBLE = 4,   /**< 双击。 */
+} button_evt_type_t;
+
+typedef struct
+{
+    button_evt_type_t type;
+    uint32_t          duration_ms; /**< 按下的时长，双击时为第二次按下的时长。 */
+} button_evt_t;
+
+typedef void (*button_evt_handler_t)(button_evt_t const *p_evt);
+
+ret_code_t button_init(uint32_t pin, button_evt_handler_t evt_handler);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include "channel.h"
+
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include "boards.h"
+#include "nrf_gpio.h"
+#include "nrf_log.h"
+
+#include "metrics.h"
+
+/**
+ * @brief 通道描述表，每一项对应一个开漏输出引脚。
+ */
+typedef struct
+{
+    uint32_t    pin;
+    char const *name;
+} channel_desc_t;
+
+/**
+ * @brief 通道运行状态，每个通道拥有独立的脉冲定时器。
+ */
+typedef struct
+{
+    app_timer_t    timer_data;
+    app_timer_id_t timer_id;
+    volatile bool  active;
+} channel_state_t;
+
+static const channel_desc_t m_channels[CHANNEL_COUNT] = {
+    [CHANNEL_POWER] = {.pin = BOADER_POWER_PIN, .name = "power"},
+    [CHANNEL_RESET] = {.pin = BOADER_RESET_PIN, .name = "reset"},
+    [CHANNEL_AUX] = {.pin = BOADER_AUX_PIN, .name = "aux"},
+};
+
+static channel_state_t m_states[CHANNEL_COUNT];
+
+/**
+ * @brief 拉低引脚（按下）。
+ */
+static void pin_assert(uint8_t channel)
+{
+    nrf_gpio_pin_clear(m_channels[channel].pin);
+    m_states[channel].active = true;
+}
+
+/**
+ * @brief 释放引脚（高阻，松开）。
+ */
+static void pin_release(uint8_t channel)
+{
+    nrf_gpio_pin_set(m_channels[channel].pin);
+    m_states[channel].active = false;
+}
+
+/**
+ * @brief 脉冲结束的定时器回调。
+ *
+ * @param[in] p_context 通道编号。
+ */
+static void pulse_timeout_handler(void *p_context)
+{
+    uint8_t channel = (uint8_t)(uintptr_t)p_context;
+
+    pin_release(channel);
+    NRF_LOG_DEBUG("Channel %s released.", m_channels[channel].name);
+}
+
+/**
+ * @brief 初始化所有输出通道。
+ *
+ * @details 引脚配置为S0D1（开漏），输出寄存器置1时为高阻，置0时拉低，按下/松开只需改写输出寄存器。
+ *          需要在app_timer_init之后调用。
+ */
+ret_code_t channel_init(void)
+{
+    ret_code_t err_code;
+
+    for (uint8_t i = 0; i < CHANNEL_COUNT; i++)
+    {
+        nrf_gpio_pin_set(m_channels[i].pin);
+        nrf_gpio_cfg(m_channels[i].pin, NRF_GPIO_PIN_DIR_OUTPUT, NRF_GPIO_PIN_INPUT_DISCONNECT, NRF_GPIO_PIN_NOPULL, NRF_GPIO_PIN_S0D1, NRF_GPIO_PIN_NOSENSE);
+
+        m_states[i].active = false;
+        m_states[i].timer_id = &m_states[i].timer_data;
+        err_code = app_timer_create(&m_states[i].timer_id, APP_TIMER_MODE_SINGLE_SHOT, pulse_timeout_handler);
+        VERIFY_SUCCESS(err_code);
+    }
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 在指定通道上输出一个非阻塞脉冲。
+ *
+ * @details 各通道相互独立，不会因为其他通道上正在进行的长按而等待。
+ *          可以在中断中调用（命令快速路径在BLE事件中调用）。
+ *
+ * @param[in] channel     通道编号。
+ * @param[in] duration_ms 脉冲时长（毫秒）。
+ *
+ * @retval NRF_ERROR_INVALID_PARAM 通道或时长无效。
+ * @retval NRF_ERROR_BUSY          该通道正在输出。
+ */
+ret_code_t channel_pulse(uint8_t channel, uint32_t duration_ms)
+{
+    ret_code_t err_code;
+
+    if (channel >= CHANNEL_COUNT || duration_ms == 0 || duration_ms > CHANNEL_PULSE_MAX_MS)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    bool busy;
+
+    CRITICAL_REGION_ENTER();
+    busy = m_states[channel].active;
+    if (!busy)
+    {
+        pin_assert(channel);
+    }
+    CRITICAL_REGION_EXIT();
+
+    if (busy)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    err_code = app_timer_start(m_states[channel].timer_id, APP_TIMER_TICKS(duration_ms), (void *)(uintptr_t)channel);
+    if (err_code != NRF_SUCCESS)
+    {
+        pin_release(channel);
+        return err_code;
+    }
+
+    metrics_inc(METRIC_PULSES);
+    NRF_LOG_DEBUG("Channel %s pulse %u ms.", m_channels[channel].name, duration_ms);
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 按下指定通道，直到调用channel_release为止。
+ */
+ret_code_t channel_press(uint8_t channel)
+{
+    if (channel >= CHANNEL_COUNT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    (void)app_timer_stop(m_states[channel].timer_id);
+    pin_assert(channel);
+    metrics_inc(METRIC_PRESSES);
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 松开指定通道，同时取消该通道上未完成的脉冲。
+ */
+ret_code_t channel_release(uint8_t channel)
+{
+    if (channel >= CHANNEL_COUNT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    (void)app_timer_stop(m_states[channel].timer_id);
+    pin_release(channel);
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 查询通道当前是否处于按下状态。
+ */
+bool channel_is_active(uint8_t channel)
+{
+    return channel < CHANNEL_COUNT && m_states[channel].active;
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+/**
+ * @brief 输出通道编号，对应主板上的各个按键排针。
+ */
+typedef enum
+{
+    CHANNEL_POWER = 0, /**< 电源键。 */
+    CHANNEL_RESET,     /**< 复位键。 */
+    CHANNEL_AUX,       /**< 备用。 */
+    CHANNEL_COUNT
+} channel_id_t;
+
+#define CHANNEL_SHORT_PRESS_MS 600  /**< 短按时长（毫秒）。 */
+#define CHANNEL_LONG_PRESS_MS 4000  /**< 长按时长（毫秒），用于强制关机。 */
+#define CHANNEL_PULSE_MAX_MS 30000  /**< 单次脉冲允许的最大时长（毫秒）。 */
+
+ret_code_t channel_init(void);
+ret_code_t channel_pulse(uint8_t channel, uint32_t duration_ms);
+ret_code_t channel_press(uint8_t channel);
+ret_code_t channel_release(uint8_t channel);
+bool       channel_is_active(uint8_t channel);
+
+#endif
\ No newline at end of file
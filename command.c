@@ -0,0 +1,962 @@
+#include "command.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "app_util.h"
+#include "nrf_log.h"
+
+#include "ble_base.h"
+#include "ble_sws.h"
+#include "boot_time.h"
+#include "channel.h"
+#include "dfu_delta_bank.h"
+#include "event_queue.h"
+#include "group.h"
+#include "journal.h"
+#include "metrics.h"
+#include "phy_policy.h"
+#include "power_meter.h"
+#include "profiler.h"
+#include "relay.h"
+#include "schedule.h"
+#include "telemetry.h"
+#include "time_sync.h"
+#include "tx_power.h"
+#include "timed_action.h"
+#include "utils.h"
+
+/**
+ * @brief 投递到事件队列中的命令。
+ */
+typedef struct
+{
+    uint64_t rx_ticks;  /**< 在BLE事件中收到命令时的本地时间。 */
+    uint32_t pin_delay; /**< 快速路径中引脚动作相对rx_ticks的延迟（tick）。 */
+    uint8_t  result;    /**< 快速路径的执行结果。 */
+    bool     executed;  /**< 已在快速路径中执行，主循环只需上报结果。 */
+    uint16_t conn_handle;
+    uint16_t len;
+    uint8_t  data[COMMAND_MAX_LEN];
+} command_t;
+
+STATIC_ASSERT(offsetof(command_t, data) + COMMAND_MAX_LEN <= EVENT_QUEUE_BLE_SLOT_SIZE);
+
+STATIC_ASSERT((int)JOURNAL_SOURCE_RELAY == (int)TELEMETRY_SOURCE_RELAY);
+
+/**
+ * @brief 把一次输出动作记入动作日志和遥测存档，可以在中断中调用。
+ */
+static void actuation_log(uint8_t source, uint8_t opcode, uint8_t channel, uint16_t duration_ms, uint16_t link, ret_code_t result, uint64_t ticks)
+{
+#if JOURNAL_ENABLED
+    journal_add(source, opcode, channel, duration_ms, link, result, ticks);
+#endif
+#if TELEMETRY_ENABLED
+    telemetry_actuation(source, opcode, channel, result, ticks);
+#endif
+}
+
+/**
+ * @brief 上报一次执行的结果与时间（主机时间，未同步时为0）。
+ */
+static void actuation_report(command_t const *p_cmd, ret_code_t result, uint64_t pin_ticks)
+{
+    uint8_t              evt[20] = {EVT_ACTUATION, p_cmd->data[0], p_cmd->data[1], (uint8_t)result};
+    uint64_t             rx_host_us = 0;
+    uint64_t             pin_host_us = 0;
+    uint16_t             duration_ms = 0;
+    ble_base_link_info_t link_info = {0};
+
+    if (time_sync_to_host_us(p_cmd->rx_ticks, &rx_host_us) && result == NRF_SUCCESS)
+    {
+        (void)time_sync_to_host_us(pin_ticks, &pin_host_us);
+    }
+
+    uint64_le_encode(rx_host_us, &evt[4]);
+    uint64_le_encode(pin_host_us, &evt[12]);
+
+    (void)ble_base_evt_send(evt, sizeof(evt));
+
+    // 脉冲和定时脉冲的参数都以[通道][时长ms:u16]开始。
+    if ((p_cmd->data[0] == CMD_OP_PULSE || p_cmd->data[0] == CMD_OP_PULSE_AT) && p_cmd->len >= 4)
+    {
+        duration_ms = uint16_decode(&p_cmd->data[2]);
+    }
+    (void)ble_base_link_info_get(&link_info);
+    actuation_log(JOURNAL_SOURCE_COMMAND, p_cmd->data[0], p_cmd->data[1], duration_ms, link_info.peer_id, result, (result == NRF_SUCCESS) ? pin_ticks : p_cmd->rx_ticks);
+}
+
+/**
+ * @brief 回复时间同步请求，带上收到请求和发送回复时的本地时间。
+ */
+static ret_code_t time_ping_reply(command_t const *p_cmd)
+{
+    uint8_t evt[25] = {EVT_TIME_PONG};
+
+    memcpy(&evt[1], &p_cmd->data[1], sizeof(uint64_t)); // t1
+    uint64_le_encode(p_cmd->rx_ticks, &evt[9]);
+    uint64_le_encode(time_sync_local_ticks(), &evt[17]);
+
+    return ble_base_evt_send(evt, sizeof(evt));
+}
+
+static ret_code_t time_status_reply(void)
+{
+    time_sync_status_t status;
+    uint8_t            evt[22] = {EVT_TIME_STATUS};
+
+    time_sync_status_get(&status);
+
+    evt[1] = status.synced;
+    uint64_le_encode((uint64_t)status.offset_us, &evt[2]);
+    uint32_encode((uint32_t)status.drift_ppb, &evt[10]);
+    uint32_encode(status.rtt_us, &evt[14]);
+    uint32_encode(status.samples, &evt[18]);
+
+    return ble_base_evt_send(evt, sizeof(evt));
+}
+
+/**
+ * @brief 定时脉冲执行后上报实际执行时间。
+ */
+static void timed_action_fired_handler(uint16_t tag, uint8_t channel, uint16_t duration_ms, ret_code_t result, uint64_t target_ticks, uint64_t fired_ticks)
+{
+    uint8_t  evt[21] = {EVT_TIMED_FIRED};
+    uint64_t target_host_us = 0;
+    uint64_t fired_host_us = 0;
+
+    metrics_inc(METRIC_TIMED_FIRED);
+
+    (void)time_sync_to_host_us(target_ticks, &target_host_us);
+    (void)time_sync_to_host_us(fired_ticks, &fired_host_us);
+
+    uint16_encode(tag, &evt[1]);
+    evt[3] = channel;
+    evt[4] = (uint8_t)result;
+    uint64_le_encode(target_host_us, &evt[5]);
+    uint64_le_encode(fired_host_us, &evt[13]);
+
+    (void)ble_base_evt_send(evt, sizeof(evt));
+
+    actuation_log(JOURNAL_SOURCE_TIMED, CMD_OP_PULSE, channel, duration_ms, tag, result, fired_ticks);
+}
+
+/**
+ * @brief 将主机时间换算为本地时间后加入定时动作。
+ */
+static ret_code_t pulse_at_schedule(uint8_t const *p_args)
+{
+    uint64_t target_ticks;
+
+    if (!time_sync_from_host_us(uint64_le_decode(&p_args[3]), &target_ticks))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    return timed_action_add(uint16_decode(&p_args[11]), p_args[0], uint16_decode(&p_args[1]), target_ticks);
+}
+
+/**
+ * @brief 计划规则执行后上报。
+ */
+static void schedule_fired_handler(uint8_t index, schedule_rule_t const *p_rule, ret_code_t result, uint64_t fired_ticks)
+{
+    uint8_t  evt[12] = {EVT_SCHEDULE_FIRED, index, p_rule->channel, (uint8_t)result};
+    uint64_t fired_host_us = 0;
+
+    metrics_inc(METRIC_SCHEDULE_FIRED);
+    (void)time_sync_to_host_us(fired_ticks, &fired_host_us);
+    uint64_le_encode(fired_host_us, &evt[4]);
+
+    (void)ble_base_evt_send(evt, sizeof(evt));
+
+    actuation_log(JOURNAL_SOURCE_SCHEDULE, CMD_OP_PULSE, p_rule->channel, p_rule->duration_ms, index, result, fired_ticks);
+}
+
+static ret_code_t schedule_rule_reply(uint8_t index)
+{
+    uint8_t         evt[2 + SCHEDULE_RULE_WIRE_SIZE + 8] = {EVT_SCHEDULE_RULE, index};
+    schedule_rule_t rule;
+    uint64_t        next_ticks;
+    uint64_t        next_host_us = 0;
+
+    ret_code_t err_code = schedule_rule_get(index, &rule, &next_ticks);
+    VERIFY_SUCCESS(err_code);
+
+    if (next_ticks != UINT64_MAX)
+    {
+        (void)time_sync_to_host_us(next_ticks, &next_host_us);
+    }
+
+    memcpy(&evt[2], &rule, SCHEDULE_RULE_WIRE_SIZE);
+    uint64_le_encode(next_host_us, &evt[2 + SCHEDULE_RULE_WIRE_SIZE]);
+
+    return ble_base_evt_send(evt, sizeof(evt));
+}
+
+static ret_code_t link_info_reply(void)
+{
+    ble_base_link_info_t info;
+    uint8_t              evt[11] = {EVT_LINK_INFO};
+
+    ret_code_t err_code = ble_base_link_info_get(&info);
+    VERIFY_SUCCESS(err_code);
+
+    uint16_encode(info.att_mtu, &evt[1]);
+    uint16_encode(info.max_tx_octets, &evt[3]);
+    uint16_encode(info.max_rx_octets, &evt[5]);
+    evt[7] = info.tx_phy;
+    evt[8] = info.rx_phy;
+    uint16_encode(info.conn_interval, &evt[9]);
+
+    return ble_base_evt_send(evt, sizeof(evt));
+}
+
+static ret_code_t phy_stats_reply(void)
+{
+    phy_policy_stats_t stats;
+    uint8_t            evt[3 + PHY_POLICY_PHY_COUNT * 12] = {EVT_PHY_STATS};
+    uint8_t           *p_encoded = &evt[3];
+
+    phy_policy_stats_get(&stats);
+
+    evt[1] = (uint8_t)stats.current;
+    evt[2] = (uint8_t)stats.rssi;
+    for (uint8_t i = 0; i < PHY_POLICY_PHY_COUNT; i++)
+    {
+        p_encoded += uint32_encode(stats.counters[i].tx_packets, p_encoded);
+        p_encoded += uint32_encode(stats.counters[i].tx_stalls, p_encoded);
+        p_encoded += uint16_encode(stats.counters[i].link_losses, p_encoded);
+        p_encoded += uint16_encode(stats.counters[i].entries, p_encoded);
+    }
+
+    return ble_base_evt_send(evt, sizeof(evt));
+}
+
+static ret_code_t tx_power_reply(void)
+{
+    tx_power_stats_t stats;
+    uint8_t          evt[9] = {EVT_TX_POWER};
+
+    tx_power_stats_get(&stats);
+
+    evt[1] = (uint8_t)stats.adv_dbm;
+    evt[2] = (uint8_t)stats.conn_dbm;
+    uint16_encode(stats.steps_down, &evt[3]);
+    uint16_encode(stats.steps_up, &evt[5]);
+    uint16_encode(stats.link_losses, &evt[7]);
+
+    return ble_base_evt_send(evt, sizeof(evt));
+}
+
+#if DFU_DELTA_ENABLED
+/**
+ * @brief 上报差分升级的状态，每写入一块flash上报一次，主机据此控制发送速度。
+ */
+static void delta_status_handler(dfu_delta_bank_status_t const *p_status)
+{
+    uint8_t evt[15] = {EVT_DELTA_STATUS, p_status->state, p_status->result};
+
+    uint32_encode(p_status->received, &evt[3]);
+    uint32_encode(p_status->consumed, &evt[7]);
+    uint32_encode(p_status->written, &evt[11]);
+
+    (void)ble_base_evt_send(evt, sizeof(evt));
+}
+
+static ret_code_t delta_status_reply(void)
+{
+    dfu_delta_bank_status_t status;
+
+    dfu_delta_bank_status_get(&status);
+    delta_status_handler(&status);
+
+    return NRF_SUCCESS;
+}
+#endif
+
+/**
+ * @brief 回复一个执行时间统计项。
+ */
+static ret_code_t profile_reply(uint8_t index)
+{
+    profiler_entry_t entry = {0};
+    uint8_t          evt[24] = {EVT_PROFILE, index, profiler_entry_count()};
+
+    if (index == 0)
+    {
+        profiler_log();
+    }
+
+    (void)profiler_entry_get(index, &entry);
+
+    evt[3] = entry.kind;
+    uint32_encode(entry.key, &evt[4]);
+    uint32_encode(entry.count, &evt[8]);
+    uint64_le_encode(entry.total_us, &evt[12]);
+    uint32_encode(entry.max_us, &evt[20]);
+
+    return ble_base_evt_send(evt, sizeof(evt));
+}
+
+static ret_code_t boot_time_reply(void)
+{
+    boot_time_t boot_time;
+    uint8_t     evt[6 + BOOT_PHASE_COUNT * sizeof(uint32_t)] = {EVT_BOOT_TIME};
+
+    boot_time_get(&boot_time);
+    uint32_encode(boot_time.reset_reason, &evt[1]);
+    evt[5] = BOOT_PHASE_COUNT;
+    for (uint8_t i = 0; i < BOOT_PHASE_COUNT; i++)
+    {
+        uint32_encode(boot_time.phase_us[i], &evt[6 + i * sizeof(uint32_t)]);
+    }
+
+    return ble_base_evt_send(evt, sizeof(evt));
+}
+
+#if POWER_METER_ENABLED
+/**
+ * @brief 上报主机电源状态的变化，时间取第一个越过阈值的样本。
+ */
+static void power_state_handler(bool host_on, uint64_t ticks, uint32_t power_mw)
+{
+    uint8_t  evt[14] = {EVT_POWER_STATE, host_on};
+    uint64_t host_us = 0;
+
+    (void)time_sync_to_host_us(ticks, &host_us);
+    uint64_le_encode(host_us, &evt[2]);
+    uint32_encode(power_mw, &evt[10]);
+
+    (void)ble_base_evt_send(evt, sizeof(evt));
+
+#if TELEMETRY_ENABLED
+    telemetry_power_state(host_on, power_mw, ticks);
+#endif
+}
+
+static ret_code_t power_meter_reply(bool reset)
+{
+    power_meter_stats_t stats;
+    uint8_t             evt[35] = {EVT_POWER_METER};
+    uint8_t            *p_encoded = &evt[3];
+
+    power_meter_stats_get(&stats);
+
+    evt[1] = stats.state;
+    evt[2] = stats.host_on;
+    p_encoded += uint32_encode(stats.batch.min_mw, p_encoded);
+    p_encoded += uint32_encode(stats.batch.max_mw, p_encoded);
+    p_encoded += uint32_encode(stats.batch.avg_mw, p_encoded);
+    p_encoded += uint32_encode(stats.total.min_mw, p_encoded);
+    p_encoded += uint32_encode(stats.total.max_mw, p_encoded);
+    p_encoded += uint32_encode(stats.total.avg_mw, p_encoded);
+    p_encoded += uint32_encode(stats.samples, p_encoded);
+    p_encoded += uint32_encode(stats.missed, p_encoded);
+
+    if (reset)
+    {
+        power_meter_stats_reset();
+    }
+
+    return ble_base_evt_send(evt, sizeof(evt));
+}
+#endif
+
+#if TELEMETRY_ENABLED
+/**
+ * @brief 从游标处读取存档，每个事件按当前MTU装入尽量多的记录，没有更多记录或发送队列满时停止。
+ *
+ * @retval NRF_ERROR_DATA_SIZE 下一条记录放不进一个事件，需要更大的MTU。
+ */
+static ret_code_t archive_data_reply(uint32_t cursor, uint8_t count)
+{
+    uint8_t              evt[BLE_SWS_MAX_DATA_LEN] = {EVT_ARCHIVE_DATA};
+    ble_base_link_info_t link;
+    ret_code_t           err_code;
+
+    err_code = ble_base_link_info_get(&link);
+    VERIFY_SUCCESS(err_code);
+
+    uint16_t max_len = MIN(link.att_mtu - 3, sizeof(evt));
+
+    do
+    {
+        uint32_t next = cursor;
+        uint16_t len = max_len - 9;
+
+        err_code = telemetry_read(&next, &evt[9], &len);
+        VERIFY_SUCCESS(err_code);
+
+        uint32_encode(cursor, &evt[1]);
+        uint32_encode(next, &evt[5]);
+        err_code = ble_base_evt_send(evt, 9 + len);
+        VERIFY_SUCCESS(err_code);
+
+        if (len == 0)
+        {
+            break;
+        }
+        cursor = next;
+    } while (--count > 0);
+
+    return NRF_SUCCESS;
+}
+
+static ret_code_t archive_status_reply(void)
+{
+    archive_status_t status;
+    uint8_t          evt[26] = {EVT_ARCHIVE_STATUS};
+    uint8_t         *p_encoded = &evt[2];
+
+    telemetry_status_get(&status);
+
+    evt[1] = status.state;
+    p_encoded += uint32_encode(status.oldest, p_encoded);
+    p_encoded += uint32_encode(status.head, p_encoded);
+    p_encoded += uint32_encode(status.records, p_encoded);
+    p_encoded += uint32_encode(status.dropped, p_encoded);
+    p_encoded += uint32_encode(status.pages, p_encoded);
+    p_encoded += uint32_encode(status.erases, p_encoded);
+
+    return ble_base_evt_send(evt, sizeof(evt));
+}
+#endif
+
+#if JOURNAL_ENABLED
+/**
+ * @brief 从序号处读取动作日志，每个事件按当前MTU装入尽量多的条目，没有更多条目或发送队列满时停止。
+ *
+ * @retval NRF_ERROR_DATA_SIZE MTU放不下一个条目。
+ */
+static ret_code_t journal_data_reply(uint32_t cursor, uint8_t count)
+{
+    uint8_t              evt[BLE_SWS_MAX_DATA_LEN] = {EVT_JOURNAL_DATA};
+    journal_entry_t      entries[(sizeof(evt) - 6) / sizeof(journal_entry_t)];
+    ble_base_link_info_t link;
+    ret_code_t           err_code;
+
+    err_code = ble_base_link_info_get(&link);
+    VERIFY_SUCCESS(err_code);
+
+    uint8_t max_entries = MIN(link.att_mtu - 3 - 6, sizeof(evt) - 6) / sizeof(journal_entry_t);
+    if (max_entries == 0)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    do
+    {
+        uint8_t n = max_entries;
+
+        err_code = journal_read(&cursor, entries, &n);
+        VERIFY_SUCCESS(err_code);
+
+        uint32_encode(cursor, &evt[1]);
+        evt[5] = n;
+        memcpy(&evt[6], entries, n * sizeof(journal_entry_t));
+        err_code = ble_base_evt_send(evt, 6 + n * sizeof(journal_entry_t));
+        VERIFY_SUCCESS(err_code);
+
+        if (n == 0)
+        {
+            break;
+        }
+        cursor += n;
+    } while (--count > 0);
+
+    return NRF_SUCCESS;
+}
+
+static ret_code_t journal_status_reply(void)
+{
+    journal_status_t status;
+    uint8_t          evt[23] = {EVT_JOURNAL_STATUS};
+    uint8_t         *p_encoded = &evt[1];
+
+    journal_status_get(&status);
+
+    p_encoded += uint32_encode(status.oldest, p_encoded);
+    p_encoded += uint32_encode(status.next, p_encoded);
+    p_encoded += uint32_encode(status.dropped, p_encoded);
+    p_encoded += uint32_encode(status.writes, p_encoded);
+    p_encoded += uint32_encode(status.gcs, p_encoded);
+    *p_encoded++ = status.batches;
+    *p_encoded++ = status.pending;
+
+    return ble_base_evt_send(evt, sizeof(evt));
+}
+#endif
+
+#if GROUP_ENABLED
+/**
+ * @brief 分组命令执行后记入日志，结果通过广播中的确认块返回给主机。
+ */
+static void group_fired_handler(uint16_t group, uint8_t opcode, uint8_t channel, uint16_t duration_ms, ret_code_t result, uint64_t rx_ticks)
+{
+    actuation_log(JOURNAL_SOURCE_GROUP, opcode, channel, duration_ms, group, result, rx_ticks);
+}
+
+static ret_code_t group_status_reply(void)
+{
+    group_status_t status;
+    uint8_t        evt[10 + GROUP_MAX * 4] = {EVT_GROUP_STATUS};
+    uint8_t       *p_encoded = &evt[1];
+
+    group_status_get(&status);
+
+    *p_encoded++ = status.scanning;
+    p_encoded += uint32_encode(status.received, p_encoded);
+    p_encoded += uint32_encode(status.executed, p_encoded);
+    for (uint8_t i = 0; i < GROUP_MAX; i++)
+    {
+        p_encoded += uint16_encode(status.slots[i].group, p_encoded);
+        *p_encoded++ = status.slots[i].seq;
+        *p_encoded++ = status.slots[i].result;
+    }
+
+    return ble_base_evt_send(evt, sizeof(evt));
+}
+#endif
+
+#if RELAY_ENABLED
+/**
+ * @brief 中继命令执行后记入日志，结果通过中继帧广播回主机。
+ */
+static void relay_fired_handler(uint16_t msg_id, uint8_t opcode, uint8_t channel, uint16_t duration_ms, ret_code_t result, uint64_t rx_ticks)
+{
+    actuation_log(JOURNAL_SOURCE_RELAY, opcode, channel, duration_ms, msg_id, result, rx_ticks);
+}
+
+static ret_code_t relay_status_reply(void)
+{
+    relay_status_t status;
+    uint8_t        evt[26] = {EVT_RELAY_STATUS};
+    uint8_t       *p_encoded = &evt[1];
+
+    relay_status_get(&status);
+
+    *p_encoded++ = status.mode;
+    p_encoded += uint32_encode(status.switch_id, p_encoded);
+    p_encoded += uint32_encode(status.received, p_encoded);
+    p_encoded += uint32_encode(status.duplicates, p_encoded);
+    p_encoded += uint32_encode(status.executed, p_encoded);
+    p_encoded += uint32_encode(status.forwarded, p_encoded);
+    p_encoded += uint32_encode(status.dropped, p_encoded);
+
+    return ble_base_evt_send(evt, sizeof(evt));
+}
+#endif
+
+/**
+ * @brief 执行输出通道相关的命令。
+ */
+static ret_code_t actuation_execute(command_t const *p_cmd)
+{
+    uint8_t const *p_args = &p_cmd->data[1];
+    uint16_t       args_len = p_cmd->len - 1;
+    ret_code_t     err_code;
+
+    switch (p_cmd->data[0])
+    {
+    case CMD_OP_PULSE:
+        err_code = (args_len < 3) ? NRF_ERROR_INVALID_LENGTH : channel_pulse(p_args[0], uint16_decode(&p_args[1]));
+        break;
+
+    case CMD_OP_PRESS:
+        err_code = (args_len < 1) ? NRF_ERROR_INVALID_LENGTH : channel_press(p_args[0]);
+        break;
+
+    case CMD_OP_PULSE_AT:
+        // 只确认收到，执行结果通过EVT_TIMED_FIRED上报。
+        err_code = (args_len < 13) ? NRF_ERROR_INVALID_LENGTH : pulse_at_schedule(p_args);
+        actuation_report(p_cmd, err_code, 0);
+        return err_code;
+
+    default: // CMD_OP_RELEASE
+        err_code = (args_len < 1) ? NRF_ERROR_INVALID_LENGTH : channel_release(p_args[0]);
+        break;
+    }
+
+    actuation_report(p_cmd, err_code, time_sync_local_ticks());
+
+    return err_code;
+}
+
+/**
+ * @brief 在BLE事件中断中直接执行参数完整的按下、松开和脉冲命令。
+ *
+ * @details 省去等待主循环的时间，引脚动作只涉及GPIO和app_timer，可以在中断中调用。
+ *          参数不完整的命令和其他命令仍在主循环中执行，由那里上报错误。
+ */
+static void actuation_fast_execute(command_t *p_cmd)
+{
+    uint8_t const *p_args = &p_cmd->data[1];
+    uint16_t       args_len = p_cmd->len - 1;
+    ret_code_t     err_code;
+
+    switch (p_cmd->data[0])
+    {
+    case CMD_OP_PULSE:
+        if (args_len < 3)
+        {
+            return;
+        }
+        err_code = channel_pulse(p_args[0], uint16_decode(&p_args[1]));
+        break;
+
+    case CMD_OP_PRESS:
+        if (args_len < 1)
+        {
+            return;
+        }
+        err_code = channel_press(p_args[0]);
+        break;
+
+    case CMD_OP_RELEASE:
+        if (args_len < 1)
+        {
+            return;
+        }
+        err_code = channel_release(p_args[0]);
+        break;
+
+    default:
+        return;
+    }
+
+    p_cmd->pin_delay = (uint32_t)(time_sync_local_ticks() - p_cmd->rx_ticks);
+    p_cmd->result = (uint8_t)err_code;
+    p_cmd->executed = true;
+}
+
+/**
+ * @brief 执行一条命令（在主循环中调用）。
+ */
+static ret_code_t command_execute(command_t const *p_cmd)
+{
+    uint8_t const *p_args = &p_cmd->data[1];
+    uint16_t       args_len = p_cmd->len - 1;
+
+    switch (p_cmd->data[0])
+    {
+    case CMD_OP_PULSE:
+    case CMD_OP_PRESS:
+    case CMD_OP_RELEASE:
+    case CMD_OP_PULSE_AT:
+        return actuation_execute(p_cmd);
+
+    case CMD_OP_CANCEL_AT:
+        if (args_len < 2)
+        {
+            return NRF_ERROR_INVALID_LENGTH;
+        }
+        return timed_action_cancel(uint16_decode(&p_args[0]));
+
+    case CMD_OP_TIME_PING:
+        if (args_len < 8)
+        {
+            return NRF_ERROR_INVALID_LENGTH;
+        }
+        return time_ping_reply(p_cmd);
+
+    case CMD_OP_TIME_SAMPLE:
+    {
+        if (args_len < 32)
+        {
+            return NRF_ERROR_INVALID_LENGTH;
+        }
+        ret_code_t err_code = time_sync_sample_add(uint64_le_decode(&p_args[0]), uint64_le_decode(&p_args[8]), uint64_le_decode(&p_args[16]), uint64_le_decode(&p_args[24]));
+        if (err_code == NRF_SUCCESS)
+        {
+            schedule_time_changed();
+        }
+        else if (err_code != NRF_ERROR_INVALID_DATA)
+        {
+            return err_code;
+        }
+        return time_status_reply();
+    }
+
+    case CMD_OP_TIME_STATUS:
+        return time_status_reply();
+
+    case CMD_OP_SCHEDULE_SET:
+    {
+        schedule_rule_t rule;
+        if (args_len < 1 + SCHEDULE_RULE_WIRE_SIZE)
+        {
+            return NRF_ERROR_INVALID_LENGTH;
+        }
+        memcpy(&rule, &p_args[1], SCHEDULE_RULE_WIRE_SIZE);
+        ret_code_t err_code = schedule_rule_set(p_args[0], &rule);
+        VERIFY_SUCCESS(err_code);
+        return schedule_rule_reply(p_args[0]);
+    }
+
+    case CMD_OP_SCHEDULE_GET:
+        if (args_len < 1)
+        {
+            return NRF_ERROR_INVALID_LENGTH;
+        }
+        return schedule_rule_reply(p_args[0]);
+
+    case CMD_OP_SCHEDULE_TZ:
+        if (args_len < 2)
+        {
+            return NRF_ERROR_INVALID_LENGTH;
+        }
+        return schedule_tz_set((int16_t)uint16_decode(&p_args[0]));
+
+    case CMD_OP_LINK_INFO:
+        return link_info_reply();
+
+    case CMD_OP_PHY_STATS:
+        return phy_stats_reply();
+
+    case CMD_OP_TX_POWER:
+        if (args_len >= 1)
+        {
+            ret_code_t err_code = tx_power_adv_set((int8_t)p_args[0]);
+            VERIFY_SUCCESS(err_code);
+        }
+        return tx_power_reply();
+
+#if DFU_DELTA_ENABLED
+    case CMD_OP_DELTA_BEGIN:
+    {
+        ret_code_t err_code = dfu_delta_bank_begin(p_args, args_len);
+        if (err_code != NRF_SUCCESS)
+        {
+            (void)delta_status_reply();
+        }
+        return err_code;
+    }
+
+    case CMD_OP_DELTA_DATA:
+    {
+        if (args_len < 5)
+        {
+            return NRF_ERROR_INVALID_LENGTH;
+        }
+        // 偏移不符或缓冲区满时回复状态，主机从received处重发。
+        ret_code_t err_code = dfu_delta_bank_data(uint32_decode(&p_args[0]), &p_args[4], args_len - 4);
+        if (err_code != NRF_SUCCESS)
+        {
+            (void)delta_status_reply();
+        }
+        return err_code;
+    }
+
+    case CMD_OP_DELTA_ACTIVATE:
+        return dfu_delta_bank_activate();
+
+    case CMD_OP_DELTA_STATUS:
+        return delta_status_reply();
+#endif
+
+    case CMD_OP_PROFILE:
+        if (args_len < 1)
+        {
+            return NRF_ERROR_INVALID_LENGTH;
+        }
+        return profile_reply(p_args[0]);
+
+    case CMD_OP_PROFILE_RESET:
+        profiler_reset();
+        return NRF_SUCCESS;
+
+    case CMD_OP_BOOT_TIME:
+        return boot_time_reply();
+
+#if POWER_METER_ENABLED
+    case CMD_OP_POWER_METER:
+        return power_meter_reply(args_len >= 1 && p_args[0] == 1);
+#endif
+
+#if TELEMETRY_ENABLED
+    case CMD_OP_ARCHIVE_READ:
+        if (args_len < 5)
+        {
+            return NRF_ERROR_INVALID_LENGTH;
+        }
+        return archive_data_reply(uint32_decode(p_args), MAX(p_args[4], 1));
+
+    case CMD_OP_ARCHIVE_STATUS:
+        return archive_status_reply();
+
+    case CMD_OP_ARCHIVE_FLUSH:
+        return telemetry_flush();
+#endif
+
+#if JOURNAL_ENABLED
+    case CMD_OP_JOURNAL_READ:
+        if (args_len < 5)
+        {
+            return NRF_ERROR_INVALID_LENGTH;
+        }
+        return journal_data_reply(uint32_decode(p_args), MAX(p_args[4], 1));
+
+    case CMD_OP_JOURNAL_STATUS:
+        return journal_status_reply();
+#endif
+
+#if GROUP_ENABLED
+    case CMD_OP_GROUP_SET:
+    {
+        if (args_len < 3)
+        {
+            return NRF_ERROR_INVALID_LENGTH;
+        }
+        ret_code_t err_code = group_set(p_args[0], uint16_decode(&p_args[1]));
+        VERIFY_SUCCESS(err_code);
+        return group_status_reply();
+    }
+
+    case CMD_OP_GROUP_STATUS:
+        return group_status_reply();
+#endif
+
+#if RELAY_ENABLED
+    case CMD_OP_RELAY_MODE:
+    {
+        if (args_len < 1)
+        {
+            return NRF_ERROR_INVALID_LENGTH;
+        }
+        ret_code_t err_code = relay_mode_set(p_args[0]);
+        VERIFY_SUCCESS(err_code);
+        return relay_status_reply();
+    }
+
+    case CMD_OP_RELAY_STATUS:
+        return relay_status_reply();
+#endif
+
+    default:
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+}
+
+static void command_event_handler(void *p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(event_size);
+
+    command_t const *p_cmd = (command_t const *)p_event_data;
+    ret_code_t       err_code;
+
+    if (p_cmd->executed)
+    {
+        err_code = p_cmd->result;
+        actuation_report(p_cmd, err_code, p_cmd->rx_ticks + p_cmd->pin_delay);
+    }
+    else
+    {
+        err_code = command_execute(p_cmd);
+    }
+
+    if (err_code != NRF_SUCCESS)
+    {
+        metrics_inc(METRIC_COMMANDS_FAILED);
+    }
+    LOG_ERROR("Command", err_code);
+}
+
+/**
+ * @brief 初始化命令模块，需要在app_timer_init之后、fds_init之前调用。
+ */
+ret_code_t command_init(void)
+{
+    ret_code_t err_code;
+
+    err_code = timed_action_init(timed_action_fired_handler);
+    VERIFY_SUCCESS(err_code);
+
+#if DFU_DELTA_ENABLED
+    err_code = dfu_delta_bank_init(delta_status_handler);
+    VERIFY_SUCCESS(err_code);
+#endif
+
+#if POWER_METER_ENABLED
+    err_code = power_meter_init(power_state_handler);
+    VERIFY_SUCCESS(err_code);
+#endif
+
+#if JOURNAL_ENABLED
+    err_code = journal_init();
+    VERIFY_SUCCESS(err_code);
+#endif
+
+#if GROUP_ENABLED
+    err_code = group_init(group_fired_handler);
+    VERIFY_SUCCESS(err_code);
+#endif
+
+#if RELAY_ENABLED
+    err_code = relay_init(relay_fired_handler);
+    VERIFY_SUCCESS(err_code);
+#endif
+
+    // 计划表在fds_init完成后从flash中读取。
+    return schedule_init(schedule_fired_handler);
+}
+
+/**
+ * @brief 输出通道命令放入最高优先级的通道，不会排在查询、差分升级数据和日志之后。
+ */
+static event_lane_t command_lane(command_t const *p_cmd, uint16_t event_size)
+{
+    switch (p_cmd->data[0])
+    {
+    case CMD_OP_PULSE:
+    case CMD_OP_PRESS:
+    case CMD_OP_RELEASE:
+    case CMD_OP_PULSE_AT:
+    case CMD_OP_CANCEL_AT:
+        // 带多余数据的命令放不进小槽，按普通命令处理。
+        return (event_size <= EVENT_QUEUE_ACTUATION_SLOT_SIZE) ? EVENT_LANE_ACTUATION : EVENT_LANE_BLE;
+
+    default:
+        return EVENT_LANE_BLE;
+    }
+}
+
+/**
+ * @brief 将命令投递到事件队列，在主循环中执行。
+ *
+ * @details 可以在BLE事件中断上下文中调用，收到命令的时间在这里记录，用于计算单向延迟。
+ *          开启COMMAND_FAST_PATH_ENABLED时按下、松开和脉冲命令在这里直接执行，
+ *          此时返回错误只表示结果无法上报，引脚动作已经完成。
+ */
+ret_code_t command_submit(uint16_t conn_handle, uint8_t const *p_data, uint16_t len)
+{
+    command_t  cmd;
+    ret_code_t err_code;
+    uint16_t   event_size = offsetof(command_t, data) + len;
+
+    metrics_inc(METRIC_COMMANDS_RECEIVED);
+
+    if (len == 0 || len > COMMAND_MAX_LEN)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    cmd.rx_ticks = time_sync_local_ticks();
+    cmd.executed = false;
+    cmd.conn_handle = conn_handle;
+    cmd.len = len;
+    memcpy(cmd.data, p_data, len);
+
+#if COMMAND_FAST_PATH_ENABLED
+    actuation_fast_execute(&cmd);
+#endif
+
+    err_code = event_queue_put(command_lane(&cmd, event_size), &cmd, event_size, command_event_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        metrics_inc(METRIC_COMMANDS_DROPPED);
+    }
+
+    return err_code;
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#ifndef COMMAND_FAST_PATH_ENABLED
+#define COMMAND_FAST_PATH_ENABLED 1 /**< 按下、松开和脉冲命令在BLE事件中直接驱动引脚，主循环只负责上报结果。 */
+#endif
+
+#define COMMAND_MAX_LEN 180 /**< 单条命令的最大长度（字节），加上command_t的头部不能超过EVENT_QUEUE_BLE_SLOT_SIZE。 */
+
+/**
+ * @brief 命令操作码，命令格式为：[操作码][参数...]，多字节参数均为小端序。
+ */
+typedef enum
+{
+    CMD_OP_PULSE = 0x01,   /**< [通道][时长ms:u16]，输出一个脉冲。 */
+    CMD_OP_PRESS = 0x02,   /**< [通道]，按下直到收到CMD_OP_RELEASE。 */
+    CMD_OP_RELEASE = 0x03, /**< [通道]，松开。 */
+    CMD_OP_PULSE_AT = 0x04,  /**< [通道][时长ms:u16][主机时间us:u64][标识:u16]，在指定的主机时间输出脉冲。 */
+    CMD_OP_CANCEL_AT = 0x05, /**< [标识:u16]，取消等待中的定时脉冲。 */
+
+    CMD_OP_TIME_PING = 0x10,   /**< [t1主机发送时间us:u64]，设备回复EVT_TIME_PONG。 */
+    CMD_OP_TIME_SAMPLE = 0x11, /**< [t1:u64][t2:u64][t3:u64][t4主机接收时间us:u64]，t2、t3原样取自EVT_TIME_PONG。 */
+    CMD_OP_TIME_STATUS = 0x12, /**< 查询时间同步状态，设备回复EVT_TIME_STATUS。 */
+
+    CMD_OP_SCHEDULE_SET = 0x20, /**< [序号:u8][规则:12字节]，设置并保存一条计划规则，类型为0时删除。 */
+    CMD_OP_SCHEDULE_GET = 0x21, /**< [序号:u8]，设备回复EVT_SCHEDULE_RULE。 */
+    CMD_OP_SCHEDULE_TZ = 0x22,  /**< [时区偏移分钟:i16]，每天规则按该时区的本地时间执行。 */
+
+    CMD_OP_LINK_INFO = 0x30, /**< 查询协商后的链路参数，设备回复EVT_LINK_INFO。 */
+    CMD_OP_PHY_STATS = 0x31, /**< 查询PHY策略的统计，设备回复EVT_PHY_STATS。 */
+    CMD_OP_TX_POWER = 0x32,  /**< [广播发射功率dBm:i8]（可选），设置后回复EVT_TX_POWER，不带参数时只查询。 */
+
+    CMD_OP_DELTA_BEGIN = 0x40,    /**< [差分包头部:24字节]，开始差分升级，设备回复EVT_DELTA_STATUS。 */
+    CMD_OP_DELTA_DATA = 0x41,     /**< [偏移:u32][数据...]，差分包头部之后的数据，出错时回复EVT_DELTA_STATUS。 */
+    CMD_OP_DELTA_ACTIVATE = 0x42, /**< 新镜像校验通过后切换，设备写入bootloader设置后复位。 */
+    CMD_OP_DELTA_STATUS = 0x43,   /**< 查询差分升级状态，设备回复EVT_DELTA_STATUS。 */
+
+    CMD_OP_PROFILE = 0x50,       /**< [序号:u8]，设备回复该统计项的EVT_PROFILE，序号为0时同时把所有统计输出到日志。 */
+    CMD_OP_PROFILE_RESET = 0x51, /**< 清除所有执行时间统计。 */
+    CMD_OP_BOOT_TIME = 0x52,     /**< 查询启动各阶段的时间，设备回复EVT_BOOT_TIME。 */
+    CMD_OP_POWER_METER = 0x53,   /**< [清除:u8]（可选），查询主机功率，设备回复EVT_POWER_METER，参数为1时回复后清除累计统计。 */
+
+    CMD_OP_ARCHIVE_READ = 0x60,   /**< [游标:u32][最多事件数:u8]，从游标处读取遥测存档，设备回复若干EVT_ARCHIVE_DATA。 */
+    CMD_OP_ARCHIVE_STATUS = 0x61, /**< 查询遥测存档状态，设备回复EVT_ARCHIVE_STATUS。 */
+    CMD_OP_ARCHIVE_FLUSH = 0x62,  /**< 把没有填满的页写入flash，之后可以读到最新的记录；存档失败时先重新挂载。 */
+    CMD_OP_JOURNAL_READ = 0x63,   /**< [序号:u32][最多事件数:u8]，从序号处读取动作日志，设备回复若干EVT_JOURNAL_DATA。 */
+    CMD_OP_JOURNAL_STATUS = 0x64, /**< 查询动作日志状态，设备回复EVT_JOURNAL_STATUS。 */
+
+    CMD_OP_GROUP_SET = 0x70,    /**< [位置:u8][分组:u16]，设置并保存一个分组，分组为0时退出，设备回复EVT_GROUP_STATUS。 */
+    CMD_OP_GROUP_STATUS = 0x71, /**< 查询分组状态，设备回复EVT_GROUP_STATUS。 */
+    CMD_OP_RELAY_MODE = 0x72,   /**< [模式:u8]，设置并保存中继模式（0关闭，1只接收，2转发），设备回复EVT_RELAY_STATUS。 */
+    CMD_OP_RELAY_STATUS = 0x73, /**< 查询中继状态，设备回复EVT_RELAY_STATUS。 */
+} cmd_opcode_t;
+
+/**
+ * @brief 事件类型，通过事件特征值通知，格式为：[事件类型][数据...]。
+ */
+typedef enum
+{
+    EVT_BUTTON = 0x01,      /**< [按键事件:u8][时长ms:u32]，本地按键事件。 */
+    EVT_ACTUATION = 0x02,   /**< [操作码:u8][通道:u8][结果:u8][收到命令的主机时间us:u64][引脚动作的主机时间us:u64]。 */
+    EVT_TIME_PONG = 0x03,   /**< [t1:u64][t2设备接收tick:u64][t3设备发送tick:u64]。 */
+    EVT_TIME_STATUS = 0x04, /**< [已同步:u8][偏移us:i64][漂移ppb:i32][往返us:u32][样本数:u32]。 */
+    EVT_TIMED_FIRED = 0x05,    /**< [标识:u16][通道:u8][结果:u8][计划主机时间us:u64][实际主机时间us:u64]。 */
+    EVT_SCHEDULE_FIRED = 0x06, /**< [序号:u8][通道:u8][结果:u8][执行的主机时间us:u64]。 */
+    EVT_SCHEDULE_RULE = 0x07,  /**< [序号:u8][规则:12字节][下一次执行的主机时间us:u64]，不会执行时为0。 */
+    EVT_LINK_INFO = 0x08,      /**< [MTU:u16][发送载荷:u16][接收载荷:u16][发送PHY:u8][接收PHY:u8][连接间隔1.25ms:u16]。 */
+    EVT_PHY_STATS = 0x09,      /**< [当前PHY:u8][平均RSSI:i8]，再按1M、2M、Coded依次为[发送包数:u32][队列满:u32][超时断开:u16][切换次数:u16]。 */
+    EVT_TX_POWER = 0x0A,       /**< [广播功率dBm:i8][连接功率dBm:i8][降低次数:u16][提高次数:u16][超时断开:u16]。 */
+    EVT_DELTA_STATUS = 0x0B,   /**< [状态:u8][错误:u8][已接收:u32][已还原:u32][已写入:u32]。 */
+    EVT_PROFILE = 0x0C,        /**< [序号:u8][统计项数:u8][类型:u8][key:u32][次数:u32][累计us:u64][最长us:u32]，序号超出时类型为0。 */
+    EVT_BOOT_TIME = 0x0D,      /**< [复位原因:u32][阶段数:u8]，再按阶段依次为[距main开始us:u32]，未完成的阶段为0。 */
+    EVT_POWER_METER = 0x0E,    /**< [状态:u8][主机开机:u8]，再按最近一批、累计依次为[最小mW:u32][最大mW:u32][平均mW:u32]，最后为[样本数:u32][未读到:u32]。 */
+    EVT_POWER_STATE = 0x0F,    /**< [主机开机:u8][变化的主机时间us:u64][功率mW:u32]，主机电源状态变化时发送，未同步时时间为0。 */
+    EVT_ARCHIVE_DATA = 0x10,   /**< [游标:u32][下一个游标:u32][记录...]，记录为[类型:u8][长度:u8][数据...]，没有记录时只有两个游标。 */
+    EVT_ARCHIVE_STATUS = 0x11, /**< [状态:u8][最早的游标:u32][下一条的游标:u32][记录数:u32][丢弃数:u32][写入页数:u32][擦除数:u32]。 */
+    EVT_JOURNAL_DATA = 0x12,   /**< [序号:u32][条目数:u8][条目:16字节...]，条目格式见journal_entry_t，没有更多条目时条目数为0。 */
+    EVT_JOURNAL_STATUS = 0x13, /**< [最早的序号:u32][下一条的序号:u32][丢弃数:u32][写入批次数:u32][回收次数:u32][flash中的批次数:u8][未写入的条目数:u8]。 */
+    EVT_GROUP_STATUS = 0x14,   /**< [扫描中:u8][收到数:u32][执行数:u32]，再按位置依次为[分组:u16][最后序号:u8][结果:u8]。 */
+    EVT_RELAY_STATUS = 0x15,   /**< [模式:u8][开关ID:u32][收到数:u32][重复数:u32][执行数:u32][转发数:u32][丢弃数:u32]。 */
+} evt_type_t;
+
+ret_code_t command_init(void);
+ret_code_t command_submit(uint16_t conn_handle, uint8_t const *p_data, uint16_t len);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include "dfu_delta.h"
+
+#include <string.h>
+
+#include "crc32.h"
+
+#define COPY_OP_LEN 9
+#define INSERT_OP_LEN 3
+
+enum
+{
+    STATE_OP,
+    STATE_COPY,
+    STATE_INSERT,
+    STATE_DONE,
+    STATE_ERROR,
+};
+
+static uint32_t le32_decode(uint8_t const *p_data)
+{
+    return (uint32_t)p_data[0] | ((uint32_t)p_data[1] << 8) | ((uint32_t)p_data[2] << 16) | ((uint32_t)p_data[3] << 24);
+}
+
+static uint16_t le16_decode(uint8_t const *p_data)
+{
+    return (uint16_t)(p_data[0] | (p_data[1] << 8));
+}
+
+static uint32_t min_u32(uint32_t a, uint32_t b)
+{
+    return (a < b) ? a : b;
+}
+
+static uint32_t crc_update(dfu_delta_t const *p_delta, uint8_t const *p_data, uint32_t len)
+{
+    return crc32_compute(p_data, len, (p_delta->out_size == 0) ? NULL : &p_delta->crc);
+}
+
+/**
+ * @brief 解析差分包头部。
+ *
+ * @retval NRF_ERROR_INVALID_LENGTH 数据不足一个头部。
+ * @retval NRF_ERROR_INVALID_DATA   magic或版本不匹配。
+ */
+ret_code_t dfu_delta_header_decode(uint8_t const *p_data, uint32_t len, dfu_delta_header_t *p_header)
+{
+    if (len < DFU_DELTA_HEADER_SIZE)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    if (le32_decode(&p_data[0]) != DFU_DELTA_MAGIC || le16_decode(&p_data[4]) != DFU_DELTA_VERSION)
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    p_header->old_size = le32_decode(&p_data[8]);
+    p_header->old_crc = le32_decode(&p_data[12]);
+    p_header->new_size = le32_decode(&p_data[16]);
+    p_header->new_crc = le32_decode(&p_data[20]);
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 开始还原，检查差分包是否基于当前的旧镜像生成。
+ *
+ * @retval NRF_ERROR_INVALID_DATA 旧镜像的长度或CRC与差分包不符。
+ */
+ret_code_t dfu_delta_init(dfu_delta_t *p_delta, dfu_delta_header_t const *p_header, uint8_t const *p_old, uint32_t old_size)
+{
+    memset(p_delta, 0, sizeof(dfu_delta_t));
+
+    if (p_header->old_size != old_size || crc32_compute(p_old, old_size, NULL) != p_header->old_crc || p_header->new_size == 0)
+    {
+        p_delta->state = STATE_ERROR;
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    p_delta->header = *p_header;
+    p_delta->p_old = p_old;
+    p_delta->state = STATE_OP;
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 解析完整的操作头。
+ */
+static ret_code_t op_start(dfu_delta_t *p_delta)
+{
+    uint32_t len;
+
+    if (p_delta->op[0] == DFU_DELTA_OP_COPY)
+    {
+        p_delta->src = le32_decode(&p_delta->op[1]);
+        len = le32_decode(&p_delta->op[5]);
+        if (p_delta->src > p_delta->header.old_size || len > p_delta->header.old_size - p_delta->src)
+        {
+            return NRF_ERROR_INVALID_DATA;
+        }
+        p_delta->state = STATE_COPY;
+    }
+    else
+    {
+        len = le16_decode(&p_delta->op[1]);
+        p_delta->state = STATE_INSERT;
+    }
+
+    if (len == 0 || len > p_delta->header.new_size - p_delta->out_size)
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    p_delta->remaining = len;
+    p_delta->op_len = 0;
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 消耗差分包数据并输出新镜像，输入用完或输出缓冲区满时返回。
+ *
+ * @details 输入和输出都可以任意分段，COPY操作不需要输入数据，因此输入为空时也可以有输出。
+ *
+ * @param[in]  p_delta    还原状态。
+ * @param[in]  p_in       差分包数据（头部之后的部分）。
+ * @param[in]  in_len     输入长度。
+ * @param[out] p_consumed 已消耗的输入长度。
+ * @param[out] p_out      新镜像的输出缓冲区。
+ * @param[in]  out_len    输出缓冲区长度。
+ * @param[out] p_produced 本次输出的长度。
+ *
+ * @retval NRF_ERROR_INVALID_DATA 差分包格式错误或新镜像CRC不符。
+ */
+ret_code_t dfu_delta_apply(dfu_delta_t *p_delta, uint8_t const *p_in, uint32_t in_len, uint32_t *p_consumed, uint8_t *p_out, uint32_t out_len, uint32_t *p_produced)
+{
+    uint32_t consumed = 0;
+    uint32_t produced = 0;
+    uint32_t n;
+
+    while (p_delta->state != STATE_ERROR && p_delta->state != STATE_DONE)
+    {
+        if (p_delta->state == STATE_OP)
+        {
+            if (consumed == in_len)
+            {
+                break;
+            }
+
+            p_delta->op[p_delta->op_len++] = p_in[consumed++];
+
+            uint8_t op_len = (p_delta->op[0] == DFU_DELTA_OP_COPY) ? COPY_OP_LEN : INSERT_OP_LEN;
+            if (p_delta->op[0] != DFU_DELTA_OP_COPY && p_delta->op[0] != DFU_DELTA_OP_INSERT)
+            {
+                p_delta->state = STATE_ERROR;
+            }
+            else if (p_delta->op_len == op_len && op_start(p_delta) != NRF_SUCCESS)
+            {
+                p_delta->state = STATE_ERROR;
+            }
+            continue;
+        }
+
+        if (produced == out_len)
+        {
+            break;
+        }
+
+        n = min_u32(p_delta->remaining, out_len - produced);
+        if (p_delta->state == STATE_COPY)
+        {
+            memcpy(&p_out[produced], &p_delta->p_old[p_delta->src], n);
+            p_delta->src += n;
+        }
+        else
+        {
+            n = min_u32(n, in_len - consumed);
+            if (n == 0)
+            {
+                break;
+            }
+            memcpy(&p_out[produced], &p_in[consumed], n);
+            consumed += n;
+        }
+
+        p_delta->crc = crc_update(p_delta, &p_out[produced], n);
+        p_delta->out_size += n;
+        p_delta->remaining -= n;
+        produced += n;
+
+        if (p_delta->remaining == 0)
+        {
+            p_delta->state = STATE_OP;
+        }
+        if (p_delta->out_size == p_delta->header.new_size)
+        {
+            p_delta->state = (p_delta->crc == p_delta->header.new_crc) ? STATE_DONE : STATE_ERROR;
+        }
+    }
+
+    *p_consumed = consumed;
+    *p_produced = produced;
+
+    return (p_delta->state == STATE_ERROR) ? NRF_ERROR_INVALID_DATA : NRF_SUCCESS;
+}
+
+/**
+ * @brief 新镜像是否已完整输出并通过CRC校验。
+ */
+bool dfu_delta_is_done(dfu_delta_t const *p_delta)
+{
+    return p_delta->state == STATE_DONE;
+}
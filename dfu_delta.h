@@ -0,0 +1,56 @@
+#ifndef DFU_DELTA_H
+#define DFU_DELTA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+/**
+ * 差分升级包格式（小端序），由tools/dfu_delta.py生成：
+ *
+ * 头部24字节：[magic:u32 "DDLT"][版本:u16][保留:u16][旧镜像长度:u32][旧镜像CRC32:u32][新镜像长度:u32][新镜像CRC32:u32]
+ * 之后是一串操作：
+ *   DFU_DELTA_OP_COPY   [0x01][旧镜像偏移:u32][长度:u32]，从旧镜像复制。
+ *   DFU_DELTA_OP_INSERT [0x02][长度:u16][数据...]，直接写入包中的数据。
+ *
+ * 本文件不依赖SoftDevice和flash，可以在主机上编译测试。
+ */
+
+#define DFU_DELTA_MAGIC 0x544C4444 /**< "DDLT" */
+#define DFU_DELTA_VERSION 1
+#define DFU_DELTA_HEADER_SIZE 24
+
+#define DFU_DELTA_OP_COPY 0x01
+#define DFU_DELTA_OP_INSERT 0x02
+
+typedef struct
+{
+    uint32_t old_size;
+    uint32_t old_crc;
+    uint32_t new_size;
+    uint32_t new_crc;
+} dfu_delta_header_t;
+
+/**
+ * @brief 差分还原的状态，调用者不应直接访问。
+ */
+typedef struct
+{
+    dfu_delta_header_t header;
+    uint8_t const     *p_old;     /**< 旧镜像（flash中的当前应用）。 */
+    uint8_t            state;
+    uint8_t            op[9];     /**< 正在接收的操作头。 */
+    uint8_t            op_len;
+    uint32_t           src;       /**< COPY的旧镜像偏移。 */
+    uint32_t           remaining; /**< 当前操作剩余的字节数。 */
+    uint32_t           out_size;  /**< 已输出的新镜像长度。 */
+    uint32_t           crc;       /**< 已输出数据的CRC32。 */
+} dfu_delta_t;
+
+ret_code_t dfu_delta_header_decode(uint8_t const *p_data, uint32_t len, dfu_delta_header_t *p_header);
+ret_code_t dfu_delta_init(dfu_delta_t *p_delta, dfu_delta_header_t const *p_header, uint8_t const *p_old, uint32_t old_size);
+ret_code_t dfu_delta_apply(dfu_delta_t *p_delta, uint8_t const *p_in, uint32_t in_len, uint32_t *p_consumed, uint8_t *p_out, uint32_t out_len, uint32_t *p_produced);
+bool       dfu_delta_is_done(dfu_delta_t const *p_delta);
+
+#endif
@@ -0,0 +1,365 @@
+#include "dfu_delta_bank.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "app_util.h"
+#include "crc32.h"
+#include "nrf_bootloader_info.h"
+#include "nrf_dfu_settings.h"
+#include "nrf_fstorage.h"
+#include "nrf_fstorage_sd.h"
+#include "nrf_log.h"
+
+#include "dfu_delta.h"
+#include "event_queue.h"
+#include "ram_power.h"
+#include "utils.h"
+
+/**
+ * @brief bank 1的结束地址，FDS占用bootloader之前的页。
+ */
+#define BANK_END (BOOTLOADER_START_ADDR - FDS_VIRTUAL_PAGES * FDS_VIRTUAL_PAGE_SIZE * sizeof(uint32_t))
+
+STATIC_ASSERT(IS_POWER_OF_TWO(DFU_DELTA_BANK_INPUT_SIZE));
+STATIC_ASSERT(DFU_DELTA_BANK_WRITE_SIZE % sizeof(uint32_t) == 0);
+
+static void fstorage_evt_handler(nrf_fstorage_evt_t *p_evt);
+static void flash_done_handler(void *p_event_data, uint16_t event_size);
+
+NRF_FSTORAGE_DEF(nrf_fstorage_t m_fs) = {
+    .evt_handler = fstorage_evt_handler,
+};
+
+EVENT_QUEUE_WORK_DEF(m_flash_done_work, EVENT_LANE_BACKGROUND, flash_done_handler);
+
+static dfu_delta_t                     m_delta;
+static dfu_delta_bank_status_t         m_status;
+static dfu_delta_bank_status_handler_t m_status_handler;
+static uint8_t                         m_input[DFU_DELTA_BANK_INPUT_SIZE]; /**< 差分包接收环形缓冲区。 */
+static uint32_t                        m_write_buf[DFU_DELTA_BANK_WRITE_SIZE / sizeof(uint32_t)];
+static uint32_t                        m_write_len;
+static uint32_t                        m_bank_start; /**< bank 1的起始地址。 */
+static uint32_t                        m_erased_end; /**< 已擦除区域的结束地址。 */
+static bool                            m_flash_busy;
+static bool                            m_bank_ready; /**< bootloader设置和fstorage已初始化。 */
+static volatile nrf_fstorage_evt_id_t  m_flash_evt_id; /**< 完成的flash操作，同一时间只有一个操作。 */
+static volatile ret_code_t             m_flash_result; /**< 完成的flash操作的结果。 */
+
+static void status_report(void)
+{
+    if (m_status_handler != NULL)
+    {
+        m_status_handler(&m_status);
+    }
+}
+
+static void update_fail(ret_code_t err_code)
+{
+    NRF_LOG_WARNING("Delta DFU failed, error %d.", err_code);
+    m_status.state = DFU_DELTA_BANK_FAILED;
+    m_status.result = (uint8_t)err_code;
+    status_report();
+}
+
+/**
+ * @brief 新镜像写完后校验flash中的内容。
+ */
+static void bank_verify(void)
+{
+    dfu_delta_header_t const *p_header = &m_delta.header;
+
+    if (crc32_compute((uint8_t const *)m_bank_start, p_header->new_size, NULL) != p_header->new_crc)
+    {
+        update_fail(NRF_ERROR_INVALID_DATA);
+        return;
+    }
+
+    NRF_LOG_INFO("Delta DFU image verified, %d bytes.", p_header->new_size);
+    m_status.state = DFU_DELTA_BANK_VERIFIED;
+    status_report();
+}
+
+/**
+ * @brief 把写缓冲区写入flash，目标页还没有擦除时先擦除。
+ */
+static void flash_write_start(void)
+{
+    ret_code_t err_code;
+    uint32_t   addr = m_bank_start + m_status.written;
+
+    if (addr + m_write_len > m_erased_end)
+    {
+        err_code = nrf_fstorage_erase(&m_fs, m_erased_end, 1, NULL);
+    }
+    else
+    {
+        // 最后一块按字对齐，补齐的部分保持擦除后的值。
+        uint32_t padded = ALIGN_NUM(sizeof(uint32_t), m_write_len);
+        memset((uint8_t *)m_write_buf + m_write_len, 0xFF, padded - m_write_len);
+        err_code = nrf_fstorage_write(&m_fs, addr, m_write_buf, padded, NULL);
+    }
+
+    if (err_code != NRF_SUCCESS)
+    {
+        update_fail(err_code);
+        return;
+    }
+    m_flash_busy = true;
+}
+
+/**
+ * @brief 还原已收到的差分包数据，凑满一块后写入flash。
+ */
+static void delta_process(void)
+{
+    while (m_status.state == DFU_DELTA_BANK_RECEIVING && !m_flash_busy)
+    {
+        bool done = dfu_delta_is_done(&m_delta);
+
+        if (!done && m_write_len < DFU_DELTA_BANK_WRITE_SIZE)
+        {
+            uint32_t tail = m_status.consumed % DFU_DELTA_BANK_INPUT_SIZE;
+            uint32_t available = MIN(m_status.received - m_status.consumed, DFU_DELTA_BANK_INPUT_SIZE - tail);
+            uint32_t consumed;
+            uint32_t produced;
+
+            ret_code_t err_code = dfu_delta_apply(&m_delta, &m_input[tail], available, &consumed, (uint8_t *)m_write_buf + m_write_len, DFU_DELTA_BANK_WRITE_SIZE - m_write_len, &produced);
+            if (err_code != NRF_SUCCESS)
+            {
+                update_fail(err_code);
+                return;
+            }
+
+            m_status.consumed += consumed;
+            m_write_len += produced;
+            if (consumed != 0 || produced != 0)
+            {
+                continue;
+            }
+        }
+
+        if (m_write_len == DFU_DELTA_BANK_WRITE_SIZE || (done && m_write_len != 0))
+        {
+            flash_write_start();
+        }
+        else if (done)
+        {
+            bank_verify();
+        }
+        // 其余情况等待更多的差分包数据。
+        return;
+    }
+}
+
+static void flash_done_handler(void *p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+
+    m_flash_busy = false;
+
+    if (m_flash_result != NRF_SUCCESS)
+    {
+        update_fail(m_flash_result);
+        return;
+    }
+
+    if (m_flash_evt_id == NRF_FSTORAGE_EVT_ERASE_RESULT)
+    {
+        m_erased_end += CODE_PAGE_SIZE;
+    }
+    else
+    {
+        m_status.written += m_write_len;
+        m_write_len = 0;
+        status_report();
+    }
+
+    delta_process();
+}
+
+/**
+ * @brief flash操作完成，在SoftDevice事件中断中调用，转到主循环继续处理。
+ *
+ * @details 丢失完成事件后升级会一直等待，使用不占用通道槽的工作项，通道已满时也能提交。
+ */
+static void fstorage_evt_handler(nrf_fstorage_evt_t *p_evt)
+{
+    m_flash_evt_id = p_evt->id;
+    m_flash_result = p_evt->result;
+    event_queue_work_submit(&m_flash_done_work);
+}
+
+static void settings_written_handler(void *p_buf)
+{
+    UNUSED_PARAMETER(p_buf);
+
+    NRF_LOG_INFO("Bootloader settings written, resetting to activate.");
+    NRF_LOG_FINAL_FLUSH();
+    ram_power_restore();
+    sd_nvic_SystemReset();
+}
+
+/**
+ * @brief 读取bootloader设置并初始化bank 1所在的flash区域，第一次升级时调用。
+ *
+ * @details bank 1紧接在当前应用之后，与bootloader计算的位置相同。当前应用不是通过DFU写入时，
+ *          bootloader设置中没有旧镜像的长度，此时不能进行差分升级。
+ */
+static ret_code_t bank_init(void)
+{
+    ret_code_t err_code;
+
+    err_code = nrf_dfu_settings_init(true);
+    VERIFY_SUCCESS(err_code);
+
+    if (s_dfu_settings.bank_0.image_size == 0)
+    {
+        NRF_LOG_WARNING("Application size unknown, delta DFU disabled.");
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_bank_start = DFU_DELTA_BANK_APP_START + ALIGN_NUM(CODE_PAGE_SIZE, s_dfu_settings.bank_0.image_size);
+    m_fs.start_addr = m_bank_start;
+    m_fs.end_addr = BANK_END;
+
+    err_code = nrf_fstorage_init(&m_fs, &nrf_fstorage_sd, NULL);
+    VERIFY_SUCCESS(err_code);
+
+    m_bank_ready = true;
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 注册状态回调，flash和bootloader设置在第一次升级时才初始化。
+ */
+ret_code_t dfu_delta_bank_init(dfu_delta_bank_status_handler_t status_handler)
+{
+    if (status_handler == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    m_status_handler = status_handler;
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 开始一次差分升级。
+ *
+ * @retval NRF_ERROR_INVALID_STATE 旧镜像长度未知或正在切换。
+ * @retval NRF_ERROR_BUSY          flash操作未完成。
+ * @retval NRF_ERROR_NO_MEM        新镜像超过bank 1的大小。
+ * @retval NRF_ERROR_INVALID_DATA  差分包不是基于当前应用生成的。
+ */
+ret_code_t dfu_delta_bank_begin(uint8_t const *p_header, uint16_t len)
+{
+    ret_code_t         err_code;
+    dfu_delta_header_t header;
+
+    if (m_status.state == DFU_DELTA_BANK_ACTIVATING)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (m_flash_busy)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    if (!m_bank_ready)
+    {
+        err_code = bank_init();
+        VERIFY_SUCCESS(err_code);
+    }
+
+    err_code = dfu_delta_header_decode(p_header, len, &header);
+    VERIFY_SUCCESS(err_code);
+
+    if (header.new_size > BANK_END - m_bank_start)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    memset(&m_status, 0, sizeof(m_status));
+    m_write_len = 0;
+    m_erased_end = m_bank_start;
+
+    err_code = dfu_delta_init(&m_delta, &header, (uint8_t const *)DFU_DELTA_BANK_APP_START, s_dfu_settings.bank_0.image_size);
+    if (err_code != NRF_SUCCESS)
+    {
+        update_fail(err_code);
+        return err_code;
+    }
+
+    NRF_LOG_INFO("Delta DFU started, %d -> %d bytes.", header.old_size, header.new_size);
+    m_status.state = DFU_DELTA_BANK_RECEIVING;
+    status_report();
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 接收一段差分包数据（头部之后的部分）。
+ *
+ * @retval NRF_ERROR_INVALID_PARAM 偏移与已收到的长度不符，主机应从状态中的received处重发。
+ * @retval NRF_ERROR_NO_MEM        接收缓冲区已满，主机应等待consumed增加。
+ */
+ret_code_t dfu_delta_bank_data(uint32_t offset, uint8_t const *p_data, uint16_t len)
+{
+    if (m_status.state != DFU_DELTA_BANK_RECEIVING)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (offset != m_status.received)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (m_status.received - m_status.consumed + len > DFU_DELTA_BANK_INPUT_SIZE)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    for (uint16_t i = 0; i < len; i++)
+    {
+        m_input[(m_status.received + i) % DFU_DELTA_BANK_INPUT_SIZE] = p_data[i];
+    }
+    m_status.received += len;
+
+    delta_process();
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 把校验通过的新镜像标记为有效，bootloader在复位后把它复制到bank 0。
+ *
+ * @details 使用CRC作为应用的启动校验，bootloader需要允许不带签名的应用（NRF_BL_APP_SIGNATURE_CHECK_REQUIRED为0）。
+ */
+ret_code_t dfu_delta_bank_activate(void)
+{
+    if (m_status.state != DFU_DELTA_BANK_VERIFIED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    s_dfu_settings.bank_1.image_size = m_delta.header.new_size;
+    s_dfu_settings.bank_1.image_crc = m_delta.header.new_crc;
+    s_dfu_settings.bank_1.bank_code = NRF_DFU_BANK_VALID_APP;
+    s_dfu_settings.boot_validation_app.type = VALIDATE_CRC;
+    memcpy(s_dfu_settings.boot_validation_app.bytes, &m_delta.header.new_crc, sizeof(uint32_t));
+
+    ret_code_t err_code = nrf_dfu_settings_write_and_backup(settings_written_handler);
+    VERIFY_SUCCESS(err_code);
+
+    m_status.state = DFU_DELTA_BANK_ACTIVATING;
+    status_report();
+
+    return NRF_SUCCESS;
+}
+
+void dfu_delta_bank_status_get(dfu_delta_bank_status_t *p_status)
+{
+    *p_status = m_status;
+}
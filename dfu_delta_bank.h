@@ -0,0 +1,48 @@
+#ifndef DFU_DELTA_BANK_H
+#define DFU_DELTA_BANK_H
+
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#ifndef DFU_DELTA_ENABLED
+#define DFU_DELTA_ENABLED 1 /**< 差分升级命令，由Makefile的FEATURE_DFU控制。 */
+#endif
+
+#define DFU_DELTA_BANK_APP_START 0x26000 /**< 应用的起始地址，与链接脚本中FLASH的起始地址一致。 */
+#define DFU_DELTA_BANK_INPUT_SIZE 512    /**< 差分包接收缓冲区长度，主机未确认的数据不能超过该值。 */
+#define DFU_DELTA_BANK_WRITE_SIZE 1024   /**< 每次写入flash的长度。 */
+
+/**
+ * @brief 差分升级的状态。
+ */
+typedef enum
+{
+    DFU_DELTA_BANK_IDLE,       /**< 没有进行中的升级。 */
+    DFU_DELTA_BANK_RECEIVING,  /**< 正在接收差分包并写入bank 1。 */
+    DFU_DELTA_BANK_VERIFIED,   /**< 新镜像已写入并通过CRC校验，等待切换。 */
+    DFU_DELTA_BANK_ACTIVATING, /**< 正在写入bootloader设置，完成后复位。 */
+    DFU_DELTA_BANK_FAILED,     /**< 出错，需要重新开始。 */
+} dfu_delta_bank_state_t;
+
+typedef struct
+{
+    uint8_t  state;    /**< @ref dfu_delta_bank_state_t */
+    uint8_t  result;   /**< 最近一次错误的低8位。 */
+    uint32_t received; /**< 已收到的差分包长度（不含头部）。 */
+    uint32_t consumed; /**< 已还原的差分包长度，received - consumed不能超过DFU_DELTA_BANK_INPUT_SIZE。 */
+    uint32_t written;  /**< 已写入bank 1的新镜像长度。 */
+} dfu_delta_bank_status_t;
+
+/**
+ * @brief 状态变化时的回调（写入一块flash、完成校验或出错），在主循环中调用。
+ */
+typedef void (*dfu_delta_bank_status_handler_t)(dfu_delta_bank_status_t const *p_status);
+
+ret_code_t dfu_delta_bank_init(dfu_delta_bank_status_handler_t status_handler);
+ret_code_t dfu_delta_bank_begin(uint8_t const *p_header, uint16_t len);
+ret_code_t dfu_delta_bank_data(uint32_t offset, uint8_t const *p_data, uint16_t len);
+ret_code_t dfu_delta_bank_activate(void);
+void       dfu_delta_bank_status_get(dfu_delta_bank_status_t *p_status);
+
+#endif
@@ -0,0 +1,221 @@
+#include "event_queue.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "app_util.h"
+#include "app_util_platform.h"
+
+#include "metrics.h"
+#include "profiler.h"
+
+#define SLOT_WORDS(_size) (ALIGN_NUM(sizeof(uint32_t), (_size)) / sizeof(uint32_t))
+
+/**
+ * @brief 一个事件通道，固定长度的槽组成的环形队列。
+ */
+typedef struct
+{
+    uint32_t              *p_slots;
+    event_queue_handler_t *p_handlers;
+    uint16_t              *p_sizes;
+    uint16_t               slot_words;
+    uint8_t                depth;
+    uint8_t                head;  /**< 下一个要执行的事件。 */
+    volatile uint8_t       count; /**< 等待执行的事件数，执行中的事件在回调返回后才释放。 */
+    uint8_t                high_water;
+    uint32_t               dropped;
+    event_queue_work_t    *p_work_head; /**< 等待执行的工作项。 */
+    event_queue_work_t    *p_work_tail;
+} lane_t;
+
+/**
+ * @brief 定义一个通道的存储空间，槽按字对齐。
+ */
+#define LANE_STORAGE_DEF(_name, _slot_size, _depth)                                                                                                            \
+    static uint32_t              _name##_slots[(_depth)*SLOT_WORDS(_slot_size)];                                                                               \
+    static event_queue_handler_t _name##_handlers[(_depth)];                                                                                                   \
+    static uint16_t              _name##_sizes[(_depth)]
+
+#define LANE_INIT(_name, _slot_size, _depth)                                                                                                                   \
+    {                                                                                                                                                          \
+        .p_slots = _name##_slots, .p_handlers = _name##_handlers, .p_sizes = _name##_sizes, .slot_words = SLOT_WORDS(_slot_size), .depth = (_depth),           \
+    }
+
+LANE_STORAGE_DEF(m_actuation, EVENT_QUEUE_ACTUATION_SLOT_SIZE, EVENT_QUEUE_ACTUATION_DEPTH);
+LANE_STORAGE_DEF(m_ble, EVENT_QUEUE_BLE_SLOT_SIZE, EVENT_QUEUE_BLE_DEPTH);
+LANE_STORAGE_DEF(m_background, EVENT_QUEUE_BACKGROUND_SLOT_SIZE, EVENT_QUEUE_BACKGROUND_DEPTH);
+
+static lane_t m_lanes[EVENT_LANE_COUNT] = {
+    [EVENT_LANE_ACTUATION] = LANE_INIT(m_actuation, EVENT_QUEUE_ACTUATION_SLOT_SIZE, EVENT_QUEUE_ACTUATION_DEPTH),
+    [EVENT_LANE_BLE] = LANE_INIT(m_ble, EVENT_QUEUE_BLE_SLOT_SIZE, EVENT_QUEUE_BLE_DEPTH),
+    [EVENT_LANE_BACKGROUND] = LANE_INIT(m_background, EVENT_QUEUE_BACKGROUND_SLOT_SIZE, EVENT_QUEUE_BACKGROUND_DEPTH),
+};
+
+STATIC_ASSERT(METRIC_QUEUE_BLE_HIGH_WATER == METRIC_QUEUE_ACTUATION_HIGH_WATER + EVENT_LANE_BLE);
+STATIC_ASSERT(METRIC_QUEUE_BACKGROUND_HIGH_WATER == METRIC_QUEUE_ACTUATION_HIGH_WATER + EVENT_LANE_BACKGROUND);
+
+/**
+ * @brief 把事件放入指定通道，可以在任意中断上下文中调用。
+ *
+ * @retval NRF_ERROR_INVALID_LENGTH 事件超过通道的槽长度。
+ * @retval NRF_ERROR_NO_MEM         通道已满。
+ */
+ret_code_t event_queue_put(event_lane_t lane, void const *p_event_data, uint16_t event_size, event_queue_handler_t handler)
+{
+    lane_t    *p_lane = &m_lanes[lane];
+    ret_code_t err_code = NRF_SUCCESS;
+    uint8_t    high_water = 0;
+
+    CRITICAL_REGION_ENTER();
+    if (event_size > p_lane->slot_words * sizeof(uint32_t))
+    {
+        err_code = NRF_ERROR_INVALID_LENGTH;
+        p_lane->dropped++;
+    }
+    else if (p_lane->count == p_lane->depth)
+    {
+        err_code = NRF_ERROR_NO_MEM;
+        p_lane->dropped++;
+    }
+    else
+    {
+        // 在临界区内复制，回调只会在主循环中读取已经写完的槽。
+        uint8_t index = (p_lane->head + p_lane->count) % p_lane->depth;
+        if (event_size != 0)
+        {
+            memcpy(&p_lane->p_slots[index * p_lane->slot_words], p_event_data, event_size);
+        }
+        p_lane->p_handlers[index] = handler;
+        p_lane->p_sizes[index] = event_size;
+        p_lane->count++;
+        if (p_lane->count > p_lane->high_water)
+        {
+            p_lane->high_water = p_lane->count;
+            high_water = p_lane->count;
+        }
+    }
+    CRITICAL_REGION_EXIT();
+
+    if (err_code != NRF_SUCCESS)
+    {
+        metrics_inc(METRIC_QUEUE_DROPPED);
+    }
+    if (high_water != 0)
+    {
+        metrics_gauge_max((metric_id_t)(METRIC_QUEUE_ACTUATION_HIGH_WATER + lane), high_water);
+    }
+
+    return err_code;
+}
+
+/**
+ * @brief 提交工作项，可以在任意中断上下文中调用，不会失败。
+ */
+void event_queue_work_submit(event_queue_work_t *p_work)
+{
+    lane_t *p_lane = &m_lanes[p_work->lane];
+
+    CRITICAL_REGION_ENTER();
+    if (!p_work->pending)
+    {
+        p_work->pending = true;
+        p_work->p_next = NULL;
+        if (p_lane->p_work_tail == NULL)
+        {
+            p_lane->p_work_head = p_work;
+        }
+        else
+        {
+            p_lane->p_work_tail->p_next = p_work;
+        }
+        p_lane->p_work_tail = p_work;
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+/**
+ * @brief 取出通道中第一个等待中的工作项，执行之前清除等待标志，执行期间的提交会再执行一次。
+ */
+static event_queue_work_t *work_take(lane_t *p_lane)
+{
+    event_queue_work_t *p_work;
+
+    CRITICAL_REGION_ENTER();
+    p_work = p_lane->p_work_head;
+    if (p_work != NULL)
+    {
+        p_lane->p_work_head = p_work->p_next;
+        if (p_lane->p_work_head == NULL)
+        {
+            p_lane->p_work_tail = NULL;
+        }
+        p_work->pending = false;
+    }
+    CRITICAL_REGION_EXIT();
+
+    return p_work;
+}
+
+/**
+ * @brief 执行所有等待中的事件，在主循环中调用。
+ *
+ * @details 每执行一个事件后都从最高优先级的通道重新开始，回调中新加入的高优先级事件不会排在低优先级事件之后。
+ */
+void event_queue_execute(void)
+{
+    bool executed;
+
+    do
+    {
+        executed = false;
+
+        for (uint8_t i = 0; i < EVENT_LANE_COUNT; i++)
+        {
+            lane_t             *p_lane = &m_lanes[i];
+            event_queue_work_t *p_work = work_take(p_lane);
+
+            if (p_work != NULL)
+            {
+                PROFILER_START(work_start);
+                p_work->handler(NULL, 0);
+                PROFILER_STOP(PROFILER_KIND_EVENT, (uintptr_t)p_work->handler, work_start);
+
+                executed = true;
+                break;
+            }
+
+            if (p_lane->count == 0)
+            {
+                continue;
+            }
+
+            uint8_t               index = p_lane->head;
+            event_queue_handler_t handler = p_lane->p_handlers[index];
+
+            PROFILER_START(start);
+            handler(&p_lane->p_slots[index * p_lane->slot_words], p_lane->p_sizes[index]);
+            PROFILER_STOP(PROFILER_KIND_EVENT, (uintptr_t)handler, start);
+
+            CRITICAL_REGION_ENTER();
+            p_lane->head = (index + 1) % p_lane->depth;
+            p_lane->count--;
+            CRITICAL_REGION_EXIT();
+
+            executed = true;
+            break;
+        }
+    } while (executed);
+}
+
+void event_queue_stats_get(event_lane_t lane, event_queue_stats_t *p_stats)
+{
+    lane_t const *p_lane = &m_lanes[lane];
+
+    CRITICAL_REGION_ENTER();
+    p_stats->depth = p_lane->depth;
+    p_stats->high_water = p_lane->high_water;
+    p_stats->slot_size = p_lane->slot_words * sizeof(uint32_t);
+    p_stats->dropped = p_lane->dropped;
+    CRITICAL_REGION_EXIT();
+}
@@ -0,0 +1,79 @@
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#ifndef EVENT_QUEUE_ACTUATION_SLOT_SIZE
+#define EVENT_QUEUE_ACTUATION_SLOT_SIZE 32 /**< 输出通道命令（含command_t头部）的最大长度。 */
+#endif
+#ifndef EVENT_QUEUE_ACTUATION_DEPTH
+#define EVENT_QUEUE_ACTUATION_DEPTH 8
+#endif
+#ifndef EVENT_QUEUE_BLE_SLOT_SIZE
+#define EVENT_QUEUE_BLE_SLOT_SIZE 200 /**< 其他命令的最大长度，差分升级数据最长。 */
+#endif
+#ifndef EVENT_QUEUE_BLE_DEPTH
+#define EVENT_QUEUE_BLE_DEPTH 6
+#endif
+#ifndef EVENT_QUEUE_BACKGROUND_SLOT_SIZE
+#define EVENT_QUEUE_BACKGROUND_SLOT_SIZE 32 /**< 日志和flash操作完成事件的最大长度。 */
+#endif
+#ifndef EVENT_QUEUE_BACKGROUND_DEPTH
+#define EVENT_QUEUE_BACKGROUND_DEPTH 8
+#endif
+
+/**
+ * @brief 事件通道，按优先级从高到低排列，主循环总是先执行高优先级通道中的事件。
+ */
+typedef enum
+{
+    EVENT_LANE_ACTUATION,  /**< 输出通道命令。 */
+    EVENT_LANE_BLE,        /**< 其他BLE命令和查询。 */
+    EVENT_LANE_BACKGROUND, /**< 日志发送和flash操作。 */
+    EVENT_LANE_COUNT
+} event_lane_t;
+
+/**
+ * @brief 通道的使用情况。
+ */
+typedef struct
+{
+    uint8_t  depth;      /**< 通道可容纳的事件数。 */
+    uint8_t  high_water; /**< 同时等待的事件数的最大值。 */
+    uint16_t slot_size;  /**< 单个事件的最大长度。 */
+    uint32_t dropped;    /**< 通道已满或事件过长而丢弃的事件数。 */
+} event_queue_stats_t;
+
+/**
+ * @brief 事件回调，在主循环中调用，与app_scheduler的回调相同。
+ */
+typedef void (*event_queue_handler_t)(void *p_event_data, uint16_t event_size);
+
+/**
+ * @brief 工作项，在中断中提交，在主循环中以长度为0的事件执行。
+ *
+ * @details 工作项不占用通道的槽，通道已满时也能提交，用于不能丢失的操作完成通知。执行之前重复提交只执行一次，
+ *          需要传递的数据由提交者自己保存。执行同一通道的事件之前先执行等待中的工作项。
+ */
+typedef struct event_queue_work_s
+{
+    event_queue_handler_t      handler;
+    struct event_queue_work_s *p_next;
+    event_lane_t               lane;
+    volatile bool              pending;
+} event_queue_work_t;
+
+/**
+ * @brief 定义一个工作项。
+ */
+#define EVENT_QUEUE_WORK_DEF(_name, _lane, _handler) static event_queue_work_t _name = {.handler = (_handler), .lane = (_lane)}
+
+ret_code_t event_queue_put(event_lane_t lane, void const *p_event_data, uint16_t event_size, event_queue_handler_t handler);
+void       event_queue_work_submit(event_queue_work_t *p_work);
+void       event_queue_execute(void);
+void       event_queue_stats_get(event_lane_t lane, event_queue_stats_t *p_stats);
+
+#endif
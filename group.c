@@ -0,0 +1,285 @@
+#include "group.h"
+
+#include <string.h>
+
+#include "app_timer.h"
+#include "app_util.h"
+#include "nrf_log.h"
+
+#include "ble_base.h"
+#include "channel.h"
+#include "command.h"
+#include "event_queue.h"
+#include "record_store.h"
+#include "scan.h"
+#include "time_sync.h"
+#include "utils.h"
+
+#define GROUP_TABLE_VERSION 1
+#define ACK_ENTRY_LEN 4 /**< 确认块中每个分组的长度：[分组:u16][序号:u8][结果:u8]。 */
+
+STATIC_ASSERT(1 + GROUP_MAX * ACK_ENTRY_LEN <= BLE_BASE_ADV_APP_DATA_MAX);
+
+/**
+ * @brief 保存在FDS中的分组表。
+ */
+typedef struct
+{
+    uint16_t version;
+    uint16_t groups[GROUP_MAX];
+    uint16_t reserved;
+} group_table_t;
+
+STATIC_ASSERT(sizeof(group_table_t) % sizeof(uint32_t) == 0);
+
+/**
+ * @brief 在BLE事件中收到的分组命令，投递到主循环中执行。
+ */
+typedef struct
+{
+    uint64_t rx_ticks;
+    uint16_t group;
+    uint16_t duration_ms;
+    uint8_t  slot;
+    uint8_t  seq;
+    uint8_t  opcode;
+    uint8_t  channel;
+    bool     holdoff; /**< 在启动保护时间内收到，只确认不执行。 */
+} group_cmd_t;
+
+STATIC_ASSERT(sizeof(group_cmd_t) <= EVENT_QUEUE_ACTUATION_SLOT_SIZE);
+
+static void groups_apply_work_handler(void *p_event_data, uint16_t event_size);
+
+EVENT_QUEUE_WORK_DEF(m_apply_work, EVENT_LANE_BACKGROUND, groups_apply_work_handler);
+
+static group_table_t          m_table;
+__ALIGN(4) static group_table_t m_flash_table; /**< 写入FDS期间保持不变的副本，FDS要求按字对齐。 */
+static group_ack_t            m_acks[GROUP_MAX];
+static bool                   m_seen[GROUP_MAX];     /**< 收到过该分组的命令，m_seen_seq有效。 */
+static uint8_t                m_seen_seq[GROUP_MAX]; /**< 最后交给主循环执行的序号，同一序号的重发只执行一次。 */
+static group_fired_handler_t  m_fired_handler;
+static record_store_t         m_store = {
+    .file_id = GROUP_FILE_ID,
+    .key = GROUP_RECORD_KEY,
+    .version = GROUP_TABLE_VERSION,
+    .length_words = sizeof(group_table_t) / sizeof(uint32_t),
+    .p_data = &m_table,
+    .p_flash = &m_flash_table,
+    .p_name = "Group save",
+};
+static uint32_t               m_received;
+static uint32_t               m_executed;
+
+static bool groups_any(void)
+{
+    for (uint8_t i = 0; i < GROUP_MAX; i++)
+    {
+        if (m_table.groups[i] != GROUP_NONE)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 把各分组最后执行的序号和结果写入广播，主机据此判断哪些开关已经执行。
+ */
+static void ack_update(void)
+{
+    uint8_t data[1 + GROUP_MAX * ACK_ENTRY_LEN] = {GROUP_ACK_MAGIC};
+    uint8_t len = 1;
+
+    for (uint8_t i = 0; i < GROUP_MAX; i++)
+    {
+        if (m_table.groups[i] == GROUP_NONE)
+        {
+            continue;
+        }
+        uint16_encode(m_table.groups[i], &data[len]);
+        data[len + 2] = m_acks[i].seq;
+        data[len + 3] = m_acks[i].result;
+        len += ACK_ENTRY_LEN;
+    }
+
+    LOG_ERROR("Group ack", ble_base_adv_app_data_set(data, (len > 1) ? len : 0));
+}
+
+static void groups_apply_work_handler(void *p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+
+    ack_update();
+    // 有分组时扫描广播命令。
+    scan_user_set(SCAN_USER_GROUP, m_store.ready && groups_any());
+}
+
+/**
+ * @brief 执行一条分组命令，只支持输出通道的即时动作。
+ */
+static ret_code_t group_cmd_execute(group_cmd_t const *p_cmd)
+{
+    switch (p_cmd->opcode)
+    {
+    case CMD_OP_PULSE:
+        return channel_pulse(p_cmd->channel, p_cmd->duration_ms);
+
+    case CMD_OP_PRESS:
+        return channel_press(p_cmd->channel);
+
+    case CMD_OP_RELEASE:
+        return channel_release(p_cmd->channel);
+
+    default:
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+}
+
+static void group_cmd_event_handler(void *p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(event_size);
+
+    group_cmd_t const *p_cmd = (group_cmd_t const *)p_event_data;
+    ret_code_t         result;
+
+    // 排队期间分组可能已经被修改。
+    if (m_table.groups[p_cmd->slot] != p_cmd->group)
+    {
+        return;
+    }
+
+    if (p_cmd->holdoff)
+    {
+        result = NRF_ERROR_INVALID_STATE;
+    }
+    else
+    {
+        result = group_cmd_execute(p_cmd);
+        m_executed++;
+        if (m_fired_handler != NULL)
+        {
+            m_fired_handler(p_cmd->group, p_cmd->opcode, p_cmd->channel, p_cmd->duration_ms, result, p_cmd->rx_ticks);
+        }
+    }
+
+    m_acks[p_cmd->slot].seq = p_cmd->seq;
+    m_acks[p_cmd->slot].result = (uint8_t)result;
+    ack_update();
+}
+
+/**
+ * @brief 检查厂商数据是否为本开关所在分组的命令，在BLE事件中断上下文中调用。
+ *
+ * @details 命令格式为：[标记][分组:u16][序号:u8][操作码][通道][时长ms:u16]。
+ *          主机在一次广播中重复发送同一序号的命令，同一分组只执行序号变化后的第一条。
+ */
+static void scan_report_handler(uint8_t const *p_data, uint16_t len)
+{
+    group_cmd_t cmd;
+
+    if (len != GROUP_CMD_LEN || p_data[0] != GROUP_CMD_MAGIC)
+    {
+        return;
+    }
+
+    cmd.group = uint16_decode(&p_data[1]);
+    if (cmd.group == GROUP_NONE)
+    {
+        return;
+    }
+
+    for (uint8_t i = 0; i < GROUP_MAX; i++)
+    {
+        if (m_table.groups[i] != cmd.group)
+        {
+            continue;
+        }
+
+        m_received++;
+        cmd.seq = p_data[3];
+        if (m_seen[i] && m_seen_seq[i] == cmd.seq)
+        {
+            return;
+        }
+
+        cmd.rx_ticks = time_sync_local_ticks();
+        cmd.slot = i;
+        cmd.opcode = p_data[4];
+        cmd.channel = p_data[5];
+        cmd.duration_ms = uint16_decode(&p_data[6]);
+        cmd.holdoff = (cmd.rx_ticks < APP_TIMER_TICKS(GROUP_BOOT_HOLDOFF_MS));
+
+        // 丢失时不记下序号，主机用同一个序号重发时再执行。
+        if (event_queue_put(EVENT_LANE_ACTUATION, &cmd, sizeof(cmd), group_cmd_event_handler) == NRF_SUCCESS)
+        {
+            m_seen[i] = true;
+            m_seen_seq[i] = cmd.seq;
+        }
+        return;
+    }
+}
+
+static void fds_evt_handler(fds_evt_t const *p_evt)
+{
+    if (record_store_on_fds_evt(&m_store, p_evt))
+    {
+        // 广播数据和扫描在主循环中更新，工作项不占用通道的槽，不会因为通道已满而丢失。
+        event_queue_work_submit(&m_apply_work);
+    }
+}
+
+/**
+ * @brief 初始化分组模块，需要在fds_init之前调用，分组表在FDS初始化完成后读取，之后开始扫描。
+ */
+ret_code_t group_init(group_fired_handler_t fired_handler)
+{
+    m_fired_handler = fired_handler;
+    m_table.version = GROUP_TABLE_VERSION;
+    scan_handler_set(SCAN_USER_GROUP, scan_report_handler);
+
+    return fds_register(fds_evt_handler);
+}
+
+/**
+ * @brief 设置一个分组位置并保存，分组为GROUP_NONE时退出该位置的分组。
+ *
+ * @retval NRF_ERROR_INVALID_PARAM 位置超出范围，或分组已经在其他位置。
+ */
+ret_code_t group_set(uint8_t slot, uint16_t group)
+{
+    if (slot >= GROUP_MAX)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    for (uint8_t i = 0; i < GROUP_MAX; i++)
+    {
+        if (i != slot && group != GROUP_NONE && m_table.groups[i] == group)
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+    }
+
+    m_table.groups[slot] = group;
+    m_seen[slot] = false;
+    memset(&m_acks[slot], 0, sizeof(m_acks[slot]));
+
+    record_store_save(&m_store);
+    groups_apply_work_handler(NULL, 0);
+
+    return NRF_SUCCESS;
+}
+
+void group_status_get(group_status_t *p_status)
+{
+    p_status->scanning = scan_is_running();
+    p_status->received = m_received;
+    p_status->executed = m_executed;
+    for (uint8_t i = 0; i < GROUP_MAX; i++)
+    {
+        p_status->slots[i].group = m_table.groups[i];
+        p_status->slots[i].seq = m_acks[i].seq;
+        p_status->slots[i].result = m_acks[i].result;
+    }
+}
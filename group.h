@@ -0,0 +1,49 @@
+#ifndef GROUP_H
+#define GROUP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#ifndef GROUP_ENABLED
+#define GROUP_ENABLED 1 /**< 分组广播命令，由Makefile的FEATURE_GROUP控制。 */
+#endif
+
+#define GROUP_MAX 4                  /**< 每个开关可以加入的分组数。 */
+#define GROUP_NONE 0                 /**< 空的分组ID。 */
+#define GROUP_FILE_ID 0x4700         /**< 分组表的FDS文件ID。 */
+#define GROUP_RECORD_KEY 0x0001      /**< 分组表的FDS记录键。 */
+#define GROUP_CMD_MAGIC 0xC7         /**< 广播命令的标记。 */
+#define GROUP_ACK_MAGIC 0xA7         /**< 广播中确认块的标记。 */
+#define GROUP_CMD_LEN 8              /**< 广播命令的长度（公司ID之后，字节）。 */
+#define GROUP_BOOT_HOLDOFF_MS 3000   /**< 启动后该时间内只记录收到的序号，不执行，避免复位后重复执行主机还在重发的命令。 */
+
+/**
+ * @brief 分组的状态，与协议中的格式相同。
+ */
+typedef struct
+{
+    uint16_t group;  /**< 分组ID，GROUP_NONE表示空位。 */
+    uint8_t  seq;    /**< 最后执行的命令序号。 */
+    uint8_t  result; /**< 最后执行的结果，0为成功。 */
+} group_ack_t;
+
+typedef struct
+{
+    bool        scanning; /**< 正在扫描广播命令。 */
+    uint32_t    received; /**< 收到的本组命令数（包括重复的广播）。 */
+    uint32_t    executed; /**< 执行的命令数。 */
+    group_ack_t slots[GROUP_MAX];
+} group_status_t;
+
+/**
+ * @brief 分组命令执行后的回调，在主循环中调用。
+ */
+typedef void (*group_fired_handler_t)(uint16_t group, uint8_t opcode, uint8_t channel, uint16_t duration_ms, ret_code_t result, uint64_t rx_ticks);
+
+ret_code_t group_init(group_fired_handler_t fired_handler);
+ret_code_t group_set(uint8_t slot, uint16_t group);
+void       group_status_get(group_status_t *p_status);
+
+#endif
@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""Write the old and new application images that test_dfu_delta patches.
+
+The images are laid out like a build of this application: a vector table pointing into code,
+functions, constant strings and padding. The new image changes a function in the middle, so
+everything after it moves and the vector table entries change. It also edits a string, drops one
+function and appends another. The output is the same on every run:
+
+    dfu_images.py old.bin new.bin
+"""
+
+import random
+import struct
+import sys
+
+VECTORS = 48
+BASE = 0x26000  # application start after the S132 SoftDevice
+
+
+def functions(rng, count):
+    # Thumb code is mostly 16-bit instructions from a small set; repeats keep it compressible.
+    opcodes = [rng.randrange(0x10000) for _ in range(96)]
+    return [b"".join(struct.pack("<H", rng.choice(opcodes)) for _ in range(rng.randrange(40, 400))) for _ in range(count)]
+
+
+def image(funcs, strings):
+    code = bytearray()
+    starts = []
+    for func in funcs:
+        starts.append(len(code))
+        code += func + b"\x70\x47"  # bx lr
+        code += b"\x00" * (-len(code) % 4)
+    rodata = b"".join(s + b"\x00" for s in strings)
+
+    table_size = VECTORS * 4
+    vectors = [0x20010000] + [BASE + table_size + starts[i % len(starts)] + 1 for i in range(VECTORS - 1)]
+    out = struct.pack("<%dI" % VECTORS, *vectors) + code + rodata
+    return out + b"\xff" * (-len(out) % 16)
+
+
+def main():
+    rng = random.Random(1)
+    funcs = functions(rng, 40)
+    strings = [b"Schedule rule %d fired, result %d.", b"Journal write", b"Relay adv", b"Archive mounted, records %d..%d."]
+    old = image(funcs, strings)
+
+    changed = list(funcs)
+    half = len(changed[12]) // 2
+    changed[12] = changed[12][:half] + functions(rng, 1)[0][:60] + changed[12][half:]
+    del changed[30]
+    changed.append(functions(rng, 1)[0])
+    new_strings = list(strings)
+    new_strings[1] = b"Journal batch write"
+    new = image(changed, new_strings)
+
+    for path, data in ((sys.argv[1], old), (sys.argv[2], new)):
+        with open(path, "wb") as f:
+            f.write(data)
+    print("dfu_images: old %d bytes, new %d bytes" % (len(old), len(new)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,8 @@
+#include <stdint.h>
+typedef struct { void (*handler)(int); } observer_t;
+static void on_evt(int id) { (void)id; }
+__attribute__((section(".sdh_ble_observers1"), used)) static observer_t const m_observer = { on_evt };
+const char m_name[] = "ble_computer_switch";
+uint32_t m_counter = 5;
+uint8_t  m_buffer[256];
+int app_main(void) { m_buffer[m_counter] = (uint8_t)m_name[1]; return m_counter++; }
@@ -0,0 +1,4 @@
+#include <stdint.h>
+static uint16_t m_table[64] = {1, 2, 3};
+static uint32_t m_state;
+uint32_t table_sum(void) { uint32_t sum = m_state; for (int i = 0; i < 64; i++) sum += m_table[i]; return sum; }
@@ -0,0 +1,314 @@
+/**
+ * archive.c的主机测试，存储使用archive_ram：追加和读取、写入中断的页、扇区循环擦除、
+ * 失败后重新挂载，以及最早的扇区被覆盖后的读取游标。
+ *
+ * make host_test 编译并运行，返回值非0表示失败。带参数运行时把最后的flash镜像写入该文件，
+ * 从存档中读到的每条记录的类型和数据写入同名的.txt文件，供test_archive_read.py核对tools/archive_read.py。
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "archive.h"
+#include "archive_ram.h"
+
+#define SECTOR_COUNT 4
+#define RECORD_TYPE 0x10
+#define RECORD_LEN 30 /**< 每页放得下7条记录（扇区第一页在扇区头之后也是7条）。 */
+#define RECORDS_PER_SECTOR (16 * 7)
+
+static uint8_t           m_mem[SECTOR_COUNT * ARCHIVE_SECTOR_SIZE];
+static archive_ram_t     m_ram;
+static archive_backend_t m_backend;
+static archive_t         m_archive;
+static uint32_t          m_next;     /**< 下一条记录的编号。 */
+static int               m_failures;
+
+#define CHECK(cond)                                                         \
+    do                                                                      \
+    {                                                                       \
+        if (!(cond))                                                        \
+        {                                                                   \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            m_failures++;                                                   \
+        }                                                                   \
+    } while (0)
+
+/**
+ * @brief 与SDK的crc16_compute相同（CRC-16/CCITT-FALSE），主机上不编译SDK的crc16.c。
+ */
+uint16_t crc16_compute(uint8_t const *p_data, uint32_t size, uint16_t const *p_crc)
+{
+    uint16_t crc = (p_crc == NULL) ? 0xFFFF : *p_crc;
+
+    for (uint32_t i = 0; i < size; i++)
+    {
+        crc = (uint8_t)(crc >> 8) | (crc << 8);
+        crc ^= p_data[i];
+        crc ^= (uint8_t)(crc & 0xFF) >> 4;
+        crc ^= (crc << 8) << 4;
+        crc ^= ((crc & 0xFF) << 4) << 1;
+    }
+
+    return crc;
+}
+
+static void op_done_handler(ret_code_t result)
+{
+    archive_op_done(&m_archive, result);
+}
+
+/**
+ * @brief 记录的数据：编号（小端序）之后是由编号推出的字节，读取时可以逐字节核对。
+ */
+static void record_fill(uint32_t number, uint8_t *p_data)
+{
+    for (uint8_t i = 0; i < RECORD_LEN; i++)
+    {
+        p_data[i] = (i < 4) ? (uint8_t)(number >> (8 * i)) : (uint8_t)(number * 7 + i);
+    }
+}
+
+static uint32_t record_number(uint8_t const *p_record)
+{
+    return (uint32_t)p_record[2] | ((uint32_t)p_record[3] << 8) | ((uint32_t)p_record[4] << 16) | ((uint32_t)p_record[5] << 24);
+}
+
+static bool record_valid(uint8_t const *p_record)
+{
+    uint8_t expected[RECORD_LEN];
+
+    record_fill(record_number(p_record), expected);
+    return p_record[0] == RECORD_TYPE && p_record[1] == RECORD_LEN && memcmp(&p_record[2], expected, RECORD_LEN) == 0;
+}
+
+static void append(uint32_t count)
+{
+    uint8_t data[RECORD_LEN];
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        record_fill(m_next++, data);
+        CHECK(archive_append(&m_archive, RECORD_TYPE, data, RECORD_LEN) == NRF_SUCCESS);
+    }
+}
+
+static void mount(void)
+{
+    archive_ram_init(&m_ram, &m_backend, m_mem, SECTOR_COUNT, op_done_handler);
+    CHECK(archive_init(&m_archive, &m_backend) == NRF_SUCCESS);
+}
+
+/**
+ * @brief 从游标处读到末尾，检查每条记录完整且编号连续。
+ *
+ * @param[out] p_first 第一条记录的编号。
+ * @return 读到的记录数。
+ */
+static uint32_t read_all(uint32_t cursor, uint16_t buffer_len, uint32_t *p_first)
+{
+    uint8_t  buffer[256];
+    uint32_t count = 0;
+    uint32_t expected = 0;
+
+    for (;;)
+    {
+        uint16_t len = buffer_len;
+
+        CHECK(archive_read(&m_archive, &cursor, buffer, &len) == NRF_SUCCESS);
+        if (len == 0)
+        {
+            break;
+        }
+        for (uint16_t offset = 0; offset < len; offset += ARCHIVE_RECORD_HEADER_SIZE + RECORD_LEN)
+        {
+            CHECK(record_valid(&buffer[offset]));
+            if (count == 0)
+            {
+                *p_first = record_number(&buffer[offset]);
+            }
+            else
+            {
+                CHECK(record_number(&buffer[offset]) == expected);
+            }
+            expected = record_number(&buffer[offset]) + 1;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+static void test_append_read(void)
+{
+    uint8_t  buffer[16];
+    uint16_t len = sizeof(buffer);
+    uint32_t cursor = 0;
+    uint32_t first = UINT32_MAX;
+
+    memset(m_mem, 0xFF, sizeof(m_mem));
+    m_next = 0;
+    mount();
+
+    // 还在RAM中的记录也能读到，缓冲区放不下一条记录时游标停在这条记录上。
+    append(10);
+    CHECK(archive_read(&m_archive, &cursor, buffer, &len) == NRF_ERROR_DATA_SIZE);
+    CHECK(cursor == ARCHIVE_SECTOR_HEADER_SIZE);
+    CHECK(read_all(0, 64, &first) == 10 && first == 0);
+
+    // 写满一页以上，再写入未填满的页，重新挂载后从下一页继续。
+    append(10);
+    CHECK(archive_flush(&m_archive) == NRF_SUCCESS);
+    CHECK(m_archive.status.pages == 3 && m_archive.status.erases == 1);
+    mount();
+    append(5);
+    CHECK(read_all(0, sizeof(buffer) * 16, &first) == 25 && first == 0);
+}
+
+static void test_torn_page(void)
+{
+    archive_status_t status;
+    uint32_t         first = UINT32_MAX;
+    uint32_t         torn_first;
+
+    // 接着上一个测试，最后5条记录还在页缓冲区中，写入这一页时写到一半失败。
+    torn_first = m_next - 5;
+    m_ram.fail_after = 1;
+    CHECK(archive_flush(&m_archive) == NRF_SUCCESS);
+    archive_status_get(&m_archive, &status);
+    CHECK(status.state == ARCHIVE_FAILED);
+    CHECK(archive_append(&m_archive, RECORD_TYPE, "x", 1) == NRF_ERROR_INVALID_STATE);
+
+    CHECK(archive_remount(&m_archive) == NRF_SUCCESS);
+    archive_status_get(&m_archive, &status);
+    CHECK(status.state == ARCHIVE_IDLE);
+    CHECK(status.records == 5);
+    CHECK(archive_remount(&m_archive) == NRF_ERROR_INVALID_STATE);
+
+    // 写了一半的页校验失败被跳过，之前的记录不变，之后的记录接在后面。
+    CHECK(read_all(0, 128, &first) == torn_first && first == 0);
+    append(3);
+    CHECK(archive_flush(&m_archive) == NRF_SUCCESS);
+    mount();
+    {
+        uint8_t  buffer[128];
+        uint16_t len;
+        uint32_t cursor = 0;
+        uint32_t total = 0;
+        uint32_t last = 0;
+
+        do
+        {
+            len = sizeof(buffer);
+            CHECK(archive_read(&m_archive, &cursor, buffer, &len) == NRF_SUCCESS);
+            for (uint16_t offset = 0; offset < len; offset += ARCHIVE_RECORD_HEADER_SIZE + RECORD_LEN)
+            {
+                CHECK(record_valid(&buffer[offset]));
+                last = record_number(&buffer[offset]);
+                CHECK(last < torn_first || last >= torn_first + 5);
+                total++;
+            }
+        } while (len > 0);
+        CHECK(total == torn_first + 3);
+        CHECK(last == m_next - 1);
+    }
+}
+
+static void test_wrap(void)
+{
+    archive_status_t status;
+    uint32_t         first = UINT32_MAX;
+    uint32_t         count;
+
+    memset(m_mem, 0xFF, sizeof(m_mem));
+    m_next = 0;
+    mount();
+
+    // 写满所有扇区之后再写一个半扇区，最早的两个扇区被擦除覆盖。
+    append(RECORDS_PER_SECTOR * (SECTOR_COUNT + 1) + RECORDS_PER_SECTOR / 2);
+    CHECK(archive_flush(&m_archive) == NRF_SUCCESS);
+    archive_status_get(&m_archive, &status);
+    CHECK(status.state == ARCHIVE_IDLE);
+    CHECK(status.erases == SECTOR_COUNT + 2);
+    CHECK(status.oldest == 2 * ARCHIVE_SECTOR_SIZE);
+
+    // 游标指向已经被覆盖的扇区时从最早的记录开始。
+    count = read_all(ARCHIVE_SECTOR_SIZE + 100, 200, &first);
+    CHECK(first == 2 * RECORDS_PER_SECTOR);
+    CHECK(first + count == m_next);
+
+    // 重新挂载后最早的扇区和写入位置不变。
+    mount();
+    archive_status_get(&m_archive, &status);
+    CHECK(status.oldest == 2 * ARCHIVE_SECTOR_SIZE);
+    count = read_all(0, 200, &first);
+    CHECK(first == 2 * RECORDS_PER_SECTOR);
+    CHECK(first + count == m_next);
+
+    // 最后加上一个写到一半的页，写出的镜像中也有要跳过的页。
+    append(3);
+    m_ram.fail_after = 1;
+    CHECK(archive_flush(&m_archive) == NRF_SUCCESS);
+    CHECK(archive_remount(&m_archive) == NRF_SUCCESS);
+    append(3);
+    CHECK(archive_flush(&m_archive) == NRF_SUCCESS);
+}
+
+/**
+ * @brief 写出flash镜像，以及从存档中读到的每条记录的类型和数据（十六进制），每行一条。
+ */
+static int dump_write(char const *p_path)
+{
+    char     txt_path[512];
+    uint8_t  buffer[256];
+    uint32_t cursor = 0;
+    uint16_t len;
+    FILE    *p_file;
+
+    p_file = fopen(p_path, "wb");
+    if (p_file == NULL || fwrite(m_mem, 1, sizeof(m_mem), p_file) != sizeof(m_mem))
+    {
+        return 1;
+    }
+    fclose(p_file);
+
+    snprintf(txt_path, sizeof(txt_path), "%s.txt", p_path);
+    p_file = fopen(txt_path, "w");
+    if (p_file == NULL)
+    {
+        return 1;
+    }
+    do
+    {
+        len = sizeof(buffer);
+        CHECK(archive_read(&m_archive, &cursor, buffer, &len) == NRF_SUCCESS);
+        for (uint16_t offset = 0; offset < len; offset += ARCHIVE_RECORD_HEADER_SIZE + buffer[offset + 1])
+        {
+            fprintf(p_file, "%u ", buffer[offset]);
+            for (uint16_t i = 0; i < buffer[offset + 1]; i++)
+            {
+                fprintf(p_file, "%02x", buffer[offset + ARCHIVE_RECORD_HEADER_SIZE + i]);
+            }
+            fprintf(p_file, "\n");
+        }
+    } while (len > 0);
+    fclose(p_file);
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    test_append_read();
+    test_torn_page();
+    test_wrap();
+
+    if (argc > 1 && dump_write(argv[1]) != 0)
+    {
+        printf("archive: cannot write %s\n", argv[1]);
+        m_failures++;
+    }
+
+    printf("archive: %s\n", (m_failures == 0) ? "OK" : "FAILED");
+
+    return (m_failures == 0) ? 0 : 1;
+}
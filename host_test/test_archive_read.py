@@ -0,0 +1,32 @@
+#!/usr/bin/env python3
+"""Check that tools/archive_read.py decodes a flash image written by archive.c.
+
+test_archive writes the image and, next to it, the records archive_read() returned for it:
+
+    test_archive archive.bin && test_archive_read.py archive.bin
+"""
+
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "tools"))
+
+import archive_read  # noqa: E402
+
+
+def main():
+    image_path = sys.argv[1]
+    with open(image_path, "rb") as f:
+        image = f.read()
+    with open(image_path + ".txt") as f:
+        expected = [tuple(line.split()) for line in f if line.strip()]
+
+    decoded = [(str(kind), payload.hex()) for _, kind, payload in archive_read.flash_records(image)]
+    if decoded != expected:
+        mismatch = next((i for i, (a, b) in enumerate(zip(decoded, expected)) if a != b), min(len(decoded), len(expected)))
+        sys.exit("archive_read: %d records decoded, %d expected, first difference at record %d" % (len(decoded), len(expected), mismatch))
+    print("archive_read: OK (%d records)" % len(decoded))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,326 @@
+/**
+ * dfu_delta.c的主机测试：完整还原、数据损坏的差分包和截断的差分包。
+ *
+ * make host_test 编译并运行，返回值非0表示失败。带参数时还用tools/dfu_delta.py生成的差分包测试：
+ *   test_dfu_delta old.bin new.bin delta.bin
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dfu_delta.h"
+
+#define OLD_SIZE 3000
+#define NEW_SIZE 3200
+#define CHUNK_IN 7   /**< 输入和输出都按不整齐的小段喂入，覆盖操作头跨段的情况。 */
+#define CHUNK_OUT 13
+#define FILE_MAX 65536
+
+static uint8_t  m_old[OLD_SIZE];
+static uint8_t  m_new[NEW_SIZE];
+static uint8_t  m_patch[DFU_DELTA_HEADER_SIZE + 2 * 9 + 3 + 400];
+static uint32_t m_patch_len;
+static uint8_t  m_file_old[FILE_MAX];
+static uint8_t  m_file_new[FILE_MAX];
+static uint8_t  m_file_patch[FILE_MAX];
+static uint8_t  m_file_out[FILE_MAX];
+static int      m_failures;
+
+#define CHECK(cond)                                                    \
+    do                                                                 \
+    {                                                                  \
+        if (!(cond))                                                   \
+        {                                                              \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            m_failures++;                                              \
+        }                                                              \
+    } while (0)
+
+/**
+ * @brief 与SDK的crc32_compute相同（CRC-32，多项式0xEDB88320），主机上不编译SDK的crc32.c。
+ */
+uint32_t crc32_compute(uint8_t const *p_data, uint32_t size, uint32_t const *p_crc)
+{
+    uint32_t crc = (p_crc == NULL) ? 0xFFFFFFFF : ~(*p_crc);
+
+    for (uint32_t i = 0; i < size; i++)
+    {
+        crc ^= p_data[i];
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0U - (crc & 1)));
+        }
+    }
+
+    return ~crc;
+}
+
+static void le16_put(uint8_t *p_data, uint16_t value)
+{
+    p_data[0] = (uint8_t)value;
+    p_data[1] = (uint8_t)(value >> 8);
+}
+
+static void le32_put(uint8_t *p_data, uint32_t value)
+{
+    le16_put(&p_data[0], (uint16_t)value);
+    le16_put(&p_data[2], (uint16_t)(value >> 16));
+}
+
+static uint32_t copy_put(uint8_t *p_data, uint32_t src, uint32_t len)
+{
+    p_data[0] = DFU_DELTA_OP_COPY;
+    le32_put(&p_data[1], src);
+    le32_put(&p_data[5], len);
+    return 9;
+}
+
+/**
+ * @brief 新镜像：旧镜像的前1000字节，插入400字节新数据，再接旧镜像的最后1800字节。
+ */
+static void images_build(void)
+{
+    uint8_t *p = m_patch;
+
+    srand(1);
+    for (uint32_t i = 0; i < OLD_SIZE; i++)
+    {
+        m_old[i] = (uint8_t)rand();
+    }
+    memcpy(&m_new[0], &m_old[0], 1000);
+    for (uint32_t i = 1000; i < 1400; i++)
+    {
+        m_new[i] = (uint8_t)rand();
+    }
+    memcpy(&m_new[1400], &m_old[1200], 1800);
+
+    le32_put(&p[0], DFU_DELTA_MAGIC);
+    le16_put(&p[4], DFU_DELTA_VERSION);
+    le16_put(&p[6], 0);
+    le32_put(&p[8], OLD_SIZE);
+    le32_put(&p[12], crc32_compute(m_old, OLD_SIZE, NULL));
+    le32_put(&p[16], NEW_SIZE);
+    le32_put(&p[20], crc32_compute(m_new, NEW_SIZE, NULL));
+    p += DFU_DELTA_HEADER_SIZE;
+
+    p += copy_put(p, 0, 1000);
+    p[0] = DFU_DELTA_OP_INSERT;
+    le16_put(&p[1], 400);
+    memcpy(&p[3], &m_new[1000], 400);
+    p += 3 + 400;
+    p += copy_put(p, 1200, 1800);
+
+    m_patch_len = (uint32_t)(p - m_patch);
+}
+
+/**
+ * @brief 按小段还原差分包，返回最后一次dfu_delta_apply的结果和输出的长度。
+ */
+static ret_code_t delta_run(uint8_t const *p_old, uint32_t old_size, uint8_t const *p_patch, uint32_t len, uint8_t *p_out, uint32_t out_size, uint32_t *p_out_len,
+                            bool *p_done)
+{
+    dfu_delta_header_t header;
+    dfu_delta_t        delta;
+    ret_code_t         err_code;
+    uint32_t           offset = DFU_DELTA_HEADER_SIZE;
+    uint32_t           out_len = 0;
+
+    *p_out_len = 0;
+    *p_done = false;
+
+    err_code = dfu_delta_header_decode(p_patch, len, &header);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    err_code = dfu_delta_init(&delta, &header, p_old, old_size);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    for (;;)
+    {
+        uint32_t in_len = (len - offset < CHUNK_IN) ? len - offset : CHUNK_IN;
+        uint32_t consumed;
+        uint32_t produced;
+        uint32_t room = (out_size - out_len < CHUNK_OUT) ? out_size - out_len : CHUNK_OUT;
+
+        err_code = dfu_delta_apply(&delta, &p_patch[offset], in_len, &consumed, &p_out[out_len], room, &produced);
+        offset += consumed;
+        out_len += produced;
+        if (err_code != NRF_SUCCESS || dfu_delta_is_done(&delta) || (consumed == 0 && produced == 0))
+        {
+            break;
+        }
+    }
+
+    *p_out_len = out_len;
+    *p_done = dfu_delta_is_done(&delta);
+
+    return err_code;
+}
+
+static ret_code_t patch_apply(uint8_t const *p_patch, uint32_t len, uint8_t *p_out, uint32_t *p_out_len, bool *p_done)
+{
+    return delta_run(m_old, OLD_SIZE, p_patch, len, p_out, NEW_SIZE, p_out_len, p_done);
+}
+
+static void test_round_trip(void)
+{
+    static uint8_t out[NEW_SIZE];
+    uint32_t       out_len;
+    bool           done;
+
+    CHECK(patch_apply(m_patch, m_patch_len, out, &out_len, &done) == NRF_SUCCESS);
+    CHECK(done);
+    CHECK(out_len == NEW_SIZE);
+    CHECK(memcmp(out, m_new, NEW_SIZE) == 0);
+}
+
+static void test_corrupted(void)
+{
+    static uint8_t patch[sizeof(m_patch)];
+    static uint8_t out[NEW_SIZE];
+    uint32_t       out_len;
+    bool           done;
+
+    // 插入的数据损坏：格式正确，新镜像的CRC不符。
+    memcpy(patch, m_patch, m_patch_len);
+    patch[DFU_DELTA_HEADER_SIZE + 9 + 3 + 100] ^= 0x01;
+    CHECK(patch_apply(patch, m_patch_len, out, &out_len, &done) == NRF_ERROR_INVALID_DATA);
+    CHECK(!done);
+
+    // COPY超出旧镜像。
+    memcpy(patch, m_patch, m_patch_len);
+    le32_put(&patch[DFU_DELTA_HEADER_SIZE + 1], OLD_SIZE);
+    CHECK(patch_apply(patch, m_patch_len, out, &out_len, &done) == NRF_ERROR_INVALID_DATA);
+    CHECK(!done);
+
+    // 未知的操作码。
+    memcpy(patch, m_patch, m_patch_len);
+    patch[DFU_DELTA_HEADER_SIZE] = 0x7F;
+    CHECK(patch_apply(patch, m_patch_len, out, &out_len, &done) == NRF_ERROR_INVALID_DATA);
+    CHECK(!done);
+
+    // 基于其他旧镜像生成的差分包。
+    memcpy(patch, m_patch, m_patch_len);
+    patch[12] ^= 0x01;
+    CHECK(patch_apply(patch, m_patch_len, out, &out_len, &done) == NRF_ERROR_INVALID_DATA);
+}
+
+static void test_truncated(void)
+{
+    static uint8_t out[NEW_SIZE];
+    uint32_t       out_len;
+    bool           done;
+
+    // 截断在插入的数据中间：没有错误，但新镜像不完整。
+    CHECK(patch_apply(m_patch, DFU_DELTA_HEADER_SIZE + 9 + 3 + 200, out, &out_len, &done) == NRF_SUCCESS);
+    CHECK(!done);
+    CHECK(out_len == 1200);
+
+    // 截断在最后一个操作头中间。
+    CHECK(patch_apply(m_patch, m_patch_len - 4, out, &out_len, &done) == NRF_SUCCESS);
+    CHECK(!done);
+    CHECK(out_len == 1400);
+
+    // 头部不完整。
+    CHECK(patch_apply(m_patch, DFU_DELTA_HEADER_SIZE - 1, out, &out_len, &done) == NRF_ERROR_INVALID_LENGTH);
+}
+
+/**
+ * @brief 读取整个文件，返回长度，失败时返回0。
+ */
+static uint32_t file_read(char const *p_path, uint8_t *p_buf)
+{
+    FILE  *p_file = fopen(p_path, "rb");
+    size_t len;
+
+    if (p_file == NULL)
+    {
+        return 0;
+    }
+    len = fread(p_buf, 1, FILE_MAX, p_file);
+    if (!feof(p_file))
+    {
+        len = 0;
+    }
+    fclose(p_file);
+
+    return (uint32_t)len;
+}
+
+/**
+ * @brief 用dfu_delta.py生成的差分包还原新镜像，再逐个截断和逐字节破坏差分包。
+ *
+ * @details 截断的差分包不报告完成，已输出的部分与新镜像相同。破坏的差分包可能因为旧镜像中有重复的内容而仍然还原出正确的镜像，
+ *          但报告完成时输出一定与新镜像逐字节相同。
+ */
+static void test_tool_patch(char const *p_old_path, char const *p_new_path, char const *p_patch_path)
+{
+    uint32_t   old_size = file_read(p_old_path, m_file_old);
+    uint32_t   new_size = file_read(p_new_path, m_file_new);
+    uint32_t   patch_len = file_read(p_patch_path, m_file_patch);
+    uint32_t   out_len;
+    uint32_t   rejected = 0;
+    bool       done;
+    ret_code_t err_code;
+
+    CHECK(old_size != 0 && new_size != 0 && patch_len > DFU_DELTA_HEADER_SIZE);
+    if (m_failures != 0)
+    {
+        return;
+    }
+
+    CHECK(delta_run(m_file_old, old_size, m_file_patch, patch_len, m_file_out, FILE_MAX, &out_len, &done) == NRF_SUCCESS);
+    CHECK(done);
+    CHECK(out_len == new_size);
+    CHECK(memcmp(m_file_out, m_file_new, new_size) == 0);
+
+    for (uint32_t len = 0; len < patch_len; len++)
+    {
+        err_code = delta_run(m_file_old, old_size, m_file_patch, len, m_file_out, FILE_MAX, &out_len, &done);
+        CHECK(err_code == ((len < DFU_DELTA_HEADER_SIZE) ? NRF_ERROR_INVALID_LENGTH : NRF_SUCCESS));
+        CHECK(!done);
+        CHECK(out_len < new_size && memcmp(m_file_out, m_file_new, out_len) == 0);
+    }
+
+    for (uint32_t i = 0; i < patch_len; i++)
+    {
+        m_file_patch[i] ^= 0x10;
+        err_code = delta_run(m_file_old, old_size, m_file_patch, patch_len, m_file_out, FILE_MAX, &out_len, &done);
+        m_file_patch[i] ^= 0x10;
+
+        if (done)
+        {
+            CHECK(err_code == NRF_SUCCESS && out_len == new_size && memcmp(m_file_out, m_file_new, new_size) == 0);
+        }
+        else
+        {
+            rejected++;
+        }
+    }
+    // 这两个镜像中只有头部的保留字段被破坏时不会被发现。
+    CHECK(rejected == patch_len - 2);
+
+    printf("dfu_delta: %s patch %u bytes, %u of %u corruptions rejected\n", p_patch_path, patch_len, rejected, patch_len);
+}
+
+int main(int argc, char **argv)
+{
+    images_build();
+
+    test_round_trip();
+    test_corrupted();
+    test_truncated();
+
+    if (argc > 3)
+    {
+        test_tool_patch(argv[1], argv[2], argv[3]);
+    }
+
+    printf("dfu_delta: %s\n", (m_failures == 0) ? "OK" : "FAILED");
+
+    return (m_failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,48 @@
+#!/usr/bin/env python3
+"""Check the totals of tools/size_report.py against size -A on a map linked with debug information.
+
+host_test/size_fixture holds a -g3 map and the size -A output of the same image; fixture.ld says
+how to regenerate them.
+"""
+
+import os
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, "..", "tools"))
+
+import size_report  # noqa: E402
+
+
+def size_sections(path):
+    """Return (name, size, address) for each section in size -A output."""
+    sections = []
+    with open(path) as f:
+        for line in f:
+            parts = line.split()
+            if len(parts) == 3 and parts[0].startswith("."):
+                sections.append((parts[0], int(parts[1]), int(parts[2])))
+    return sections
+
+
+def main():
+    fixture = os.path.join(HERE, "size_fixture")
+    total = size_report.totals(size_report.by_object(size_report.parse_map(os.path.join(fixture, "fixture.map"))))
+    sections = size_sections(os.path.join(fixture, "fixture.size"))
+
+    ram = sum(size for _, size, address in sections if address >= size_report.RAM_START)
+    flash = sum(size for _, size, address in sections if 0 < address < size_report.RAM_START)
+    flash += sum(size for name, size, _ in sections if name == ".data")
+
+    failures = []
+    if size_report.flash(total) != flash:
+        failures.append("flash %d, size -A %d" % (size_report.flash(total), flash))
+    if size_report.ram(total) != ram:
+        failures.append("ram %d, size -A %d" % (size_report.ram(total), ram))
+    if failures:
+        sys.exit("size_report: " + "; ".join(failures))
+    print("size_report: OK")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,671 @@
+#include "journal.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "app_error.h"
+#include "app_timer.h"
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "fds.h"
+#include "nrf_log.h"
+
+#include "channel.h"
+#include "event_queue.h"
+#include "schedule.h"
+#include "time_sync.h"
+#include "timed_action.h"
+#include "utils.h"
+
+#define JOURNAL_BATCH_VERSION 1
+
+/**
+ * @brief 在中断中记录、由m_work在主循环中处理的事件。
+ */
+#define WORK_FDS_INIT   (1 << 0)
+#define WORK_FDS_WRITE  (1 << 1)
+#define WORK_FDS_DEL    (1 << 2)
+#define WORK_FDS_GC     (1 << 3)
+#define WORK_FLUSH      (1 << 4)
+#define WORK_RETRY      (1 << 5)
+#define WORK_GC_REQUEST (1 << 6)
+
+/**
+ * @brief 一个批次，保存为一条FDS记录，只写入实际的条目数。
+ */
+typedef struct
+{
+    uint32_t        first_seq; /**< 第一条条目的序号。 */
+    uint16_t        count;
+    uint16_t        version;
+    journal_entry_t entries[JOURNAL_BATCH_SIZE];
+} journal_batch_t;
+
+STATIC_ASSERT(sizeof(journal_entry_t) == 16);
+STATIC_ASSERT(sizeof(journal_entry_t) <= EVENT_QUEUE_BACKGROUND_SLOT_SIZE);
+STATIC_ASSERT(offsetof(journal_batch_t, entries) % sizeof(uint32_t) == 0);
+
+APP_TIMER_DEF(m_flush_timer_id); /**< 最后一条条目之后把未满的批次写入flash。 */
+APP_TIMER_DEF(m_retry_timer_id); /**< 不空闲时稍后重新检查。 */
+
+static void work_handler(void *p_event_data, uint16_t event_size);
+
+EVENT_QUEUE_WORK_DEF(m_work, EVENT_LANE_BACKGROUND, work_handler);
+
+static journal_batch_t     m_batch;       /**< 正在填充的批次。 */
+static journal_batch_t     m_flash_batch; /**< 等待写入或正在写入的批次，写入期间保持不变。 */
+static journal_status_t    m_status;
+static uint32_t            m_oldest_seq; /**< flash中最早的条目的序号。 */
+static uint8_t             m_batches;    /**< flash中的批次数。 */
+static bool                m_fds_ready;
+static bool                m_flush_pending;
+static bool                m_write_in_progress;
+static bool                m_gc_needed;
+static bool                m_gc_in_progress;
+static volatile uint8_t    m_work_flags;   /**< WORK_*，中断中记录的等待处理的事件。 */
+static volatile ret_code_t m_init_result;  /**< FDS初始化的结果。 */
+static volatile ret_code_t m_write_result; /**< 批次写入的结果，同一时间只有一次写入。 */
+
+static uint16_t batch_words(uint16_t count)
+{
+    return (offsetof(journal_batch_t, entries) + count * sizeof(journal_entry_t)) / sizeof(uint32_t);
+}
+
+static uint32_t batch_end(journal_batch_t const *p_batch)
+{
+    return p_batch->first_seq + p_batch->count;
+}
+
+static uint32_t oldest_seq(void)
+{
+    if (m_batches > 0)
+    {
+        return m_oldest_seq;
+    }
+    return m_flush_pending ? m_flash_batch.first_seq : m_batch.first_seq;
+}
+
+/**
+ * @brief 打开一条FDS记录，格式不对时关闭并返回NULL。
+ */
+static journal_batch_t const *batch_open(fds_record_desc_t *p_desc)
+{
+    fds_flash_record_t     flash_record;
+    journal_batch_t const *p_batch;
+
+    if (fds_record_open(p_desc, &flash_record) != NRF_SUCCESS)
+    {
+        return NULL;
+    }
+
+    p_batch = (journal_batch_t const *)flash_record.p_data;
+    if (flash_record.p_header->length_words < batch_words(0) || p_batch->version != JOURNAL_BATCH_VERSION || p_batch->count > JOURNAL_BATCH_SIZE ||
+        flash_record.p_header->length_words < batch_words(p_batch->count))
+    {
+        (void)fds_record_close(p_desc);
+        return NULL;
+    }
+
+    return p_batch;
+}
+
+/**
+ * @brief 遍历flash中的批次，更新批次数和最早的序号。
+ *
+ * @param[out] p_oldest_desc 最早的批次，可以为NULL。
+ * @param[out] p_next        flash中最新的条目之后的序号，可以为NULL。
+ */
+static void batches_scan(fds_record_desc_t *p_oldest_desc, uint32_t *p_next)
+{
+    fds_record_desc_t desc = {0};
+    fds_find_token_t  token = {0};
+    uint32_t          oldest = UINT32_MAX;
+    uint32_t          next = 0;
+    uint8_t           batches = 0;
+
+    while (fds_record_find(JOURNAL_FILE_ID, JOURNAL_RECORD_KEY, &desc, &token) == NRF_SUCCESS)
+    {
+        journal_batch_t const *p_batch = batch_open(&desc);
+
+        if (p_batch == NULL)
+        {
+            continue;
+        }
+        if (p_batch->first_seq < oldest)
+        {
+            oldest = p_batch->first_seq;
+            if (p_oldest_desc != NULL)
+            {
+                *p_oldest_desc = desc;
+            }
+        }
+        next = MAX(next, batch_end(p_batch));
+        batches++;
+        (void)fds_record_close(&desc);
+    }
+
+    m_batches = batches;
+    m_oldest_seq = oldest;
+    if (p_next != NULL)
+    {
+        *p_next = next;
+    }
+}
+
+/**
+ * @brief 从flash中的批次读取条目。
+ *
+ * @details 游标所在的批次已删除或没有写入时，从之后最早的批次开始并更新游标。
+ *
+ * @return 读取的条目数，之后没有批次时为0。
+ */
+static uint8_t flash_read(uint32_t *p_cursor, journal_entry_t *p_entries, uint8_t max)
+{
+    fds_record_desc_t      desc = {0};
+    fds_record_desc_t      found = {0};
+    fds_find_token_t       token = {0};
+    journal_batch_t const *p_batch;
+    uint32_t               start = UINT32_MAX;
+    uint8_t                count;
+
+    while (fds_record_find(JOURNAL_FILE_ID, JOURNAL_RECORD_KEY, &desc, &token) == NRF_SUCCESS)
+    {
+        p_batch = batch_open(&desc);
+        if (p_batch == NULL)
+        {
+            continue;
+        }
+
+        bool hit = (*p_cursor >= p_batch->first_seq && *p_cursor < batch_end(p_batch));
+        if (hit || (p_batch->first_seq > *p_cursor && p_batch->first_seq < start))
+        {
+            start = hit ? *p_cursor : p_batch->first_seq;
+            found = desc;
+        }
+        (void)fds_record_close(&desc);
+
+        if (hit)
+        {
+            break;
+        }
+    }
+
+    if (start == UINT32_MAX || (p_batch = batch_open(&found)) == NULL)
+    {
+        return 0;
+    }
+
+    count = (uint8_t)MIN(max, batch_end(p_batch) - start);
+    memcpy(p_entries, &p_batch->entries[start - p_batch->first_seq], count * sizeof(journal_entry_t));
+    (void)fds_record_close(&found);
+
+    *p_cursor = start;
+
+    return count;
+}
+
+/**
+ * @brief 是否可以操作flash。
+ *
+ * @details 擦除一页时CPU停止运行，期间到期的app_timer中断会推迟，脉冲会变长。
+ *          通道输出中或者有定时脉冲、计划规则即将执行时不写入也不回收。
+ *          连接事件不受影响，SoftDevice把flash操作安排在射频事件的间隙。
+ */
+static bool flash_idle(void)
+{
+    uint64_t        deadline = time_sync_local_ticks() + APP_TIMER_TICKS(JOURNAL_IDLE_GUARD_MS);
+    schedule_rule_t rule;
+    uint64_t        next_ticks;
+
+    for (uint8_t i = 0; i < CHANNEL_COUNT; i++)
+    {
+        if (channel_is_active(i))
+        {
+            return false;
+        }
+    }
+
+    if (timed_action_next_ticks() < deadline)
+    {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < SCHEDULE_MAX_RULES; i++)
+    {
+        if (schedule_rule_get(i, &rule, &next_ticks) == NRF_SUCCESS && next_ticks < deadline)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void retry_start(void)
+{
+    (void)app_timer_stop(m_retry_timer_id);
+    LOG_ERROR("Journal retry timer", app_timer_start(m_retry_timer_id, APP_TIMER_TICKS(JOURNAL_RETRY_MS), NULL));
+}
+
+/**
+ * @brief 写入等待中的批次。保留的批次已满时先删除最早的批次，FDS按顺序执行两个操作。
+ */
+static ret_code_t batch_write(void)
+{
+    fds_record_desc_t  desc = {0};
+    fds_record_t const record = {
+        .file_id = JOURNAL_FILE_ID,
+        .key = JOURNAL_RECORD_KEY,
+        .data.p_data = &m_flash_batch,
+        .data.length_words = batch_words(m_flash_batch.count),
+    };
+    ret_code_t err_code;
+
+    if (m_batches >= JOURNAL_MAX_BATCHES)
+    {
+        batches_scan(&desc, NULL);
+        err_code = fds_record_delete(&desc);
+        VERIFY_SUCCESS(err_code);
+        memset(&desc, 0, sizeof(desc));
+    }
+
+    err_code = fds_record_write(&desc, &record);
+    if (err_code == NRF_SUCCESS)
+    {
+        m_write_in_progress = true;
+    }
+
+    return err_code;
+}
+
+/**
+ * @brief 在空闲时写入等待中的批次，或者回收已删除的批次占用的空间，不空闲时稍后重试。
+ */
+static void flash_work(void)
+{
+    fds_stat_t stat;
+    ret_code_t err_code;
+
+    if (!m_fds_ready || m_write_in_progress || m_gc_in_progress)
+    {
+        return;
+    }
+
+    if (!m_flush_pending && !m_gc_needed)
+    {
+        if (fds_stat(&stat) != NRF_SUCCESS || stat.freeable_words < JOURNAL_GC_WORDS)
+        {
+            return;
+        }
+        m_gc_needed = true;
+    }
+
+    if (!flash_idle())
+    {
+        retry_start();
+        return;
+    }
+
+    if (!m_gc_needed)
+    {
+        err_code = batch_write();
+        if (err_code != FDS_ERR_NO_SPACE_IN_FLASH)
+        {
+            LOG_ERROR("Journal write", err_code);
+            if (err_code != NRF_SUCCESS)
+            {
+                retry_start();
+            }
+            return;
+        }
+        // 空间不足时先回收，回收完成后重试。
+        m_gc_needed = true;
+    }
+
+    err_code = fds_gc();
+    if (err_code == NRF_SUCCESS)
+    {
+        m_gc_in_progress = true;
+    }
+    else
+    {
+        LOG_ERROR("Journal gc", err_code);
+        retry_start();
+    }
+}
+
+/**
+ * @brief 把正在填充的批次交给flash写入，上一个批次还没有写完时等写完后再调用。
+ */
+static void batch_seal(void)
+{
+    if (m_flush_pending || m_batch.count == 0)
+    {
+        return;
+    }
+
+    m_flash_batch = m_batch;
+    m_batch.first_seq += m_batch.count;
+    m_batch.count = 0;
+    m_flush_pending = true;
+
+    (void)app_timer_stop(m_flush_timer_id);
+    flash_work();
+}
+
+static void entry_event_handler(void *p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(event_size);
+
+    if (m_batch.count == JOURNAL_BATCH_SIZE)
+    {
+        m_status.dropped++;
+        return;
+    }
+
+    m_batch.entries[m_batch.count++] = *(journal_entry_t const *)p_event_data;
+
+    if (m_batch.count == JOURNAL_BATCH_SIZE)
+    {
+        batch_seal();
+    }
+    else
+    {
+        (void)app_timer_stop(m_flush_timer_id);
+        LOG_ERROR("Journal flush timer", app_timer_start(m_flush_timer_id, APP_TIMER_TICKS(JOURNAL_FLUSH_DELAY_MS), NULL));
+    }
+}
+
+static void fds_init_done(void)
+{
+    uint32_t next;
+
+    if (m_init_result != NRF_SUCCESS)
+    {
+        return;
+    }
+    m_fds_ready = true;
+    batches_scan(NULL, &next);
+
+    // FDS就绪之前记录的条目接在flash中最新的条目之后。
+    if (m_flush_pending)
+    {
+        m_flash_batch.first_seq = next;
+        next += m_flash_batch.count;
+    }
+    m_batch.first_seq = next;
+    flash_work();
+}
+
+static void write_done(void)
+{
+    m_write_in_progress = false;
+    batches_scan(NULL, NULL);
+    if (m_write_result != NRF_SUCCESS)
+    {
+        LOG_ERROR("Journal write", m_write_result);
+        retry_start();
+        return;
+    }
+    m_flush_pending = false;
+    m_status.writes++;
+    if (m_batch.count == JOURNAL_BATCH_SIZE)
+    {
+        batch_seal();
+    }
+    flash_work();
+}
+
+static void gc_done(void)
+{
+    m_gc_in_progress = false;
+    m_gc_needed = false;
+    m_status.gcs++;
+    flash_work();
+}
+
+/**
+ * @brief 处理中断中记录的事件，与添加和读取条目互斥。FDS先完成删除再完成写入，按同样的顺序处理。
+ */
+static void work_handler(void *p_event_data, uint16_t event_size)
+{
+    uint8_t flags;
+
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+
+    CRITICAL_REGION_ENTER();
+    flags = m_work_flags;
+    m_work_flags = 0;
+    CRITICAL_REGION_EXIT();
+
+    if (flags & WORK_FDS_INIT)
+    {
+        fds_init_done();
+    }
+    if (flags & WORK_FDS_DEL)
+    {
+        batches_scan(NULL, NULL);
+    }
+    if (flags & WORK_FDS_WRITE)
+    {
+        write_done();
+    }
+    if (flags & WORK_FDS_GC)
+    {
+        gc_done();
+    }
+    if (flags & WORK_GC_REQUEST)
+    {
+        m_gc_needed = true;
+    }
+    if (flags & WORK_FLUSH)
+    {
+        batch_seal();
+    }
+    if (flags & (WORK_RETRY | WORK_GC_REQUEST))
+    {
+        flash_work();
+    }
+}
+
+/**
+ * @brief 记录事件并提交工作项，可以在中断中调用。工作项不占用通道的槽，通道被条目占满时也不会丢失完成事件。
+ */
+static void work_submit(uint8_t flags)
+{
+    CRITICAL_REGION_ENTER();
+    m_work_flags |= flags;
+    CRITICAL_REGION_EXIT();
+
+    event_queue_work_submit(&m_work);
+}
+
+/**
+ * @brief FDS事件在SoftDevice事件中断中调用，只处理动作日志自己的记录和所有用户共用的初始化、回收事件。
+ */
+static void fds_evt_handler(fds_evt_t const *p_evt)
+{
+    switch (p_evt->id)
+    {
+    case FDS_EVT_INIT:
+        m_init_result = p_evt->result;
+        work_submit(WORK_FDS_INIT);
+        break;
+
+    case FDS_EVT_WRITE:
+        if (p_evt->write.file_id == JOURNAL_FILE_ID)
+        {
+            m_write_result = p_evt->result;
+            work_submit(WORK_FDS_WRITE);
+        }
+        break;
+
+    case FDS_EVT_DEL_RECORD:
+        if (p_evt->del.file_id == JOURNAL_FILE_ID)
+        {
+            work_submit(WORK_FDS_DEL);
+        }
+        break;
+
+    case FDS_EVT_GC:
+        work_submit(WORK_FDS_GC);
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void flush_timeout_handler(void *p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    work_submit(WORK_FLUSH);
+}
+
+static void retry_timeout_handler(void *p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    work_submit(WORK_RETRY);
+}
+
+/**
+ * @brief 初始化动作日志，需要在app_timer_init之后、fds_init之前调用。
+ */
+ret_code_t journal_init(void)
+{
+    ret_code_t err_code;
+
+    m_batch.version = JOURNAL_BATCH_VERSION;
+
+    err_code = app_timer_create(&m_flush_timer_id, APP_TIMER_MODE_SINGLE_SHOT, flush_timeout_handler);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = app_timer_create(&m_retry_timer_id, APP_TIMER_MODE_SINGLE_SHOT, retry_timeout_handler);
+    VERIFY_SUCCESS(err_code);
+
+    return fds_register(fds_evt_handler);
+}
+
+/**
+ * @brief 记录一次输出动作，可以在中断中调用。条目先放在RAM中，攒满一个批次或者空闲一段时间后写入flash。
+ */
+void journal_add(uint8_t source, uint8_t action, uint8_t channel, uint16_t duration_ms, uint16_t link, ret_code_t result, uint64_t ticks)
+{
+    uint64_t        host_us = 0;
+    journal_entry_t entry = {
+        .uptime_s = (uint32_t)(time_sync_ticks_to_us(ticks) / 1000000),
+        .duration_ms = duration_ms,
+        .link = link,
+        .source = source,
+        .action = action,
+        .channel = channel,
+        .result = (uint8_t)result,
+    };
+
+    if (time_sync_to_host_us(ticks, &host_us))
+    {
+        entry.host_s = (uint32_t)(host_us / 1000000);
+    }
+
+    if (event_queue_put(EVENT_LANE_BACKGROUND, &entry, sizeof(entry), entry_event_handler) != NRF_SUCCESS)
+    {
+        m_status.dropped++;
+    }
+}
+
+/**
+ * @brief 从游标处读取条目，包括还没有写入flash的条目。
+ *
+ * @details 游标早于最早的条目时从最早的条目开始。中间的批次丢失时在空缺处停止，
+ *          下一次读取从空缺之后开始。
+ *
+ * @param[in,out] p_cursor  输入要读取的序号，输出第一条读到的条目的序号。
+ * @param[out]    p_entries 条目。
+ * @param[in,out] p_count   输入最多读取的条目数，输出读到的条目数，没有更多条目时为0。
+ */
+ret_code_t journal_read(uint32_t *p_cursor, journal_entry_t *p_entries, uint8_t *p_count)
+{
+    uint32_t cursor = MAX(*p_cursor, oldest_seq());
+    uint8_t  max = *p_count;
+    uint8_t  count = 0;
+
+    if (!m_fds_ready)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    *p_cursor = cursor;
+
+    while (count < max && cursor < batch_end(&m_batch))
+    {
+        journal_batch_t const *p_batch = NULL;
+        uint32_t               start = cursor;
+        uint8_t                n;
+
+        if (cursor >= m_batch.first_seq)
+        {
+            p_batch = &m_batch;
+        }
+        else if (m_flush_pending && cursor >= m_flash_batch.first_seq)
+        {
+            p_batch = &m_flash_batch;
+        }
+
+        if (p_batch != NULL)
+        {
+            n = (uint8_t)MIN(max - count, batch_end(p_batch) - cursor);
+            memcpy(&p_entries[count], &p_batch->entries[cursor - p_batch->first_seq], n * sizeof(journal_entry_t));
+        }
+        else
+        {
+            n = flash_read(&start, &p_entries[count], max - count);
+            if (n == 0)
+            {
+                // 之后的批次都还在RAM中。
+                start = m_flush_pending ? m_flash_batch.first_seq : m_batch.first_seq;
+            }
+            if (start != cursor)
+            {
+                if (count > 0)
+                {
+                    break;
+                }
+                *p_cursor = start;
+                cursor = start;
+                if (n == 0)
+                {
+                    continue;
+                }
+            }
+        }
+
+        count += n;
+        cursor += n;
+    }
+
+    *p_count = count;
+
+    return NRF_SUCCESS;
+}
+
+void journal_status_get(journal_status_t *p_status)
+{
+    *p_status = m_status;
+    p_status->oldest = oldest_seq();
+    p_status->next = batch_end(&m_batch);
+    p_status->batches = m_batches;
+    p_status->pending = (uint8_t)(m_batch.count + (m_flush_pending ? m_flash_batch.count : 0));
+}
+
+/**
+ * @brief 其他FDS用户空间不足时请求回收，可以在中断中调用。回收与写入批次一样等到空闲时执行，
+ *        完成后所有FDS用户都会收到FDS_EVT_GC。
+ */
+void journal_gc_request(void)
+{
+    work_submit(WORK_GC_REQUEST);
+}
@@ -0,0 +1,66 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#ifndef JOURNAL_ENABLED
+#define JOURNAL_ENABLED 1 /**< 内部flash中的输出动作日志，由Makefile的FEATURE_JOURNAL控制。 */
+#endif
+
+#define JOURNAL_FILE_ID 0x4A00          /**< 动作日志的FDS文件ID。 */
+#define JOURNAL_RECORD_KEY 0x0001       /**< 每个批次一条FDS记录，使用同一个记录键。 */
+#define JOURNAL_BATCH_SIZE 16           /**< 每个批次的条目数，写满后写入flash。 */
+#define JOURNAL_MAX_BATCHES 32          /**< flash中保留的批次数，超出时删除最早的批次。 */
+#define JOURNAL_FLUSH_DELAY_MS 60000    /**< 最后一条条目之后多久把未满的批次写入flash。 */
+#define JOURNAL_IDLE_GUARD_MS 2000      /**< 有脉冲在该时间内开始时推迟写入和回收。 */
+#define JOURNAL_RETRY_MS 500            /**< 不空闲时重新检查的间隔。 */
+#define JOURNAL_GC_WORDS 1024           /**< 可回收的空间超过该值（字）时在空闲时回收。 */
+
+/**
+ * @brief 动作的来源。
+ */
+typedef enum
+{
+    JOURNAL_SOURCE_COMMAND,  /**< BLE命令。 */
+    JOURNAL_SOURCE_TIMED,    /**< 定时脉冲。 */
+    JOURNAL_SOURCE_SCHEDULE, /**< 计划规则。 */
+    JOURNAL_SOURCE_BUTTON,   /**< 本地按键。 */
+    JOURNAL_SOURCE_GROUP,    /**< 分组广播命令。 */
+    JOURNAL_SOURCE_RELAY,    /**< 中继命令。 */
+} journal_source_t;
+
+/**
+ * @brief 日志条目，与协议中的格式相同（小端序，16字节）。条目的序号由所在批次推算，不单独保存。
+ */
+typedef struct
+{
+    uint32_t host_s;      /**< 主机时间（秒），未同步时为0。 */
+    uint32_t uptime_s;    /**< 启动以来的时间（秒）。 */
+    uint16_t duration_ms; /**< 脉冲时长，按下和松开为0。 */
+    uint16_t link;        /**< 命令为对端地址的低16位，定时脉冲为标识，计划规则为序号，分组命令为分组ID，中继命令为消息ID。 */
+    uint8_t  source;      /**< @ref journal_source_t */
+    uint8_t  action;      /**< 操作码（CMD_OP_PULSE等）。 */
+    uint8_t  channel;     /**< 通道编号。 */
+    uint8_t  result;      /**< 执行结果，0为成功。 */
+} journal_entry_t;
+
+typedef struct
+{
+    uint32_t oldest;  /**< 最早的条目的序号。 */
+    uint32_t next;    /**< 下一条条目的序号。 */
+    uint32_t dropped; /**< 写入跟不上而丢弃的条目数。 */
+    uint32_t writes;  /**< 启动以来写入的批次数。 */
+    uint32_t gcs;     /**< 启动以来的回收次数。 */
+    uint8_t  batches; /**< flash中的批次数。 */
+    uint8_t  pending; /**< RAM中还没有写入flash的条目数。 */
+} journal_status_t;
+
+ret_code_t journal_init(void);
+void       journal_add(uint8_t source, uint8_t action, uint8_t channel, uint16_t duration_ms, uint16_t link, ret_code_t result, uint64_t ticks);
+ret_code_t journal_read(uint32_t *p_cursor, journal_entry_t *p_entries, uint8_t *p_count);
+void       journal_status_get(journal_status_t *p_status);
+void       journal_gc_request(void);
+
+#endif
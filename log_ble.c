@@ -0,0 +1,251 @@
+#include "log_ble.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "app_timer.h"
+#include "app_util.h"
+#include "ble.h"
+#include "nrf_log.h"
+#include "nrf_log_backend_interface.h"
+#include "nrf_log_backend_serial.h"
+#include "nrf_log_ctrl.h"
+#include "nrf_sdh_ble.h"
+
+#include "ble_base.h"
+#include "ble_sws.h"
+#include "event_queue.h"
+#include "metrics.h"
+
+STATIC_ASSERT(IS_POWER_OF_TWO(LOG_BLE_BUF_SIZE));
+
+static void log_ble_put(nrf_log_backend_t const *p_backend, nrf_log_entry_t *p_msg);
+static void log_ble_panic_set(nrf_log_backend_t const *p_backend);
+static void log_ble_flush(nrf_log_backend_t const *p_backend);
+
+static const nrf_log_backend_api_t m_log_ble_api = {
+    .put = log_ble_put,
+    .panic_set = log_ble_panic_set,
+    .flush = log_ble_flush,
+};
+
+NRF_LOG_BACKEND_DEF(m_log_ble_backend, m_log_ble_api, NULL);
+APP_TIMER_DEF(m_flush_timer_id);
+
+static uint8_t         m_buf[LOG_BLE_BUF_SIZE]; /**< 格式化后等待发送的日志，按字节组成环形缓冲区。 */
+static uint32_t        m_head;                  /**< 写入的总字节数。 */
+static uint32_t        m_tail;                  /**< 已发送的总字节数。 */
+static uint8_t         m_format_buf[LOG_BLE_FORMAT_BUF_SIZE];
+static bool            m_record_dropped; /**< 当前这条日志放不下，整条丢弃。 */
+static bool            m_throttled;      /**< 发送队列满，等待BLE_GATTS_EVT_HVN_TX_COMPLETE。 */
+static bool            m_flush_pending;
+static bool            m_panic;
+static log_ble_stats_t m_stats;
+
+/**
+ * @brief 格式化输出的回调，把日志文本追加到缓冲区。
+ */
+static void buf_write(void const *p_context, char const *p_str, size_t len)
+{
+    UNUSED_PARAMETER(p_context);
+
+    if (m_record_dropped || len > LOG_BLE_BUF_SIZE - (m_head - m_tail))
+    {
+        m_record_dropped = true;
+        return;
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+        m_buf[(m_head + i) % LOG_BLE_BUF_SIZE] = (uint8_t)p_str[i];
+    }
+    m_head += len;
+}
+
+/**
+ * @brief 计算下一个通知的长度：不超过MTU，尽量在一条日志的结尾处截断。
+ */
+static uint16_t batch_len_get(uint16_t max_len)
+{
+    uint32_t pending = m_head - m_tail;
+
+    if (pending <= max_len)
+    {
+        return (uint16_t)pending;
+    }
+
+    for (uint16_t len = max_len; len > 0; len--)
+    {
+        if (m_buf[(m_tail + len - 1) % LOG_BLE_BUF_SIZE] == '\n')
+        {
+            return len;
+        }
+    }
+
+    // 单条日志超过MTU时分成多个通知发送。
+    return max_len;
+}
+
+/**
+ * @brief 把缓冲区中的日志打包成尽量少的通知发送，发送队列满时暂停。
+ *
+ * @param[in] full_only 为true时只发送凑满一个MTU的部分。
+ */
+static void buf_send(bool full_only)
+{
+    uint8_t              data[BLE_SWS_MAX_DATA_LEN];
+    ble_base_link_info_t link;
+
+    if (m_panic || m_throttled)
+    {
+        return;
+    }
+    if (ble_base_link_info_get(&link) != NRF_SUCCESS)
+    {
+        m_tail = m_head;
+        return;
+    }
+
+    uint16_t max_len = MIN(link.att_mtu - 3, sizeof(data));
+
+    while (m_head != m_tail && !(full_only && m_head - m_tail < max_len))
+    {
+        uint16_t len = batch_len_get(max_len);
+
+        for (uint16_t i = 0; i < len; i++)
+        {
+            data[i] = m_buf[(m_tail + i) % LOG_BLE_BUF_SIZE];
+        }
+
+        ret_code_t err_code = ble_base_log_send(data, len);
+        if (err_code == NRF_SUCCESS)
+        {
+            m_tail += len;
+            m_stats.sent_bytes += len;
+            m_stats.notifications++;
+        }
+        else if (err_code == NRF_ERROR_RESOURCES)
+        {
+            m_throttled = true;
+            m_stats.throttled++;
+            return;
+        }
+        else
+        {
+            // 主机没有订阅日志，丢弃已缓存的内容，避免连接后收到过时的日志。
+            m_tail = m_head;
+            return;
+        }
+    }
+}
+
+static void flush_handler(void *p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+
+    m_flush_pending = false;
+    buf_send(false);
+}
+
+static void flush_timeout_handler(void *p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    if (event_queue_put(EVENT_LANE_BACKGROUND, NULL, 0, flush_handler) != NRF_SUCCESS)
+    {
+        m_flush_pending = false;
+    }
+}
+
+/**
+ * @brief 处理一条日志，在NRF_LOG_PROCESS中调用。
+ */
+static void log_ble_put(nrf_log_backend_t const *p_backend, nrf_log_entry_t *p_msg)
+{
+    uint32_t head = m_head;
+
+    if (m_panic)
+    {
+        return;
+    }
+
+    m_record_dropped = false;
+    nrf_log_backend_serial_put(p_backend, p_msg, m_format_buf, sizeof(m_format_buf), buf_write);
+    if (m_record_dropped)
+    {
+        m_head = head;
+        m_stats.dropped++;
+        metrics_inc(METRIC_LOG_DROPPED);
+    }
+    metrics_gauge_max(METRIC_LOG_BUF_HIGH_WATER, m_head - m_tail);
+
+    // 凑满一个MTU立即发送，剩余部分等待一小段时间与后面的日志合并。
+    buf_send(true);
+    if (m_head != m_tail && !m_flush_pending)
+    {
+        m_flush_pending = app_timer_start(m_flush_timer_id, APP_TIMER_TICKS(LOG_BLE_FLUSH_DELAY_MS), NULL) == NRF_SUCCESS;
+    }
+}
+
+static void log_ble_panic_set(nrf_log_backend_t const *p_backend)
+{
+    UNUSED_PARAMETER(p_backend);
+
+    // 出错后不能再调用SoftDevice，日志只输出到RTT。
+    m_panic = true;
+}
+
+static void log_ble_flush(nrf_log_backend_t const *p_backend)
+{
+    UNUSED_PARAMETER(p_backend);
+
+    buf_send(false);
+}
+
+static void log_ble_on_ble_evt(ble_evt_t const *p_ble_evt, void *p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    switch (p_ble_evt->header.evt_id)
+    {
+    case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+        if (m_throttled)
+        {
+            m_throttled = false;
+            (void)event_queue_put(EVENT_LANE_BACKGROUND, NULL, 0, flush_handler);
+        }
+        break;
+
+    case BLE_GAP_EVT_DISCONNECTED:
+        m_throttled = false;
+        break;
+
+    default:
+        break;
+    }
+}
+
+NRF_SDH_BLE_OBSERVER(m_log_ble_observer, LOG_BLE_BLE_OBSERVER_PRIO, log_ble_on_ble_evt, NULL);
+
+/**
+ * @brief 添加BLE日志后端，需要在NRF_LOG_INIT和app_timer_init之后调用。
+ */
+ret_code_t log_ble_init(void)
+{
+    ret_code_t err_code = app_timer_create(&m_flush_timer_id, APP_TIMER_MODE_SINGLE_SHOT, flush_timeout_handler);
+    VERIFY_SUCCESS(err_code);
+
+    if (nrf_log_backend_add(&m_log_ble_backend, NRF_LOG_SEVERITY_INFO) < 0)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    nrf_log_backend_enable(&m_log_ble_backend);
+
+    return NRF_SUCCESS;
+}
+
+void log_ble_stats_get(log_ble_stats_t *p_stats)
+{
+    *p_stats = m_stats;
+}
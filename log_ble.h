@@ -0,0 +1,31 @@
+#ifndef LOG_BLE_H
+#define LOG_BLE_H
+
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#ifndef LOG_BLE_ENABLED
+#define LOG_BLE_ENABLED 1 /**< 日志通过BLE发送，由Makefile的FEATURE_LOG_BLE控制。 */
+#endif
+
+#ifndef LOG_BLE_BLE_OBSERVER_PRIO
+#define LOG_BLE_BLE_OBSERVER_PRIO 3 /**< BLE日志后端的BLE观察者优先级。 */
+#endif
+
+#define LOG_BLE_BUF_SIZE 1024      /**< 等待发送的日志缓冲区长度，必须是2的幂。 */
+#define LOG_BLE_FLUSH_DELAY_MS 20  /**< 不足一个MTU的日志最多等待的时间（毫秒）。 */
+#define LOG_BLE_FORMAT_BUF_SIZE 64 /**< 格式化日志时使用的临时缓冲区长度。 */
+
+typedef struct
+{
+    uint32_t sent_bytes;    /**< 已发送的日志字节数。 */
+    uint32_t notifications; /**< 已发送的通知数量。 */
+    uint32_t dropped;       /**< 缓冲区满时丢弃的日志条数。 */
+    uint32_t throttled;     /**< 发送队列满而暂停发送的次数。 */
+} log_ble_stats_t;
+
+ret_code_t log_ble_init(void);
+void       log_ble_stats_get(log_ble_stats_t *p_stats);
+
+#endif
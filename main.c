@@ -3,13 +3,11 @@
 #include <stdio.h>
 #include <time.h>
 
-#include "app_scheduler.h"
 #include "app_timer.h"
 #include "ble_types.h"
 #include "boards.h"
 
 #include "nrf_delay.h"
-#include "nrf_drv_saadc.h"
 #include "nrf_drv_wdt.h"
 #include "nrf_gpio.h"
 #include "nrf_log.h"
@@ -21,12 +19,24 @@
 #include "nrf_drv_clock.h"
 #include "nrf_drv_gpiote.h"
 #include "nrf_pwr_mgmt.h"
+#include "fds.h"
 
 #include "utils.h"
 #include "ble_base.h"
-
-#define SCHED_QUEUE_SIZE 20           /**< Maximum number of events in the scheduler queue. */
-#define SCHED_MAX_EVENT_DATA_SIZE 192 /**< Maximum size of scheduler events. */
+#include "boot_time.h"
+#include "button.h"
+#include "channel.h"
+#include "command.h"
+#include "event_queue.h"
+#include "journal.h"
+#include "log_ble.h"
+#include "metrics.h"
+#include "power_stats.h"
+#include "profiler.h"
+#include "ram_power.h"
+#include "stack_monitor.h"
+#include "telemetry.h"
+#include "time_sync.h"
 
 #define TIME_UPDATE_INTERVAL APP_TIMER_TICKS(1000) /**< Time update interval (ticks). */
 
@@ -34,14 +44,12 @@ nrf_drv_wdt_channel_id m_channel_id;   // 看门狗。
 APP_TIMER_DEF(m_time_update_timer_id); /**< Time update timer. */
 
 /**
- * @brief 初始化日志模块
+ * @brief 初始化日志模块，后端在开始广播之后初始化，之前的日志暂存在缓冲区中。
  */
 static void log_init(void)
 {
     ret_code_t err_code = NRF_LOG_INIT(NULL);
     APP_ERROR_CHECK(err_code);
-
-    NRF_LOG_DEFAULT_BACKENDS_INIT();
 }
 
 /**
@@ -55,34 +63,48 @@ static void time_update_handler(void *p_context)
     UNUSED_PARAMETER(p_context);
 
     nrf_drv_wdt_channel_feed(m_channel_id); // 喂狗
+
+    // 定期读取RTC，保证64位本地时间的扩展不会漏掉溢出。
+    (void)time_sync_local_ticks();
 }
 
 /**
- * @brief 处理GPIO输入事件的函数。
+ * @brief 处理按键事件的函数。
+ *
+ * @details 消抖后的按下/松开直接映射到电源通道，分类后的按键事件通过BLE通知上报。
  */
-static void input_pin_handler(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+static void button_evt_handler(button_evt_t const *p_evt)
 {
     ret_code_t err_code;
-    NRF_LOG_DEBUG("input_pin_handler: %d, %d", pin, action);
-    switch (pin)
-    {
-    case BOADER_BUTTON_PIN:
+    NRF_LOG_DEBUG("button_evt_handler: %d, %d ms", p_evt->type, p_evt->duration_ms);
+    metrics_inc(METRIC_BUTTON_EVENTS);
+    switch (p_evt->type)
     {
-        if (nrf_gpio_pin_read(BOADER_BUTTON_PIN))
-        {
-            // 松开
-            nrf_gpio_cfg(BOADER_CONTROL_PIN, NRF_GPIO_PIN_DIR_INPUT, NRF_GPIO_PIN_INPUT_DISCONNECT, NRF_GPIO_PIN_NOPULL, NRF_GPIO_PIN_S0S1, NRF_GPIO_PIN_NOSENSE);
-        }
-        else
-        {
-            // 按下
-            nrf_gpio_cfg(BOADER_CONTROL_PIN, NRF_GPIO_PIN_DIR_OUTPUT, NRF_GPIO_PIN_INPUT_DISCONNECT, NRF_GPIO_PIN_PULLDOWN, NRF_GPIO_PIN_S0S1, NRF_GPIO_PIN_NOSENSE);
-        }
+    case BUTTON_EVT_PRESSED:
+        err_code = channel_press(CHANNEL_POWER);
+        LOG_ERROR("Channel press", err_code);
+#if JOURNAL_ENABLED
+        journal_add(JOURNAL_SOURCE_BUTTON, CMD_OP_PRESS, CHANNEL_POWER, 0, 0, err_code, time_sync_local_ticks());
+#endif
         break;
-    }
+
+    case BUTTON_EVT_RELEASED:
+        err_code = channel_release(CHANNEL_POWER);
+        LOG_ERROR("Channel release", err_code);
+#if JOURNAL_ENABLED
+        journal_add(JOURNAL_SOURCE_BUTTON, CMD_OP_RELEASE, CHANNEL_POWER, 0, 0, err_code, time_sync_local_ticks());
+#endif
+        break;
+
     default:
+    {
+        uint8_t evt[6] = {EVT_BUTTON, (uint8_t)p_evt->type};
+        uint32_encode(p_evt->duration_ms, &evt[2]);
+        // 没有连接或通知未开启时直接丢弃
+        (void)ble_base_evt_send(evt, sizeof(evt));
         break;
     }
+    }
 }
 
 /**
@@ -90,23 +112,19 @@ static void input_pin_handler(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t actio
  */
 static void gpio_init()
 {
-    nrf_gpio_cfg(BOADER_CONTROL_PIN, NRF_GPIO_PIN_DIR_INPUT, NRF_GPIO_PIN_INPUT_DISCONNECT, NRF_GPIO_PIN_NOPULL, NRF_GPIO_PIN_S0S1, NRF_GPIO_PIN_NOSENSE);
-
     ret_code_t err_code;
+
+    // 初始化输出通道（依赖app_timer）
+    err_code = channel_init();
+    APP_ERROR_CHECK(err_code);
+
     //初始化GPIOTE程序模块
     err_code = nrf_drv_gpiote_init();
     APP_ERROR_CHECK(err_code);
 
-    // 定义GPIOTE配置结构体，配置为下降沿触发（按键是低电平有效），低精度
-    nrf_drv_gpiote_in_config_t in_config_hitlo = GPIOTE_CONFIG_IN_SENSE_TOGGLE(false);
-    // 开启引脚的上拉电阻
-    in_config_hitlo.pull = NRF_GPIO_PIN_PULLUP;
-
-    // 设置充电状态引脚为GPIOTE输入
-    err_code = nrf_drv_gpiote_in_init(BOADER_BUTTON_PIN, &in_config_hitlo, input_pin_handler);
+    // 初始化按键，内部使用RTC定时采样消抖
+    err_code = button_init(BOADER_BUTTON_PIN, button_evt_handler);
     APP_ERROR_CHECK(err_code);
-    // 使能充电状态引脚感知功能
-    nrf_drv_gpiote_in_event_enable(BOADER_BUTTON_PIN, true);
 }
 
 /**
@@ -150,10 +168,12 @@ static void application_timers_start(void)
  */
 static void idle_state_handle(void)
 {
-    app_sched_execute();
+    event_queue_execute();
     if (NRF_LOG_PROCESS() == false)
     {
+        power_stats_sleep_enter();
         nrf_pwr_mgmt_run();
+        power_stats_sleep_exit();
     }
 }
 
@@ -164,6 +184,7 @@ void wdt_event_handler(void)
 {
     NRF_LOG_WARNING("The system was restarted by WDT!");
     NRF_LOG_PROCESS();
+    ram_power_restore();
     sd_nvic_SystemReset();
 }
 
@@ -190,6 +211,44 @@ static void power_management_init(void)
     APP_ERROR_CHECK(err_code);
 }
 
+/**
+ * @brief 开始广播之后在主循环中执行的初始化，这些模块不影响设备被发现和执行命令。
+ */
+static void deferred_init_handler(void *p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+
+    ret_code_t err_code;
+
+    NRF_LOG_DEFAULT_BACKENDS_INIT();
+#if LOG_BLE_ENABLED
+    // 日志同时通过BLE发送，需要app_timer。
+    err_code = log_ble_init();
+    APP_ERROR_CHECK(err_code);
+#endif
+    NRF_LOG_INFO("Logging on!");
+
+    // 统计睡眠、CPU和射频时间（射频通知依赖SoftDevice）。
+    err_code = power_stats_init();
+    APP_ERROR_CHECK(err_code);
+
+    err_code = ram_power_init();
+    APP_ERROR_CHECK(err_code);
+
+#if TELEMETRY_ENABLED
+    // 没有焊接外部flash时只记录错误，其他功能不受影响。
+    err_code = telemetry_init();
+    LOG_ERROR("Telemetry init", err_code);
+#endif
+
+    // 初始化FDS（依赖SoftDevice），各模块已在此之前注册了FDS事件回调。
+    err_code = fds_init();
+    APP_ERROR_CHECK(err_code);
+
+    boot_time_mark(BOOT_PHASE_DEFERRED);
+}
+
 /*********************************************************************
  *
  *       start_app()
@@ -201,41 +260,60 @@ int main(void)
 {
     ret_code_t err_code;
 
+    // 填充栈，读取指标时统计栈的最大用量。
+    stack_monitor_init();
+
     // 使用DCDC稳压器。
     NRF_POWER->DCDCEN = 1;
 
+    // 开启周期计数器，统计各回调的执行时间。
+    err_code = profiler_init();
+    APP_ERROR_CHECK(err_code);
+
+    // 记录各启动阶段的时间，需要在fds_init之前。
+    err_code = boot_time_init();
+    APP_ERROR_CHECK(err_code);
+
     // 初始化电源管理模块。
     power_management_init();
 
     // 初始化日志模块。
     log_init();
-    NRF_LOG_INFO("Logging on!");
 
     // 初始化定时器。
     timers_init();
+    boot_time_mark(BOOT_PHASE_CLOCK);
 
     // 初始化GPIO引脚。
     gpio_init();
+    boot_time_mark(BOOT_PHASE_GPIO);
+
+    // 初始化命令模块。
+    err_code = command_init();
+    APP_ERROR_CHECK(err_code);
+    boot_time_mark(BOOT_PHASE_COMMAND);
 
     // 初始化看门狗。
     watch_dog_init();
 
-    // 初始化调度器
-    APP_SCHED_INIT(SCHED_MAX_EVENT_DATA_SIZE, SCHED_QUEUE_SIZE);
-
     err_code = ble_base_init();
     APP_ERROR_CHECK(err_code);
+    boot_time_mark(BOOT_PHASE_BLE);
+
+    // 尽快开启广播，断电恢复后主机可以更早发现设备。
+    err_code = advertising_start();
+    LOG_ERROR("Start advertising", err_code);
+    boot_time_mark(BOOT_PHASE_ADVERTISING);
 
     // 启动定时器。
     application_timers_start();
-    NRF_LOG_INFO("application timers started!");
 
     // 开启看门狗。
     nrf_drv_wdt_enable();
 
-    // 开启广播。
-    err_code = advertising_start();
-    LOG_ERROR("Start advertising", err_code);
+    // 日志后端、统计和FDS在主循环中初始化。
+    err_code = event_queue_put(EVENT_LANE_BACKGROUND, NULL, 0, deferred_init_handler);
+    APP_ERROR_CHECK(err_code);
 
     // Enter main loop.
     for (;;)
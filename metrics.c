@@ -0,0 +1,67 @@
+#include "metrics.h"
+
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "nrf_atomic.h"
+
+#include "time_sync.h"
+
+STATIC_ASSERT(METRIC_COUNT <= UINT8_MAX);
+
+static nrf_atomic_u32_t m_values[METRIC_COUNT];
+
+/**
+ * @brief 计数加1，可以在任意中断上下文中调用。
+ */
+void metrics_inc(metric_id_t id)
+{
+    (void)nrf_atomic_u32_add(&m_values[id], 1);
+}
+
+/**
+ * @brief 设置一个量，负数按补码保存。
+ */
+void metrics_gauge_set(metric_id_t id, int32_t value)
+{
+    (void)nrf_atomic_u32_store(&m_values[id], (uint32_t)value);
+}
+
+/**
+ * @brief 只在新值更大时更新，用于记录峰值。
+ */
+void metrics_gauge_max(metric_id_t id, uint32_t value)
+{
+    CRITICAL_REGION_ENTER();
+    if (value > m_values[id])
+    {
+        m_values[id] = value;
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+/**
+ * @brief 生成所有指标的快照（小端序）。
+ *
+ * @return 快照长度，缓冲区不足时为0。
+ */
+uint16_t metrics_snapshot(uint8_t *p_data, uint16_t max_len)
+{
+    uint8_t *p_encoded = p_data;
+
+    if (max_len < METRICS_RECORD_SIZE)
+    {
+        return 0;
+    }
+
+    *p_encoded++ = METRICS_VERSION;
+    *p_encoded++ = METRIC_COUNT;
+    p_encoded += uint16_encode(0, p_encoded);
+    p_encoded += uint32_encode((uint32_t)(time_sync_ticks_to_us(time_sync_local_ticks()) / 1000000), p_encoded);
+
+    for (uint8_t i = 0; i < METRIC_COUNT; i++)
+    {
+        p_encoded += uint32_encode(m_values[i], p_encoded);
+    }
+
+    return (uint16_t)(p_encoded - p_data);
+}
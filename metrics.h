@@ -0,0 +1,61 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+#define METRICS_VERSION 1      /**< 快照格式版本，修改或删除已有的项时加1，只在末尾增加项时不变。 */
+#define METRICS_HEADER_SIZE 8  /**< [版本:u8][数量:u8][保留:u16][运行时间s:u32] */
+
+/**
+ * @brief 指标编号，快照中按编号顺序排列，每项为u32。
+ *
+ * @details tools/metrics_decode.py从本文件读取名称，只能在METRIC_COUNT之前追加。
+ */
+typedef enum
+{
+    METRIC_CONNECTS,          /**< 计数：连接次数。 */
+    METRIC_DISCONNECTS,       /**< 计数：断开次数。 */
+    METRIC_LINK_LOSSES,       /**< 计数：连接超时断开的次数。 */
+    METRIC_GATTC_TIMEOUTS,    /**< 计数：BLE_GATTC_EVT_TIMEOUT。 */
+    METRIC_GATTS_TIMEOUTS,    /**< 计数：BLE_GATTS_EVT_TIMEOUT。 */
+    METRIC_ADV_STARTS,        /**< 计数：开始广播（快速或慢速）的次数。 */
+    METRIC_COMMANDS_RECEIVED, /**< 计数：收到的命令。 */
+    METRIC_COMMANDS_FAILED,   /**< 计数：执行失败的命令。 */
+    METRIC_COMMANDS_DROPPED,  /**< 计数：事件队列满而丢弃的命令。 */
+    METRIC_PULSES,            /**< 计数：输出的脉冲。 */
+    METRIC_PRESSES,           /**< 计数：按下（不限时长）的次数。 */
+    METRIC_BUTTON_EVENTS,     /**< 计数：本地按键的短按、长按和双击。 */
+    METRIC_TIMED_FIRED,       /**< 计数：执行的定时脉冲。 */
+    METRIC_SCHEDULE_FIRED,    /**< 计数：执行的计划规则。 */
+    METRIC_EVT_SEND_FAILED,   /**< 计数：发送事件通知失败的次数。 */
+    METRIC_LOG_DROPPED,       /**< 计数：BLE日志缓冲区满而丢弃的日志。 */
+    METRIC_RSSI,              /**< 量：当前连接的平均RSSI（dBm，有符号）。 */
+    METRIC_CONN_TX_POWER,     /**< 量：当前连接的发射功率（dBm，有符号）。 */
+    METRIC_QUEUE_DROPPED,     /**< 计数：事件队列已满而丢弃的事件。 */
+    METRIC_QUEUE_ACTUATION_HIGH_WATER,  /**< 量：输出通道命令队列的最大深度。 */
+    METRIC_QUEUE_BLE_HIGH_WATER,        /**< 量：BLE命令队列的最大深度。 */
+    METRIC_QUEUE_BACKGROUND_HIGH_WATER, /**< 量：后台事件队列的最大深度。 */
+    METRIC_SLEEP_BP,                    /**< 量：最近窗口内睡眠时间的占比（0.01%）。 */
+    METRIC_MAIN_LOOP_BP,                /**< 量：最近窗口内主循环运行时间的占比（0.01%）。 */
+    METRIC_IRQ_BP,                      /**< 量：最近窗口内中断运行时间的占比（0.01%）。 */
+    METRIC_RADIO_BP,                    /**< 量：最近窗口内射频活动时间的占比（0.01%）。 */
+    METRIC_AVG_CURRENT_NA,              /**< 量：按电流模型估算的最近窗口平均电流（nA）。 */
+    METRIC_TOTAL_AVG_CURRENT_NA,        /**< 量：启动以来的平均电流（nA）。 */
+    METRIC_STACK_HIGH_WATER,            /**< 量：栈的最大用量（字节，包括所有中断），读取指标时更新。 */
+    METRIC_STACK_SIZE,                  /**< 量：栈的大小（字节）。 */
+    METRIC_LOG_BUF_HIGH_WATER,          /**< 量：BLE日志缓冲区的最大占用（字节）。 */
+    METRIC_PROFILER_ENTRIES,            /**< 量：已使用的执行时间统计项数。 */
+    METRIC_BOOT_ADV_US,                 /**< 量：从main开始到开始广播的时间（微秒）。 */
+    METRIC_HOST_POWER_MW,               /**< 量：主机待机电源最近一批样本的平均功率（mW）。 */
+    METRIC_TIMER_QUEUE_HIGH_WATER,      /**< 量：app_timer操作队列的最大深度，读取指标时更新。 */
+    METRIC_COUNT
+} metric_id_t;
+
+#define METRICS_RECORD_SIZE (METRICS_HEADER_SIZE + METRIC_COUNT * sizeof(uint32_t))
+
+void     metrics_inc(metric_id_t id);
+void     metrics_gauge_set(metric_id_t id, int32_t value);
+void     metrics_gauge_max(metric_id_t id, uint32_t value);
+uint16_t metrics_snapshot(uint8_t *p_data, uint16_t max_len);
+
+#endif
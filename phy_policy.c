@@ -0,0 +1,227 @@
+#include "phy_policy.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "app_timer.h"
+#include "ble.h"
+#include "ble_hci.h"
+#include "nrf_log.h"
+#include "nrf_sdh_ble.h"
+
+#include "metrics.h"
+#include "time_sync.h"
+#include "utils.h"
+
+#define RSSI_THRESHOLD_DBM 2 /**< RSSI变化超过该值时才产生事件（dBm）。 */
+#define RSSI_SKIP_COUNT 4    /**< RSSI变化需要持续的采样次数。 */
+#define RSSI_AVG_SHIFT 3     /**< RSSI平均值的平滑系数，新样本权重为1/8。 */
+
+static uint16_t           m_conn_handle = BLE_CONN_HANDLE_INVALID;
+static phy_policy_phy_t   m_start_phy = PHY_POLICY_2M; /**< 新连接请求的PHY，连接超时断开后降一级。 */
+static int16_t            m_rssi_avg_q4;               /**< 平均RSSI，单位为1/16 dBm。 */
+static bool               m_rssi_valid;
+static bool               m_update_pending;
+static uint64_t           m_last_switch_ticks;
+static phy_policy_stats_t m_stats;
+
+static uint8_t phy_to_gap(phy_policy_phy_t phy)
+{
+    switch (phy)
+    {
+    case PHY_POLICY_2M:
+        return BLE_GAP_PHY_2MBPS;
+#if PHY_POLICY_CODED_ENABLED
+    case PHY_POLICY_CODED:
+        return BLE_GAP_PHY_CODED;
+#endif
+    default:
+        return BLE_GAP_PHY_1MBPS;
+    }
+}
+
+static phy_policy_phy_t phy_from_gap(uint8_t gap_phy)
+{
+    switch (gap_phy)
+    {
+    case BLE_GAP_PHY_2MBPS:
+        return PHY_POLICY_2M;
+    case BLE_GAP_PHY_CODED:
+        return PHY_POLICY_CODED;
+    default:
+        return PHY_POLICY_1M;
+    }
+}
+
+/**
+ * @brief 请求切换到指定的PHY，上一次请求完成前不再发起新的请求。
+ */
+static void phy_request(phy_policy_phy_t phy)
+{
+    ble_gap_phys_t const phys = {
+        .rx_phys = phy_to_gap(phy),
+        .tx_phys = phy_to_gap(phy),
+    };
+
+    if (m_update_pending || m_conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return;
+    }
+
+    ret_code_t err_code = sd_ble_gap_phy_update(m_conn_handle, &phys);
+    if (err_code == NRF_SUCCESS)
+    {
+        m_update_pending = true;
+        m_last_switch_ticks = time_sync_local_ticks();
+    }
+    LOG_ERROR("PHY request", err_code);
+}
+
+/**
+ * @brief 根据平均RSSI决定目标PHY，带迟滞和最短停留时间。
+ */
+static void phy_evaluate(void)
+{
+    int8_t           rssi = (int8_t)(m_rssi_avg_q4 / 16);
+    phy_policy_phy_t target = m_stats.current;
+
+    if (time_sync_local_ticks() - m_last_switch_ticks < APP_TIMER_TICKS(PHY_POLICY_DWELL_MS))
+    {
+        return;
+    }
+
+    switch (m_stats.current)
+    {
+    case PHY_POLICY_2M:
+        if (rssi < PHY_POLICY_2M_EXIT_RSSI)
+        {
+            target = PHY_POLICY_1M;
+        }
+        break;
+
+    case PHY_POLICY_1M:
+        if (rssi > PHY_POLICY_2M_ENTER_RSSI)
+        {
+            target = PHY_POLICY_2M;
+        }
+        else if (PHY_POLICY_CODED_ENABLED && rssi < PHY_POLICY_CODED_ENTER_RSSI)
+        {
+            target = PHY_POLICY_CODED;
+        }
+        break;
+
+    default: // PHY_POLICY_CODED
+        if (rssi > PHY_POLICY_CODED_EXIT_RSSI)
+        {
+            target = PHY_POLICY_1M;
+        }
+        break;
+    }
+
+    if (target != m_stats.current)
+    {
+        NRF_LOG_INFO("RSSI %d dBm, switching PHY %d -> %d.", rssi, m_stats.current, target);
+        phy_request(target);
+    }
+}
+
+static void on_rssi_changed(int8_t rssi)
+{
+    if (!m_rssi_valid)
+    {
+        m_rssi_avg_q4 = rssi * 16;
+        m_rssi_valid = true;
+    }
+    else
+    {
+        m_rssi_avg_q4 += (rssi * 16 - m_rssi_avg_q4) / (1 << RSSI_AVG_SHIFT);
+    }
+    m_stats.rssi = (int8_t)(m_rssi_avg_q4 / 16);
+    metrics_gauge_set(METRIC_RSSI, m_stats.rssi);
+
+    phy_evaluate();
+}
+
+static void phy_policy_on_ble_evt(ble_evt_t const *p_ble_evt, void *p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    ble_gap_evt_t const *p_gap_evt = &p_ble_evt->evt.gap_evt;
+
+    switch (p_ble_evt->header.evt_id)
+    {
+    case BLE_GAP_EVT_CONNECTED:
+        m_conn_handle = p_gap_evt->conn_handle;
+        m_rssi_valid = false;
+        m_update_pending = false;
+        m_stats.current = PHY_POLICY_1M;
+        m_stats.counters[PHY_POLICY_1M].entries++;
+        m_last_switch_ticks = time_sync_local_ticks();
+        LOG_ERROR("RSSI start", sd_ble_gap_rssi_start(m_conn_handle, RSSI_THRESHOLD_DBM, RSSI_SKIP_COUNT));
+        if (m_start_phy != PHY_POLICY_1M)
+        {
+            phy_request(m_start_phy);
+        }
+        break;
+
+    case BLE_GAP_EVT_DISCONNECTED:
+        if (p_gap_evt->params.disconnected.reason == BLE_HCI_CONNECTION_TIMEOUT)
+        {
+            m_stats.counters[m_stats.current].link_losses++;
+            m_start_phy = (m_stats.current == PHY_POLICY_2M || !PHY_POLICY_CODED_ENABLED) ? PHY_POLICY_1M : PHY_POLICY_CODED;
+        }
+        else
+        {
+            m_start_phy = PHY_POLICY_2M;
+        }
+        m_conn_handle = BLE_CONN_HANDLE_INVALID;
+        m_stats.rssi = 0;
+        break;
+
+    case BLE_GAP_EVT_PHY_UPDATE_REQUEST:
+    {
+        // 对端发起的请求按当前策略回复，而不是交给SoftDevice自动选择。
+        ble_gap_phys_t const phys = {
+            .rx_phys = phy_to_gap(m_stats.current),
+            .tx_phys = phy_to_gap(m_stats.current),
+        };
+        LOG_ERROR("PHY update reply", sd_ble_gap_phy_update(p_gap_evt->conn_handle, &phys));
+    }
+    break;
+
+    case BLE_GAP_EVT_PHY_UPDATE:
+        m_update_pending = false;
+        if (p_gap_evt->params.phy_update.status == BLE_HCI_STATUS_CODE_SUCCESS && phy_from_gap(p_gap_evt->params.phy_update.tx_phy) != m_stats.current)
+        {
+            m_stats.current = phy_from_gap(p_gap_evt->params.phy_update.tx_phy);
+            m_stats.counters[m_stats.current].entries++;
+        }
+        break;
+
+    case BLE_GAP_EVT_RSSI_CHANGED:
+        on_rssi_changed(p_gap_evt->params.rssi_changed.rssi);
+        break;
+
+    case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+        m_stats.counters[m_stats.current].tx_packets += p_ble_evt->evt.gatts_evt.params.hvn_tx_complete.count;
+        break;
+
+    default:
+        break;
+    }
+}
+
+NRF_SDH_BLE_OBSERVER(m_phy_policy_observer, PHY_POLICY_BLE_OBSERVER_PRIO, phy_policy_on_ble_evt, NULL);
+
+/**
+ * @brief 记录一次发送队列满，由发送通知的模块调用。
+ */
+void phy_policy_tx_stall(void)
+{
+    m_stats.counters[m_stats.current].tx_stalls++;
+}
+
+void phy_policy_stats_get(phy_policy_stats_t *p_stats)
+{
+    *p_stats = m_stats;
+}
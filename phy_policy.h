@@ -0,0 +1,63 @@
+#ifndef PHY_POLICY_H
+#define PHY_POLICY_H
+
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#ifndef PHY_POLICY_BLE_OBSERVER_PRIO
+#define PHY_POLICY_BLE_OBSERVER_PRIO 2 /**< PHY策略模块的BLE观察者优先级。 */
+#endif
+
+/**
+ * @brief 是否使用Coded PHY，只有S140（nRF52840/nRF52811等）支持，nRF52832上的S132不支持。
+ */
+#ifndef PHY_POLICY_CODED_ENABLED
+#if defined(S140)
+#define PHY_POLICY_CODED_ENABLED 1
+#else
+#define PHY_POLICY_CODED_ENABLED 0
+#endif
+#endif
+
+#define PHY_POLICY_2M_ENTER_RSSI -65    /**< 平均RSSI高于该值时升到2M PHY（dBm）。 */
+#define PHY_POLICY_2M_EXIT_RSSI -75     /**< 在2M PHY上平均RSSI低于该值时降到1M PHY（dBm）。 */
+#define PHY_POLICY_CODED_ENTER_RSSI -88 /**< 在1M PHY上平均RSSI低于该值时降到Coded PHY（dBm）。 */
+#define PHY_POLICY_CODED_EXIT_RSSI -80  /**< 在Coded PHY上平均RSSI高于该值时升到1M PHY（dBm）。 */
+#define PHY_POLICY_DWELL_MS 5000        /**< 两次切换之间的最短间隔（毫秒）。 */
+
+/**
+ * @brief PHY编号，用于统计数组下标。
+ */
+typedef enum
+{
+    PHY_POLICY_1M,
+    PHY_POLICY_2M,
+    PHY_POLICY_CODED,
+    PHY_POLICY_PHY_COUNT
+} phy_policy_phy_t;
+
+/**
+ * @brief 每种PHY上的链路统计。
+ *
+ * @details S132不提供链路层重传计数，这里用发送完成的包数、发送队列满的次数和连接超时断开的次数衡量链路质量。
+ */
+typedef struct
+{
+    uint32_t tx_packets;  /**< 已发送完成的通知数量。 */
+    uint32_t tx_stalls;   /**< 发送队列满（NRF_ERROR_RESOURCES）的次数。 */
+    uint16_t link_losses; /**< 连接超时断开的次数。 */
+    uint16_t entries;     /**< 切换到该PHY的次数。 */
+} phy_policy_counters_t;
+
+typedef struct
+{
+    phy_policy_phy_t      current; /**< 当前的发送PHY。 */
+    int8_t                rssi;    /**< 平均RSSI（dBm），没有连接时为0。 */
+    phy_policy_counters_t counters[PHY_POLICY_PHY_COUNT];
+} phy_policy_stats_t;
+
+void phy_policy_tx_stall(void);
+void phy_policy_stats_get(phy_policy_stats_t *p_stats);
+
+#endif
@@ -0,0 +1,404 @@
+#include "power_meter.h"
+
+#include <string.h>
+
+#include "app_util.h"
+#include "boards.h"
+#include "nrf_drv_ppi.h"
+#include "nrf_log.h"
+#include "nrfx_rtc.h"
+#include "nrfx_timer.h"
+#include "nrfx_twim.h"
+
+#include "event_queue.h"
+#include "metrics.h"
+#include "time_sync.h"
+#include "utils.h"
+
+#define INA226_REG_CONFIG 0x00
+#define INA226_REG_POWER 0x03
+#define INA226_REG_CALIBRATION 0x05
+
+/**
+ * @brief 16次平均，总线和分流电压各转换1.1 ms，连续转换，每个结果约35 ms。
+ */
+#define INA226_CONFIG 0x4527
+
+#define INA226_CURRENT_LSB_UA 100                        /**< 电流寄存器的分辨率，决定校准值。 */
+#define INA226_POWER_LSB_UW (25 * INA226_CURRENT_LSB_UA) /**< 功率寄存器的分辨率（uW），数据手册规定为电流分辨率的25倍。 */
+
+/**
+ * @brief 校准值 = 0.00512 / (电流分辨率A * 采样电阻ohm) = 5120000 / (uA * mohm)。
+ */
+#define INA226_CALIBRATION (5120000UL / (INA226_CURRENT_LSB_UA * BOARD_POWER_METER_SHUNT_MOHM))
+
+#define SAMPLE_MISSING 0xFFFF /**< 处理完的缓冲区填充该值，读取失败时样本保持不变。 */
+
+/**
+ * @brief 采样间隔（微秒），RTC分频后的实际值。
+ */
+#define SAMPLE_US ((RTC_FREQ_TO_PRESCALER(POWER_METER_SAMPLE_HZ) + 1) * 1000000ULL / RTC_INPUT_FREQ)
+
+STATIC_ASSERT(INA226_CALIBRATION > 0 && INA226_CALIBRATION < 0x8000);
+
+/**
+ * @brief 一批样本读完，在主循环中处理。
+ */
+typedef struct
+{
+    uint64_t ticks;  /**< 读完最后一个样本时的本地时间。 */
+    uint8_t  buffer; /**< 样本所在的缓冲区。 */
+} batch_t;
+
+static nrfx_twim_t const  m_twim = NRFX_TWIM_INSTANCE(POWER_METER_TWIM_INSTANCE);
+static nrfx_timer_t const m_counter = NRFX_TIMER_INSTANCE(POWER_METER_COUNTER_INSTANCE);
+static nrfx_rtc_t const   m_rtc = NRFX_RTC_INSTANCE(POWER_METER_RTC_INSTANCE);
+
+static nrf_ppi_channel_t m_ppi_sample; /**< RTC TICK -> TWIM STARTTX */
+static nrf_ppi_channel_t m_ppi_count;  /**< TWIM STOPPED -> TIMER COUNT */
+
+static uint8_t m_tx[3];  /**< 写寄存器：[地址][高字节][低字节]。 */
+static uint8_t m_reg = INA226_REG_POWER;
+static uint8_t m_samples[2][POWER_METER_BATCH_SIZE][2]; /**< 双缓冲，EasyDMA写入一个时主循环处理另一个。 */
+static uint8_t m_active;                                /**< EasyDMA正在写入的缓冲区。 */
+static uint8_t m_errors;                                /**< 上一批有效样本之后读取失败的次数。 */
+
+static power_meter_stats_t         m_stats;
+static uint64_t                    m_total_mw; /**< 所有有效样本的功率之和，用于计算平均值。 */
+static power_meter_state_handler_t m_state_handler;
+static uint8_t                     m_run;       /**< 连续越过阈值的样本数。 */
+static uint64_t                    m_run_ticks; /**< 第一个越过阈值的样本的时间。 */
+static uint32_t                    m_run_mw;
+
+/**
+ * @brief 按阈值和去抖判断主机电源状态，状态变化的时间取第一个越过阈值的样本。
+ */
+static void state_track(uint32_t power_mw, uint64_t ticks)
+{
+    bool crossed = m_stats.host_on ? (power_mw < POWER_METER_OFF_MW) : (power_mw > POWER_METER_ON_MW);
+
+    if (!crossed)
+    {
+        m_run = 0;
+        return;
+    }
+
+    if (m_run == 0)
+    {
+        m_run_ticks = ticks;
+        m_run_mw = power_mw;
+    }
+
+    if (++m_run >= POWER_METER_DEBOUNCE)
+    {
+        m_run = 0;
+        m_stats.host_on = !m_stats.host_on;
+        NRF_LOG_INFO("Host power %s, %d mW.", m_stats.host_on ? "on" : "off", m_run_mw);
+        if (m_state_handler != NULL)
+        {
+            m_state_handler(m_stats.host_on, m_run_ticks, m_run_mw);
+        }
+    }
+}
+
+/**
+ * @brief 计算一批样本的最小、最大和平均功率，处理完后标记缓冲区为未读取。
+ */
+static void batch_handler(void *p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(event_size);
+
+    batch_t const *p_batch = (batch_t const *)p_event_data;
+    uint8_t(*p_samples)[2] = m_samples[p_batch->buffer];
+    uint64_t sample_ticks = time_sync_us_to_ticks(SAMPLE_US);
+    uint32_t min_mw = UINT32_MAX;
+    uint32_t max_mw = 0;
+    uint32_t sum_mw = 0;
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < POWER_METER_BATCH_SIZE; i++)
+    {
+        uint16_t raw = uint16_big_decode(p_samples[i]);
+        uint32_t power_mw;
+
+        if (raw == SAMPLE_MISSING)
+        {
+            m_stats.missed++;
+            continue;
+        }
+
+        power_mw = raw * INA226_POWER_LSB_UW / 1000;
+        min_mw = MIN(min_mw, power_mw);
+        max_mw = MAX(max_mw, power_mw);
+        sum_mw += power_mw;
+        count++;
+
+        state_track(power_mw, p_batch->ticks - (POWER_METER_BATCH_SIZE - 1 - i) * sample_ticks);
+    }
+
+    memset(p_samples, 0xFF, sizeof(m_samples[0]));
+
+    if (count == 0)
+    {
+        return;
+    }
+    m_errors = 0;
+
+    m_stats.batch.min_mw = min_mw;
+    m_stats.batch.max_mw = max_mw;
+    m_stats.batch.avg_mw = sum_mw / count;
+
+    m_stats.total.min_mw = (m_stats.samples == 0) ? min_mw : MIN(m_stats.total.min_mw, min_mw);
+    m_stats.total.max_mw = MAX(m_stats.total.max_mw, max_mw);
+    m_stats.samples += count;
+    m_total_mw += sum_mw;
+    m_stats.total.avg_mw = (uint32_t)(m_total_mw / m_stats.samples);
+
+    metrics_gauge_set(METRIC_HOST_POWER_MW, m_stats.batch.avg_mw);
+}
+
+/**
+ * @brief 一批读取完成（TIMER计数到POWER_METER_BATCH_SIZE），切换缓冲区。
+ *
+ * @details 下一次读取在一个采样间隔之后，切换RX指针不会与EasyDMA冲突。
+ */
+static void counter_handler(nrf_timer_event_t event_type, void *p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    if (event_type != NRF_TIMER_EVENT_COMPARE0)
+    {
+        return;
+    }
+
+    batch_t batch = {
+        .ticks = time_sync_local_ticks(),
+        .buffer = m_active,
+    };
+
+    m_active ^= 1;
+    nrf_twim_rx_buffer_set(m_twim.p_twim, m_samples[m_active][0], sizeof(m_samples[0][0]));
+
+    (void)event_queue_put(EVENT_LANE_BACKGROUND, &batch, sizeof(batch), batch_handler);
+}
+
+static void rtc_handler(nrfx_rtc_int_type_t int_type)
+{
+    UNUSED_PARAMETER(int_type);
+}
+
+/**
+ * @brief 准备由PPI触发的重复读取，读到的样本从p_rx开始依次存放。
+ */
+static ret_code_t sample_xfer_prepare(uint8_t *p_rx)
+{
+    nrfx_twim_xfer_desc_t xfer = NRFX_TWIM_XFER_DESC_TXRX(BOARD_POWER_METER_ADDR, &m_reg, sizeof(m_reg), p_rx, sizeof(m_samples[0][0]));
+
+    return nrfx_twim_xfer(&m_twim, &xfer, NRFX_TWIM_FLAG_HOLD_XFER | NRFX_TWIM_FLAG_REPEATED_XFER |
+                                              NRFX_TWIM_FLAG_RX_POSTINC | NRFX_TWIM_FLAG_NO_XFER_EVT_HANDLER);
+}
+
+/**
+ * @brief 开始按批采样。读取由RTC的TICK事件经PPI触发，每次读取后RX指针后移，
+ *        TWIM的STOPPED事件经PPI计数，整批完成前CPU不会被唤醒。
+ */
+static ret_code_t batch_start(void)
+{
+    ret_code_t err_code;
+
+    err_code = sample_xfer_prepare(m_samples[m_active][0]);
+    VERIFY_SUCCESS(err_code);
+
+    nrfx_timer_clear(&m_counter);
+    nrfx_timer_enable(&m_counter);
+
+    err_code = nrf_drv_ppi_channel_enable(m_ppi_count);
+    VERIFY_SUCCESS(err_code);
+    err_code = nrf_drv_ppi_channel_enable(m_ppi_sample);
+    VERIFY_SUCCESS(err_code);
+
+    nrfx_rtc_enable(&m_rtc);
+    m_stats.state = POWER_METER_RUNNING;
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 采样时读取失败后在主循环中继续本批，从TIMER的计数得到下一个样本的位置。
+ *
+ * @details 失败的读取也产生STOPPED事件并被计数，该样本保持SAMPLE_MISSING，处理该批时计入missed。
+ *          在主循环中执行时整批完成的TIMER中断已经处理，m_active指向正在写入的缓冲区。
+ */
+static void sample_retry_handler(void *p_event_data, uint16_t event_size)
+{
+    ret_code_t err_code;
+    uint32_t   pos = nrfx_timer_capture(&m_counter, NRF_TIMER_CC_CHANNEL1);
+
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+
+    if (pos > 0)
+    {
+        // 读取可能在接收阶段失败，已经写入了部分数据。
+        memset(m_samples[m_active][pos - 1], 0xFF, sizeof(m_samples[0][0]));
+    }
+
+    err_code = sample_xfer_prepare(m_samples[m_active][pos]);
+    if (err_code == NRF_SUCCESS)
+    {
+        err_code = nrf_drv_ppi_channel_enable(m_ppi_sample);
+    }
+
+    if (err_code != NRF_SUCCESS)
+    {
+        m_stats.state = POWER_METER_FAILED;
+    }
+    LOG_ERROR("Power meter retry", err_code);
+}
+
+/**
+ * @brief 采样时读取失败：停止触发读取，在主循环中从下一个样本继续，连续失败过多时停止采样。
+ */
+static void sample_error(void)
+{
+    (void)nrf_drv_ppi_channel_disable(m_ppi_sample);
+
+    if (++m_errors < POWER_METER_ERROR_MAX &&
+        event_queue_put(EVENT_LANE_BACKGROUND, NULL, 0, sample_retry_handler) == NRF_SUCCESS)
+    {
+        return;
+    }
+
+    NRF_LOG_WARNING("Power meter stopped after %d failed reads.", m_errors);
+    m_stats.state = POWER_METER_FAILED;
+}
+
+static ret_code_t register_write(uint8_t reg, uint16_t value)
+{
+    nrfx_twim_xfer_desc_t xfer = NRFX_TWIM_XFER_DESC_TX(BOARD_POWER_METER_ADDR, m_tx, sizeof(m_tx));
+
+    m_tx[0] = reg;
+    m_tx[1] = (uint8_t)(value >> 8);
+    m_tx[2] = (uint8_t)value;
+
+    return nrfx_twim_xfer(&m_twim, &xfer, 0);
+}
+
+/**
+ * @brief 配置阶段的传输完成：先写配置寄存器，再写校准寄存器，然后开始采样。
+ *        采样时只有读取失败才调用。
+ */
+static void twim_evt_handler(nrfx_twim_evt_t const *p_event, void *p_context)
+{
+    ret_code_t err_code;
+
+    UNUSED_PARAMETER(p_context);
+
+    if (m_stats.state == POWER_METER_RUNNING)
+    {
+        sample_error();
+        return;
+    }
+
+    if (p_event->type != NRFX_TWIM_EVT_DONE)
+    {
+        NRF_LOG_WARNING("Power meter not responding (%d).", p_event->type);
+        m_stats.state = POWER_METER_FAILED;
+        return;
+    }
+
+    if (m_tx[0] == INA226_REG_CONFIG)
+    {
+        err_code = register_write(INA226_REG_CALIBRATION, INA226_CALIBRATION);
+    }
+    else
+    {
+        err_code = batch_start();
+    }
+
+    if (err_code != NRF_SUCCESS)
+    {
+        m_stats.state = POWER_METER_FAILED;
+    }
+    LOG_ERROR("Power meter", err_code);
+}
+
+/**
+ * @brief 初始化功率计。INA226的配置在TWIM中断中异步完成，不会推迟广播。
+ */
+ret_code_t power_meter_init(power_meter_state_handler_t state_handler)
+{
+    ret_code_t          err_code;
+    nrfx_twim_config_t  twim_config = NRFX_TWIM_DEFAULT_CONFIG;
+    nrfx_timer_config_t counter_config = NRFX_TIMER_DEFAULT_CONFIG;
+    nrfx_rtc_config_t   rtc_config = NRFX_RTC_DEFAULT_CONFIG;
+
+    m_state_handler = state_handler;
+    memset(m_samples, 0xFF, sizeof(m_samples));
+
+    twim_config.scl = BOARD_POWER_METER_SCL_PIN;
+    twim_config.sda = BOARD_POWER_METER_SDA_PIN;
+    twim_config.frequency = NRF_TWIM_FREQ_400K;
+    err_code = nrfx_twim_init(&m_twim, &twim_config, twim_evt_handler, NULL);
+    VERIFY_SUCCESS(err_code);
+
+    // 计数模式的TIMER不需要HFCLK，只在TWIM读取时由COUNT任务驱动。
+    counter_config.mode = NRF_TIMER_MODE_COUNTER;
+    counter_config.bit_width = NRF_TIMER_BIT_WIDTH_16;
+    err_code = nrfx_timer_init(&m_counter, &counter_config, counter_handler);
+    VERIFY_SUCCESS(err_code);
+    nrfx_timer_extended_compare(&m_counter, NRF_TIMER_CC_CHANNEL0, POWER_METER_BATCH_SIZE,
+                                NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK, true);
+
+    // RTC由LFCLK驱动，只使用TICK事件，不产生中断。
+    rtc_config.prescaler = RTC_FREQ_TO_PRESCALER(POWER_METER_SAMPLE_HZ);
+    err_code = nrfx_rtc_init(&m_rtc, &rtc_config, rtc_handler);
+    VERIFY_SUCCESS(err_code);
+    nrfx_rtc_tick_enable(&m_rtc, false);
+
+    err_code = nrf_drv_ppi_init();
+    if (err_code != NRF_ERROR_MODULE_ALREADY_INITIALIZED)
+    {
+        VERIFY_SUCCESS(err_code);
+    }
+
+    err_code = nrf_drv_ppi_channel_alloc(&m_ppi_sample);
+    VERIFY_SUCCESS(err_code);
+    err_code = nrf_drv_ppi_channel_assign(m_ppi_sample,
+                                          nrfx_rtc_event_address_get(&m_rtc, NRF_RTC_EVENT_TICK),
+                                          nrfx_twim_start_task_get(&m_twim, NRFX_TWIM_XFER_TXRX));
+    VERIFY_SUCCESS(err_code);
+
+    err_code = nrf_drv_ppi_channel_alloc(&m_ppi_count);
+    VERIFY_SUCCESS(err_code);
+    err_code = nrf_drv_ppi_channel_assign(m_ppi_count,
+                                          nrfx_twim_stopped_event_get(&m_twim),
+                                          nrfx_timer_task_address_get(&m_counter, NRF_TIMER_TASK_COUNT));
+    VERIFY_SUCCESS(err_code);
+
+    nrfx_twim_enable(&m_twim);
+    m_stats.state = POWER_METER_CONFIGURING;
+
+    return register_write(INA226_REG_CONFIG, INA226_CONFIG);
+}
+
+void power_meter_stats_get(power_meter_stats_t *p_stats)
+{
+    *p_stats = m_stats;
+}
+
+/**
+ * @brief 清除累计统计，保留最近一批样本和主机电源状态。
+ */
+void power_meter_stats_reset(void)
+{
+    memset(&m_stats.total, 0, sizeof(m_stats.total));
+    m_stats.samples = 0;
+    m_stats.missed = 0;
+    m_total_mw = 0;
+}
+
+bool power_meter_host_on(void)
+{
+    return m_stats.host_on;
+}
@@ -0,0 +1,69 @@
+#ifndef POWER_METER_H
+#define POWER_METER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#ifndef POWER_METER_ENABLED
+#define POWER_METER_ENABLED 1 /**< 主机待机电源的功率计，由Makefile的FEATURE_POWER_METER控制。 */
+#endif
+
+#define POWER_METER_TWIM_INSTANCE 1    /**< TWIM1，TWIM0与SPIM0共用外设。 */
+#define POWER_METER_COUNTER_INSTANCE 3 /**< 计数已完成读取的TIMER，TIMER0属于SoftDevice，TIMER1用于启动计时。 */
+#define POWER_METER_RTC_INSTANCE 2     /**< 触发读取的RTC，RTC0属于SoftDevice，RTC1用于app_timer。 */
+
+#define POWER_METER_SAMPLE_HZ 20   /**< 采样频率，INA226每次转换约35 ms（16次平均）。 */
+#define POWER_METER_BATCH_SIZE 64  /**< 每批样本数，每批唤醒CPU一次（约3.2 s）。 */
+#define POWER_METER_ON_MW 3000     /**< 功率连续高于该值时认为主机开机（mW），按机器调整。 */
+#define POWER_METER_OFF_MW 2000    /**< 功率连续低于该值时认为主机关机（mW）。 */
+#define POWER_METER_DEBOUNCE 4     /**< 连续越过阈值的样本数达到该值才确认状态变化。 */
+#define POWER_METER_ERROR_MAX 20   /**< 采样时两批有效样本之间读取失败的次数达到该值时停止采样。 */
+
+/**
+ * @brief 功率计的状态。
+ */
+typedef enum
+{
+    POWER_METER_IDLE,        /**< 未初始化。 */
+    POWER_METER_CONFIGURING, /**< 正在写入INA226的配置和校准寄存器。 */
+    POWER_METER_RUNNING,     /**< 正在按批采样。 */
+    POWER_METER_FAILED,      /**< 配置时INA226没有应答，或采样时读取失败过多。 */
+} power_meter_state_t;
+
+/**
+ * @brief 一段时间内的功率（mW）。
+ */
+typedef struct
+{
+    uint32_t min_mw;
+    uint32_t max_mw;
+    uint32_t avg_mw;
+} power_meter_summary_t;
+
+typedef struct
+{
+    uint8_t               state;   /**< @ref power_meter_state_t */
+    bool                  host_on; /**< 按阈值判断的主机电源状态。 */
+    power_meter_summary_t batch;   /**< 最近一批样本。 */
+    power_meter_summary_t total;   /**< 上次清除以来的所有样本。 */
+    uint32_t              samples; /**< 上次清除以来的有效样本数。 */
+    uint32_t              missed;  /**< 上次清除以来没有读到数据的样本数。 */
+} power_meter_stats_t;
+
+/**
+ * @brief 主机电源状态变化时的回调，在主循环中调用。
+ *
+ * @param[in] host_on  新的状态。
+ * @param[in] ticks    第一个越过阈值的样本的本地时间（time_sync_local_ticks）。
+ * @param[in] power_mw 该样本的功率。
+ */
+typedef void (*power_meter_state_handler_t)(bool host_on, uint64_t ticks, uint32_t power_mw);
+
+ret_code_t power_meter_init(power_meter_state_handler_t state_handler);
+void       power_meter_stats_get(power_meter_stats_t *p_stats);
+void       power_meter_stats_reset(void);
+bool       power_meter_host_on(void);
+
+#endif
@@ -0,0 +1,170 @@
+#include "power_stats.h"
+
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include "ble_radio_notification.h"
+#include "boards.h"
+#include "nrf.h"
+#include "nrf_log.h"
+
+#include "metrics.h"
+
+#define CYCLES_PER_US (SystemCoreClock / 1000000)
+#define TICKS_TO_US(_ticks) ((uint64_t)(_ticks)*1000000 / APP_TIMER_CLOCK_FREQ)
+
+APP_TIMER_DEF(m_window_timer_id);
+
+static uint32_t            m_window_tick;   /**< 窗口开始时的RTC计数。 */
+static uint32_t            m_window_cycles; /**< 窗口开始时的CPU周期计数。 */
+static uint32_t            m_wake_cycles;   /**< 主循环上次醒来时的CPU周期计数。 */
+static uint32_t            m_main_cycles;   /**< 本窗口内主循环的CPU周期。 */
+static uint32_t            m_radio_start_tick;
+static uint32_t            m_radio_ticks; /**< 本窗口内射频活动的RTC tick。 */
+static power_stats_t       m_stats;
+
+/**
+ * @brief 按电流模型估算平均电流（nA）。
+ */
+static uint32_t avg_current_na(power_stats_times_t const *p_times)
+{
+    if (p_times->wall_us == 0)
+    {
+        return 0;
+    }
+
+    uint64_t charge = p_times->sleep_us * BOARD_CURRENT_SLEEP_UA + (p_times->main_us + p_times->irq_us) * BOARD_CURRENT_CPU_UA +
+                      p_times->radio_us * BOARD_CURRENT_RADIO_UA + p_times->wall_us * BOARD_CURRENT_BOARD_UA;
+
+    return (uint32_t)(charge * 1000 / p_times->wall_us);
+}
+
+/**
+ * @brief 占比，单位为0.01%。
+ */
+static uint32_t basis_points(uint64_t part_us, uint64_t wall_us)
+{
+    return (wall_us == 0) ? 0 : (uint32_t)(part_us * 10000 / wall_us);
+}
+
+static void times_add(power_stats_times_t *p_total, power_stats_times_t const *p_window)
+{
+    p_total->wall_us += p_window->wall_us;
+    p_total->sleep_us += p_window->sleep_us;
+    p_total->main_us += p_window->main_us;
+    p_total->irq_us += p_window->irq_us;
+    p_total->radio_us += p_window->radio_us;
+}
+
+/**
+ * @brief 窗口结束，计算各状态的时间并更新指标。
+ */
+static void window_timeout_handler(void *p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    power_stats_times_t window;
+    uint32_t            now_tick = app_timer_cnt_get();
+    uint32_t            now_cycles;
+    uint32_t            main_cycles;
+    uint32_t            radio_ticks;
+
+    CRITICAL_REGION_ENTER();
+    now_cycles = DWT->CYCCNT;
+    main_cycles = m_main_cycles;
+    m_main_cycles = 0;
+    radio_ticks = m_radio_ticks;
+    m_radio_ticks = 0;
+    CRITICAL_REGION_EXIT();
+
+    uint64_t cpu_us = (now_cycles - m_window_cycles) / CYCLES_PER_US;
+
+    window.wall_us = TICKS_TO_US(app_timer_cnt_diff_compute(now_tick, m_window_tick));
+    window.main_us = MIN(main_cycles / CYCLES_PER_US, cpu_us);
+    window.irq_us = cpu_us - window.main_us;
+    window.sleep_us = (window.wall_us > cpu_us) ? (window.wall_us - cpu_us) : 0;
+    window.radio_us = TICKS_TO_US(radio_ticks);
+
+    m_window_tick = now_tick;
+    m_window_cycles = now_cycles;
+
+    m_stats.window = window;
+    times_add(&m_stats.total, &window);
+    m_stats.window_avg_na = avg_current_na(&m_stats.window);
+    m_stats.total_avg_na = avg_current_na(&m_stats.total);
+
+    metrics_gauge_set(METRIC_SLEEP_BP, basis_points(window.sleep_us, window.wall_us));
+    metrics_gauge_set(METRIC_MAIN_LOOP_BP, basis_points(window.main_us, window.wall_us));
+    metrics_gauge_set(METRIC_IRQ_BP, basis_points(window.irq_us, window.wall_us));
+    metrics_gauge_set(METRIC_RADIO_BP, basis_points(window.radio_us, window.wall_us));
+    metrics_gauge_set(METRIC_AVG_CURRENT_NA, m_stats.window_avg_na);
+    metrics_gauge_set(METRIC_TOTAL_AVG_CURRENT_NA, m_stats.total_avg_na);
+
+    NRF_LOG_DEBUG("Sleep %d bp, radio %d bp, %d nA.", basis_points(window.sleep_us, window.wall_us), basis_points(window.radio_us, window.wall_us), m_stats.window_avg_na);
+}
+
+/**
+ * @brief 射频通知，在射频活动开始前和结束后调用。
+ */
+static void radio_notification_handler(bool radio_active)
+{
+    uint32_t now = app_timer_cnt_get();
+
+    if (radio_active)
+    {
+        m_radio_start_tick = now;
+    }
+    else
+    {
+        m_radio_ticks += app_timer_cnt_diff_compute(now, m_radio_start_tick);
+    }
+}
+
+/**
+ * @brief 初始化功耗统计，需要在SoftDevice开启之后调用。
+ */
+ret_code_t power_stats_init(void)
+{
+    ret_code_t err_code;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    m_window_tick = app_timer_cnt_get();
+    m_window_cycles = DWT->CYCCNT;
+    m_wake_cycles = m_window_cycles;
+
+    err_code = ble_radio_notification_init(APP_IRQ_PRIORITY_HIGH, NRF_RADIO_NOTIFICATION_DISTANCE_NONE, radio_notification_handler);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = app_timer_create(&m_window_timer_id, APP_TIMER_MODE_REPEATED, window_timeout_handler);
+    VERIFY_SUCCESS(err_code);
+
+    return app_timer_start(m_window_timer_id, APP_TIMER_TICKS(POWER_STATS_WINDOW_MS), NULL);
+}
+
+/**
+ * @brief 主循环进入睡眠前调用，累计主循环的运行时间。
+ */
+void power_stats_sleep_enter(void)
+{
+    uint32_t cycles = DWT->CYCCNT - m_wake_cycles;
+
+    CRITICAL_REGION_ENTER();
+    m_main_cycles += cycles;
+    CRITICAL_REGION_EXIT();
+}
+
+/**
+ * @brief 主循环从睡眠中返回后调用。
+ */
+void power_stats_sleep_exit(void)
+{
+    m_wake_cycles = DWT->CYCCNT;
+}
+
+void power_stats_get(power_stats_t *p_stats)
+{
+    CRITICAL_REGION_ENTER();
+    *p_stats = m_stats;
+    CRITICAL_REGION_EXIT();
+}
@@ -0,0 +1,38 @@
+#ifndef POWER_STATS_H
+#define POWER_STATS_H
+
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#define POWER_STATS_WINDOW_MS 10000 /**< 统计窗口长度（毫秒），占比和平均电流按最近一个完整窗口计算。 */
+
+/**
+ * @brief 一段时间内各状态的时间（微秒）。
+ *
+ * @details CPU时间由DWT周期计数器得到，计数器在睡眠时停止。主循环时间包括打断主循环的中断，
+ *          中断时间为其余的CPU时间（SoftDevice和应用中断）。射频时间与CPU时间有重叠。
+ */
+typedef struct
+{
+    uint64_t wall_us;
+    uint64_t sleep_us;
+    uint64_t main_us;  /**< 主循环（事件队列和日志处理）。 */
+    uint64_t irq_us;   /**< 唤醒后在中断中的时间。 */
+    uint64_t radio_us; /**< 射频活动（来自射频通知）。 */
+} power_stats_times_t;
+
+typedef struct
+{
+    power_stats_times_t window;       /**< 最近一个完整窗口。 */
+    power_stats_times_t total;        /**< 启动以来的累计。 */
+    uint32_t            window_avg_na; /**< 按电流模型估算的最近窗口平均电流（nA）。 */
+    uint32_t            total_avg_na;  /**< 启动以来的平均电流（nA）。 */
+} power_stats_t;
+
+ret_code_t power_stats_init(void);
+void       power_stats_sleep_enter(void);
+void       power_stats_sleep_exit(void);
+void       power_stats_get(power_stats_t *p_stats);
+
+#endif
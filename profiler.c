@@ -0,0 +1,261 @@
+#include "profiler.h"
+
+#include <string.h>
+
+#include "app_util_platform.h"
+#include "nrf.h"
+#include "nrf_log.h"
+#include "nrf_sdh_ble.h"
+#include "nrf_sdh_soc.h"
+
+#include "event_queue.h"
+#include "metrics.h"
+
+#if PROFILER_ENABLED
+
+#define CYCLES_PER_US (SystemCoreClock / 1000000)
+
+/**
+ * @brief BLE和SoC事件分发的开始与结束标记使用的观察者优先级，结束标记独占最低的优先级。
+ */
+#define PROFILER_BLE_BEGIN_PRIO 0
+#define PROFILER_BLE_END_PRIO (NRF_SDH_BLE_OBSERVER_PRIO_LEVELS - 1)
+#define PROFILER_SOC_BEGIN_PRIO 0
+#define PROFILER_SOC_END_PRIO (NRF_SDH_SOC_OBSERVER_PRIO_LEVELS - 1)
+
+/**
+ * @brief 统计项，执行时间以CPU周期累计，读取时换算为微秒。
+ */
+typedef struct
+{
+    uint32_t key;
+    uint8_t  kind;
+    uint32_t count;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+} entry_t;
+
+static entry_t           m_entries[PROFILER_MAX_ENTRIES];
+static volatile uint8_t  m_entry_count;
+static uint32_t          m_ble_start; /**< BLE事件分发开始时的周期数，分发不会重入。 */
+static uint32_t          m_soc_start;
+
+STATIC_ASSERT(PROFILER_BLE_END_PRIO > PROFILER_BLE_BEGIN_PRIO);
+STATIC_ASSERT(PROFILER_SOC_END_PRIO > PROFILER_SOC_BEGIN_PRIO);
+
+/**
+ * @brief 查找统计项，不存在时添加，表已满时返回NULL。
+ *
+ * @details 每种统计项只在一个上下文中更新，添加时需要临界区，因为不同上下文会同时添加。
+ */
+static entry_t *entry_find(profiler_kind_t kind, uint32_t key)
+{
+    entry_t *p_entry = NULL;
+    uint8_t  count = m_entry_count;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (m_entries[i].kind == kind && m_entries[i].key == key)
+        {
+            return &m_entries[i];
+        }
+    }
+
+    CRITICAL_REGION_ENTER();
+    if (m_entry_count < PROFILER_MAX_ENTRIES)
+    {
+        p_entry = &m_entries[m_entry_count];
+        memset(p_entry, 0, sizeof(entry_t));
+        p_entry->kind = kind;
+        p_entry->key = key;
+        m_entry_count++;
+    }
+    CRITICAL_REGION_EXIT();
+
+    if (p_entry != NULL)
+    {
+        metrics_gauge_max(METRIC_PROFILER_ENTRIES, m_entry_count);
+    }
+
+    return p_entry;
+}
+
+static void ble_begin_handler(ble_evt_t const *p_ble_evt, void *p_context)
+{
+    UNUSED_PARAMETER(p_ble_evt);
+    UNUSED_PARAMETER(p_context);
+
+    m_ble_start = profiler_cycles();
+}
+
+static void ble_end_handler(ble_evt_t const *p_ble_evt, void *p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    profiler_record(PROFILER_KIND_BLE, p_ble_evt->header.evt_id, profiler_cycles() - m_ble_start);
+}
+
+static void soc_begin_handler(uint32_t evt_id, void *p_context)
+{
+    UNUSED_PARAMETER(evt_id);
+    UNUSED_PARAMETER(p_context);
+
+    m_soc_start = profiler_cycles();
+}
+
+static void soc_end_handler(uint32_t evt_id, void *p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    profiler_record(PROFILER_KIND_SOC, evt_id, profiler_cycles() - m_soc_start);
+}
+
+// 开始标记与优先级0的观察者（如ble_conn_state）的先后顺序不确定，这部分时间可能不计入。
+NRF_SDH_BLE_OBSERVER(m_profiler_ble_begin, PROFILER_BLE_BEGIN_PRIO, ble_begin_handler, NULL);
+NRF_SDH_BLE_OBSERVER(m_profiler_ble_end, PROFILER_BLE_END_PRIO, ble_end_handler, NULL);
+NRF_SDH_SOC_OBSERVER(m_profiler_soc_begin, PROFILER_SOC_BEGIN_PRIO, soc_begin_handler, NULL);
+NRF_SDH_SOC_OBSERVER(m_profiler_soc_end, PROFILER_SOC_END_PRIO, soc_end_handler, NULL);
+
+/**
+ * @brief 开启DWT周期计数器，不需要连接调试器。
+ */
+ret_code_t profiler_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 读取CPU周期计数，64 MHz时约67秒回绕一次，只用于计算差值。
+ */
+uint32_t profiler_cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+/**
+ * @brief 记录一次执行时间。被更高优先级的中断打断时，打断的时间也计入。
+ */
+void profiler_record(profiler_kind_t kind, uint32_t key, uint32_t cycles)
+{
+    entry_t *p_entry = entry_find(kind, key);
+
+    if (p_entry == NULL)
+    {
+        return;
+    }
+
+    p_entry->count++;
+    p_entry->total_cycles += cycles;
+    if (cycles > p_entry->max_cycles)
+    {
+        p_entry->max_cycles = cycles;
+    }
+}
+
+/**
+ * @brief 读取一个统计项。
+ *
+ * @retval NRF_ERROR_NOT_FOUND 序号超出已有的统计项。
+ */
+ret_code_t profiler_entry_get(uint8_t index, profiler_entry_t *p_entry)
+{
+    entry_t entry;
+
+    if (index >= m_entry_count)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    CRITICAL_REGION_ENTER();
+    entry = m_entries[index];
+    CRITICAL_REGION_EXIT();
+
+    p_entry->kind = entry.kind;
+    p_entry->key = entry.key;
+    p_entry->count = entry.count;
+    p_entry->total_us = entry.total_cycles / CYCLES_PER_US;
+    p_entry->max_us = entry.max_cycles / CYCLES_PER_US;
+
+    return NRF_SUCCESS;
+}
+
+uint8_t profiler_entry_count(void)
+{
+    return m_entry_count;
+}
+
+/**
+ * @brief 清除所有统计项。
+ */
+void profiler_reset(void)
+{
+    CRITICAL_REGION_ENTER();
+    m_entry_count = 0;
+    CRITICAL_REGION_EXIT();
+}
+
+/**
+ * @brief 把所有统计项和事件队列的使用情况输出到日志（RTT和BLE日志特征值）。
+ */
+void profiler_log(void)
+{
+    profiler_entry_t    entry;
+    event_queue_stats_t stats;
+
+    for (uint8_t i = 0; profiler_entry_get(i, &entry) == NRF_SUCCESS; i++)
+    {
+        NRF_LOG_INFO("Profile kind %d key 0x%x: %d runs, total %d us, max %d us.", entry.kind, entry.key, entry.count, (uint32_t)entry.total_us, entry.max_us);
+    }
+
+    for (uint8_t i = 0; i < EVENT_LANE_COUNT; i++)
+    {
+        event_queue_stats_get((event_lane_t)i, &stats);
+        NRF_LOG_INFO("Event lane %d: high water %d/%d, dropped %d.", i, stats.high_water, stats.depth, stats.dropped);
+    }
+}
+
+#else
+
+ret_code_t profiler_init(void)
+{
+    return NRF_SUCCESS;
+}
+
+uint32_t profiler_cycles(void)
+{
+    return 0;
+}
+
+void profiler_record(profiler_kind_t kind, uint32_t key, uint32_t cycles)
+{
+    UNUSED_PARAMETER(kind);
+    UNUSED_PARAMETER(key);
+    UNUSED_PARAMETER(cycles);
+}
+
+ret_code_t profiler_entry_get(uint8_t index, profiler_entry_t *p_entry)
+{
+    UNUSED_PARAMETER(index);
+    UNUSED_PARAMETER(p_entry);
+
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint8_t profiler_entry_count(void)
+{
+    return 0;
+}
+
+void profiler_reset(void)
+{
+}
+
+void profiler_log(void)
+{
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1 /**< 统计各回调的执行时间，关闭后不占用RAM和CPU。 */
+#endif
+
+#define PROFILER_MAX_ENTRIES 24 /**< 最多统计的回调数，超出的不再统计。 */
+
+/**
+ * @brief 统计项的类型，与key一起确定一个统计项。
+ */
+typedef enum
+{
+    PROFILER_KIND_EVENT = 1, /**< 事件队列回调，key为回调函数地址。 */
+    PROFILER_KIND_BLE,       /**< 一个BLE事件分发给所有观察者的时间，key为事件编号。 */
+    PROFILER_KIND_SOC,       /**< 一个SoC事件分发给所有观察者的时间，key为事件编号。 */
+    PROFILER_KIND_GPIOTE,    /**< GPIOTE引脚回调，key为引脚编号。 */
+} profiler_kind_t;
+
+typedef struct
+{
+    uint8_t  kind;     /**< @ref profiler_kind_t */
+    uint32_t key;
+    uint32_t count;    /**< 执行次数。 */
+    uint64_t total_us; /**< 累计执行时间（微秒）。 */
+    uint32_t max_us;   /**< 最长的一次（微秒）。 */
+} profiler_entry_t;
+
+#if PROFILER_ENABLED
+#define PROFILER_START(_start) uint32_t _start = profiler_cycles()
+#define PROFILER_STOP(_kind, _key, _start) profiler_record((_kind), (uint32_t)(_key), profiler_cycles() - (_start))
+#else
+#define PROFILER_START(_start)
+#define PROFILER_STOP(_kind, _key, _start)
+#endif
+
+ret_code_t profiler_init(void);
+uint32_t   profiler_cycles(void);
+void       profiler_record(profiler_kind_t kind, uint32_t key, uint32_t cycles);
+ret_code_t profiler_entry_get(uint8_t index, profiler_entry_t *p_entry);
+uint8_t    profiler_entry_count(void);
+void       profiler_reset(void);
+void       profiler_log(void);
+
+#endif
@@ -0,0 +1,138 @@
+#include "ram_power.h"
+
+#include <stdbool.h>
+
+#include "app_error.h"
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "nrf.h"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+#include "nrf_pwr_mgmt.h"
+#include "nrf_sdh.h"
+#include "nrf_soc.h"
+
+/**
+ * @brief 一个段的供电和保持位，段0为位0和位16，段1为位1和位17。
+ */
+#define SECTION_POWER_MASK(_section) ((POWER_RAM_POWER_S0POWER_Msk | POWER_RAM_POWER_S0RETENTION_Msk) << (_section))
+
+extern uint32_t __StackTop; /**< 链接脚本中RAM区域的结束地址，应用的数据和栈都在此地址以下。 */
+
+/**
+ * @brief 复位前恢复所有RAM段的供电。
+ *
+ * @details 软件复位不会恢复RAM段的供电，bootloader的栈在RAM顶部，复位前必须重新上电。
+ */
+void ram_power_restore(void)
+{
+    uint32_t mask = SECTION_POWER_MASK(0) | SECTION_POWER_MASK(1);
+
+    for (uint8_t block = 0; block < RAM_POWER_BLOCK_COUNT; block++)
+    {
+        if (nrf_sdh_is_enabled())
+        {
+            (void)sd_power_ram_power_set(block, mask);
+        }
+        else
+        {
+            NRF_POWER->RAM[block].POWERSET = mask;
+        }
+    }
+}
+
+/**
+ * @brief 错误处理中恢复所有RAM段的供电后复位。
+ *
+ * @details 可能在HardFault、SoftDevice断言或关闭中断后调用，此时不能调用SoftDevice的接口。
+ *          SoftDevice用MPU保护POWER，马上就要复位，关闭MPU后直接写寄存器。
+ */
+static void fault_reset(void)
+{
+    uint32_t mask = SECTION_POWER_MASK(0) | SECTION_POWER_MASK(1);
+
+    __disable_irq();
+    MPU->CTRL = 0;
+    __DSB();
+    __ISB();
+
+    for (uint8_t block = 0; block < RAM_POWER_BLOCK_COUNT; block++)
+    {
+        NRF_POWER->RAM[block].POWERSET = mask;
+    }
+
+    NVIC_SystemReset();
+}
+
+/**
+ * @brief 替换SDK中的弱定义，记录错误后恢复RAM供电并复位。
+ */
+void app_error_fault_handler(uint32_t id, uint32_t pc, uint32_t info)
+{
+    UNUSED_PARAMETER(info);
+
+    __disable_irq();
+    NRF_LOG_ERROR("Fatal error 0x%08x at 0x%08x.", id, pc);
+    NRF_LOG_FINAL_FLUSH();
+    NRF_BREAKPOINT_COND;
+
+    fault_reset();
+}
+
+/**
+ * @brief 替换启动文件中的默认处理（死循环等待看门狗），恢复RAM供电后复位。
+ */
+void HardFault_Handler(void)
+{
+    fault_reset();
+}
+
+/**
+ * @brief 进入DFU或关机前恢复RAM供电（按键DFU通过nrf_pwr_mgmt_shutdown复位）。
+ */
+static bool shutdown_handler(nrf_pwr_mgmt_evt_t event)
+{
+    UNUSED_PARAMETER(event);
+
+    ram_power_restore();
+
+    return true;
+}
+
+NRF_PWR_MGMT_HANDLER_REGISTER(shutdown_handler, 0);
+
+/**
+ * @brief 关闭应用不使用的RAM段（链接脚本中RAM区域之后的部分），降低睡眠电流。
+ *
+ * @details 需要在SoftDevice开启之后调用。RAM区域的长度按4 KB对齐，应用增大时由链接器报告溢出。
+ */
+ret_code_t ram_power_init(void)
+{
+    ret_code_t err_code;
+    uint32_t   used_end = ALIGN_NUM(RAM_POWER_SECTION_SIZE, (uint32_t)&__StackTop);
+    uint8_t    off_count = 0;
+
+    for (uint8_t block = 0; block < RAM_POWER_BLOCK_COUNT; block++)
+    {
+        uint32_t mask = 0;
+
+        for (uint8_t section = 0; section < 2; section++)
+        {
+            if (RAM_POWER_BASE + (block * 2 + section) * RAM_POWER_SECTION_SIZE >= used_end)
+            {
+                mask |= SECTION_POWER_MASK(section);
+                off_count++;
+            }
+        }
+
+        if (mask != 0)
+        {
+            err_code = sd_power_ram_power_clr(block, mask);
+            VERIFY_SUCCESS(err_code);
+        }
+    }
+
+    NRF_LOG_INFO("RAM above 0x%08x powered off (%d KB).", used_end, off_count * RAM_POWER_SECTION_SIZE / 1024);
+
+    return NRF_SUCCESS;
+}
@@ -0,0 +1,13 @@
+#ifndef RAM_POWER_H
+#define RAM_POWER_H
+
+#include "sdk_errors.h"
+
+#define RAM_POWER_BASE 0x20000000
+#define RAM_POWER_SECTION_SIZE 0x1000 /**< nRF52832的RAM分为8块，每块两个4 KB的段，可以分别断电。 */
+#define RAM_POWER_BLOCK_COUNT 8
+
+ret_code_t ram_power_init(void);
+void       ram_power_restore(void);
+
+#endif
@@ -0,0 +1,129 @@
+#include "record_store.h"
+
+#include <string.h>
+
+#include "nrf_log.h"
+
+#include "journal.h"
+#include "utils.h"
+
+/**
+ * @brief 把内存中的数据写入FDS，有写操作正在进行时延后到写完成之后。
+ */
+void record_store_save(record_store_t *p_store)
+{
+    ret_code_t         err_code;
+    fds_record_desc_t  desc = {0};
+    fds_find_token_t   token = {0};
+    fds_record_t const record = {
+        .file_id = p_store->file_id,
+        .key = p_store->key,
+        .data.p_data = p_store->p_flash,
+        .data.length_words = p_store->length_words,
+    };
+
+    if (!p_store->ready || p_store->write_in_progress)
+    {
+        p_store->save_pending = true;
+        return;
+    }
+
+    p_store->save_pending = false;
+    memcpy(p_store->p_flash, p_store->p_data, p_store->length_words * sizeof(uint32_t));
+
+    if (fds_record_find(p_store->file_id, p_store->key, &desc, &token) == NRF_SUCCESS)
+    {
+        err_code = fds_record_update(&desc, &record);
+    }
+    else
+    {
+        err_code = fds_record_write(&desc, &record);
+    }
+
+    if (err_code == FDS_ERR_NO_SPACE_IN_FLASH)
+    {
+        // 空间不足时先回收，回收完成后重试。回收期间CPU停止运行，由动作日志在空闲时执行。
+        p_store->save_pending = true;
+#if JOURNAL_ENABLED
+        journal_gc_request();
+        err_code = NRF_SUCCESS;
+#else
+        err_code = fds_gc();
+#endif
+    }
+    else if (err_code == NRF_SUCCESS)
+    {
+        p_store->write_in_progress = true;
+    }
+    LOG_ERROR(p_store->p_name, err_code);
+}
+
+/**
+ * @brief 从FDS中读取记录，长度或版本不符时保留内存中的数据。
+ */
+static void record_load(record_store_t *p_store)
+{
+    fds_record_desc_t  desc = {0};
+    fds_find_token_t   token = {0};
+    fds_flash_record_t flash_record = {0};
+
+    if (fds_record_find(p_store->file_id, p_store->key, &desc, &token) != NRF_SUCCESS)
+    {
+        return;
+    }
+
+    if (fds_record_open(&desc, &flash_record) == NRF_SUCCESS)
+    {
+        if (flash_record.p_header->length_words == p_store->length_words && *(uint16_t const *)flash_record.p_data == p_store->version)
+        {
+            memcpy(p_store->p_data, flash_record.p_data, p_store->length_words * sizeof(uint32_t));
+        }
+        (void)fds_record_close(&desc);
+    }
+}
+
+/**
+ * @brief 处理FDS事件，在模块自己的FDS事件回调中调用（SoftDevice事件中断上下文）。
+ *
+ * @return FDS初始化完成、记录已读入p_data时返回true。
+ */
+bool record_store_on_fds_evt(record_store_t *p_store, fds_evt_t const *p_evt)
+{
+    switch (p_evt->id)
+    {
+    case FDS_EVT_INIT:
+        if (p_evt->result != NRF_SUCCESS)
+        {
+            break;
+        }
+        p_store->ready = true;
+        record_load(p_store);
+        return true;
+
+    case FDS_EVT_WRITE:
+    case FDS_EVT_UPDATE:
+        if (p_evt->write.file_id != p_store->file_id)
+        {
+            break;
+        }
+        p_store->write_in_progress = false;
+        LOG_ERROR(p_store->p_name, p_evt->result);
+        if (p_store->save_pending)
+        {
+            record_store_save(p_store);
+        }
+        break;
+
+    case FDS_EVT_GC:
+        if (p_store->save_pending)
+        {
+            record_store_save(p_store);
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return false;
+}
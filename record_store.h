@@ -0,0 +1,32 @@
+#ifndef RECORD_STORE_H
+#define RECORD_STORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "fds.h"
+
+/**
+ * @brief 保存在FDS中的一条设置记录，数据以uint16_t版本号开头，长度为整数个字。
+ *
+ * @details 写入期间FDS使用p_flash中的副本，内存中的数据可以继续修改。FDS未就绪或写操作
+ *          进行中时保存延后到写完成之后，空间不足时回收后重试。
+ */
+typedef struct
+{
+    uint16_t    file_id;
+    uint16_t    key;
+    uint16_t    version;           /**< 数据开头的版本号，与flash中的不同时不读取。 */
+    uint16_t    length_words;      /**< 数据长度（字）。 */
+    void       *p_data;            /**< 内存中的数据。 */
+    void       *p_flash;           /**< 写入期间保持不变的副本，长度与p_data相同。 */
+    char const *p_name;            /**< 日志中的名称。 */
+    bool        ready;             /**< FDS初始化完成，记录已读取。 */
+    bool        save_pending;
+    bool        write_in_progress;
+} record_store_t;
+
+void record_store_save(record_store_t *p_store);
+bool record_store_on_fds_evt(record_store_t *p_store, fds_evt_t const *p_evt);
+
+#endif
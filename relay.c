@@ -0,0 +1,417 @@
+#include "relay.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "app_timer.h"
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "nrf_log.h"
+#include "nrf_sdh_ble.h"
+
+#include "ble_base.h"
+#include "channel.h"
+#include "command.h"
+#include "event_queue.h"
+#include "record_store.h"
+#include "scan.h"
+#include "time_sync.h"
+#include "utils.h"
+
+#define RELAY_CONFIG_VERSION 1
+
+/* 中继帧中各字段的偏移，命令和结果的格式相同，只有最后两个字节不同。 */
+#define FRAME_MAGIC 0
+#define FRAME_TARGET 1
+#define FRAME_MSG_ID 5
+#define FRAME_HOPS 7
+#define FRAME_OPCODE 8
+#define FRAME_CHANNEL 9
+#define FRAME_DURATION 10 /**< 命令：[时长ms:u16]。 */
+#define FRAME_RESULT 10   /**< 结果：[结果:u8][保留:u8]。 */
+
+STATIC_ASSERT(RELAY_FRAME_LEN <= BLE_BASE_ADV_RELAY_MAX);
+
+/**
+ * @brief 保存在FDS中的中继设置。
+ */
+typedef struct
+{
+    uint16_t version;
+    uint8_t  mode;
+    uint8_t  reserved;
+} relay_config_t;
+
+STATIC_ASSERT(sizeof(relay_config_t) % sizeof(uint32_t) == 0);
+
+/**
+ * @brief 在BLE事件中收到的中继帧，投递到主循环中处理。
+ */
+typedef struct
+{
+    uint64_t rx_ticks;
+    uint8_t  frame[RELAY_FRAME_LEN];
+} relay_rx_t;
+
+STATIC_ASSERT(sizeof(relay_rx_t) <= EVENT_QUEUE_ACTUATION_SLOT_SIZE);
+STATIC_ASSERT(sizeof(relay_rx_t) <= EVENT_QUEUE_BACKGROUND_SLOT_SIZE);
+
+/**
+ * @brief 等待发出的帧。
+ */
+typedef struct
+{
+    uint8_t frame[RELAY_FRAME_LEN];
+    bool    forward; /**< 转发其他开关的帧，发出时计入转发数。 */
+} relay_tx_t;
+
+/**
+ * @brief 最近收到或发出的帧，由标记、目标和消息ID区分。
+ */
+typedef struct
+{
+    uint32_t target;
+    uint16_t msg_id;
+    uint8_t  magic;
+} relay_seen_t;
+
+static void tx_work_handler(void *p_event_data, uint16_t event_size);
+static void config_apply_work_handler(void *p_event_data, uint16_t event_size);
+
+APP_TIMER_DEF(m_burst_timer_id);
+EVENT_QUEUE_WORK_DEF(m_tx_work, EVENT_LANE_BACKGROUND, tx_work_handler);
+EVENT_QUEUE_WORK_DEF(m_apply_work, EVENT_LANE_BACKGROUND, config_apply_work_handler);
+
+static relay_config_t        m_config;
+__ALIGN(4) static relay_config_t m_flash_config; /**< 写入FDS期间保持不变的副本，FDS要求按字对齐。 */
+static relay_fired_handler_t m_fired_handler;
+static record_store_t        m_store = {
+    .file_id = RELAY_FILE_ID,
+    .key = RELAY_RECORD_KEY,
+    .version = RELAY_CONFIG_VERSION,
+    .length_words = sizeof(relay_config_t) / sizeof(uint32_t),
+    .p_data = &m_config,
+    .p_flash = &m_flash_config,
+    .p_name = "Relay save",
+};
+static relay_seen_t          m_seen[RELAY_SEEN_MAX];
+static uint8_t               m_seen_next;
+static relay_tx_t            m_tx[RELAY_TX_DEPTH];
+static uint8_t               m_tx_head;
+static uint8_t               m_tx_count;
+static bool                  m_tx_active;   /**< 广播中正在发送一个帧。 */
+static volatile bool         m_burst_ended; /**< 当前帧的发送时间已到，在定时器中断中设置。 */
+static relay_status_t        m_status;
+
+/**
+ * @brief 检查一个帧是否已经收到或发出过，没有时记下，可以在中断中调用。
+ */
+static bool seen_check(uint8_t const *p_frame)
+{
+    uint32_t target = uint32_decode(&p_frame[FRAME_TARGET]);
+    uint16_t msg_id = uint16_decode(&p_frame[FRAME_MSG_ID]);
+    bool     seen = false;
+
+    CRITICAL_REGION_ENTER();
+    for (uint8_t i = 0; i < RELAY_SEEN_MAX; i++)
+    {
+        if (m_seen[i].magic == p_frame[FRAME_MAGIC] && m_seen[i].target == target && m_seen[i].msg_id == msg_id)
+        {
+            seen = true;
+            break;
+        }
+    }
+    if (!seen)
+    {
+        m_seen[m_seen_next].target = target;
+        m_seen[m_seen_next].msg_id = msg_id;
+        m_seen[m_seen_next].magic = p_frame[FRAME_MAGIC];
+        m_seen_next = (m_seen_next + 1) % RELAY_SEEN_MAX;
+    }
+    CRITICAL_REGION_EXIT();
+
+    return seen;
+}
+
+/**
+ * @brief 发出队列中的下一个帧，队列空时恢复广播中的设备地址。
+ *
+ * @details 连接时开关不广播，帧留在队列中，断开后再发出。
+ */
+static void tx_next(void)
+{
+    ble_base_link_info_t link;
+    relay_tx_t const    *p_tx = &m_tx[m_tx_head];
+    ret_code_t           err_code;
+
+    m_tx_active = false;
+    if (m_tx_count == 0 || ble_base_link_info_get(&link) == NRF_SUCCESS)
+    {
+        LOG_ERROR("Relay adv", ble_base_adv_relay_set(NULL, 0));
+        return;
+    }
+
+    err_code = ble_base_adv_relay_set(p_tx->frame, RELAY_FRAME_LEN);
+    LOG_ERROR("Relay adv", err_code);
+    if (err_code == NRF_SUCCESS && p_tx->forward)
+    {
+        m_status.forwarded++;
+    }
+    m_tx_head = (m_tx_head + 1) % RELAY_TX_DEPTH;
+    m_tx_count--;
+
+    m_tx_active = true;
+    err_code = app_timer_start(m_burst_timer_id, APP_TIMER_TICKS(RELAY_BURST_MS), NULL);
+    if (err_code != NRF_SUCCESS)
+    {
+        LOG_ERROR("Relay timer", err_code);
+        m_tx_active = false;
+    }
+}
+
+static void tx_enqueue(uint8_t const *p_frame, bool forward)
+{
+    relay_tx_t *p_tx = &m_tx[(m_tx_head + m_tx_count) % RELAY_TX_DEPTH];
+
+    if (m_tx_count == RELAY_TX_DEPTH)
+    {
+        m_status.dropped++;
+        return;
+    }
+
+    memcpy(p_tx->frame, p_frame, RELAY_FRAME_LEN);
+    p_tx->forward = forward;
+    m_tx_count++;
+
+    if (!m_tx_active)
+    {
+        tx_next();
+    }
+}
+
+/**
+ * @brief 当前帧发送结束或者断开后发出下一个帧。
+ */
+static void tx_work_handler(void *p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+
+    if (m_burst_ended)
+    {
+        m_burst_ended = false;
+        m_tx_active = false;
+    }
+    if (!m_tx_active)
+    {
+        tx_next();
+    }
+}
+
+/**
+ * @brief 丢失后发送队列会一直停住，使用不占用通道槽的工作项。
+ */
+static void burst_timeout_handler(void *p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    m_burst_ended = true;
+    event_queue_work_submit(&m_tx_work);
+}
+
+/**
+ * @brief 断开后发出连接期间留在队列中的帧。
+ */
+static void relay_on_ble_evt(ble_evt_t const *p_ble_evt, void *p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    if (p_ble_evt->header.evt_id == BLE_GAP_EVT_DISCONNECTED)
+    {
+        event_queue_work_submit(&m_tx_work);
+    }
+}
+
+NRF_SDH_BLE_OBSERVER(m_relay_observer, RELAY_BLE_OBSERVER_PRIO, relay_on_ble_evt, NULL);
+
+/**
+ * @brief 执行一条中继命令，只支持输出通道的即时动作。
+ */
+static ret_code_t relay_cmd_execute(uint8_t const *p_frame)
+{
+    uint8_t channel = p_frame[FRAME_CHANNEL];
+
+    switch (p_frame[FRAME_OPCODE])
+    {
+    case CMD_OP_PULSE:
+        return channel_pulse(channel, uint16_decode(&p_frame[FRAME_DURATION]));
+
+    case CMD_OP_PRESS:
+        return channel_press(channel);
+
+    case CMD_OP_RELEASE:
+        return channel_release(channel);
+
+    default:
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+}
+
+/**
+ * @brief 执行发给本开关的命令并发出结果，其他开关的命令和结果在转发模式下减少跳数后转发。
+ *
+ * @details 收到过的帧复位后就忘了，启动保护时间内收到的命令只以NRF_ERROR_INVALID_STATE作为结果，不执行。
+ */
+static void relay_rx_event_handler(void *p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(event_size);
+
+    relay_rx_t const *p_rx = (relay_rx_t const *)p_event_data;
+    uint8_t           frame[RELAY_FRAME_LEN];
+    ret_code_t        result;
+
+    memcpy(frame, p_rx->frame, RELAY_FRAME_LEN);
+
+    if (uint32_decode(&frame[FRAME_TARGET]) == ble_base_switch_id_get())
+    {
+        if (frame[FRAME_MAGIC] != RELAY_CMD_MAGIC)
+        {
+            return;
+        }
+
+        if (p_rx->rx_ticks < APP_TIMER_TICKS(RELAY_BOOT_HOLDOFF_MS))
+        {
+            result = NRF_ERROR_INVALID_STATE;
+        }
+        else
+        {
+            result = relay_cmd_execute(frame);
+            m_status.executed++;
+            if (m_fired_handler != NULL)
+            {
+                uint16_t duration_ms = (frame[FRAME_OPCODE] == CMD_OP_PULSE) ? uint16_decode(&frame[FRAME_DURATION]) : 0;
+                m_fired_handler(uint16_decode(&frame[FRAME_MSG_ID]), frame[FRAME_OPCODE], frame[FRAME_CHANNEL], duration_ms, result, p_rx->rx_ticks);
+            }
+        }
+
+        // 结果原路广播回去，记下自己的结果，转发回来时不再转发。
+        frame[FRAME_MAGIC] = RELAY_RESULT_MAGIC;
+        frame[FRAME_HOPS] = RELAY_HOPS_MAX;
+        frame[FRAME_RESULT] = (uint8_t)result;
+        frame[FRAME_RESULT + 1] = 0;
+        (void)seen_check(frame);
+        tx_enqueue(frame, false);
+        return;
+    }
+
+    if (m_config.mode != RELAY_MODE_FORWARD || frame[FRAME_HOPS] == 0)
+    {
+        return;
+    }
+
+    frame[FRAME_HOPS] = MIN(frame[FRAME_HOPS], RELAY_HOPS_MAX) - 1;
+    tx_enqueue(frame, true);
+}
+
+/**
+ * @brief 检查厂商数据是否为中继帧，在BLE事件中断上下文中调用。
+ *
+ * @details 帧格式为：[标记][目标开关ID:u32][消息ID:u16][跳数:u8][操作码][通道]，
+ *          命令之后为[时长ms:u16]，结果之后为[结果:u8][保留:u8]。
+ */
+static void scan_report_handler(uint8_t const *p_data, uint16_t len)
+{
+    relay_rx_t rx;
+    bool       local;
+
+    if (m_config.mode == RELAY_MODE_OFF || len != RELAY_FRAME_LEN || (p_data[FRAME_MAGIC] != RELAY_CMD_MAGIC && p_data[FRAME_MAGIC] != RELAY_RESULT_MAGIC))
+    {
+        return;
+    }
+
+    if (seen_check(p_data))
+    {
+        m_status.duplicates++;
+        return;
+    }
+    m_status.received++;
+
+    local = (uint32_decode(&p_data[FRAME_TARGET]) == ble_base_switch_id_get());
+    if (!local && m_config.mode != RELAY_MODE_FORWARD)
+    {
+        return;
+    }
+
+    rx.rx_ticks = time_sync_local_ticks();
+    memcpy(rx.frame, p_data, RELAY_FRAME_LEN);
+
+    // 发给本开关的命令与其他输出通道命令同等优先，转发放在后台。
+    (void)event_queue_put(local ? EVENT_LANE_ACTUATION : EVENT_LANE_BACKGROUND, &rx, sizeof(rx), relay_rx_event_handler);
+}
+
+static void config_apply(void)
+{
+    scan_user_set(SCAN_USER_RELAY, m_store.ready && m_config.mode != RELAY_MODE_OFF);
+}
+
+static void config_apply_work_handler(void *p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+
+    config_apply();
+}
+
+static void fds_evt_handler(fds_evt_t const *p_evt)
+{
+    if (record_store_on_fds_evt(&m_store, p_evt))
+    {
+        if (m_config.mode > RELAY_MODE_FORWARD)
+        {
+            m_config.mode = RELAY_MODE_OFF;
+        }
+        // 扫描在主循环中开始。
+        event_queue_work_submit(&m_apply_work);
+    }
+}
+
+/**
+ * @brief 初始化中继模块，需要在app_timer_init之后、fds_init之前调用，中继设置在FDS初始化完成后读取。
+ */
+ret_code_t relay_init(relay_fired_handler_t fired_handler)
+{
+    ret_code_t err_code;
+
+    m_fired_handler = fired_handler;
+    m_config.version = RELAY_CONFIG_VERSION;
+    scan_handler_set(SCAN_USER_RELAY, scan_report_handler);
+
+    err_code = app_timer_create(&m_burst_timer_id, APP_TIMER_MODE_SINGLE_SHOT, burst_timeout_handler);
+    VERIFY_SUCCESS(err_code);
+
+    return fds_register(fds_evt_handler);
+}
+
+/**
+ * @brief 设置中继模式并保存。
+ */
+ret_code_t relay_mode_set(uint8_t mode)
+{
+    if (mode > RELAY_MODE_FORWARD)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_config.mode = mode;
+    record_store_save(&m_store);
+    config_apply();
+
+    return NRF_SUCCESS;
+}
+
+void relay_status_get(relay_status_t *p_status)
+{
+    *p_status = m_status;
+    p_status->mode = m_config.mode;
+    p_status->switch_id = ble_base_switch_id_get();
+}
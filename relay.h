@@ -0,0 +1,57 @@
+#ifndef RELAY_H
+#define RELAY_H
+
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#ifndef RELAY_ENABLED
+#define RELAY_ENABLED 1 /**< 通过广播转发发给其他开关的命令，由Makefile的FEATURE_RELAY控制。 */
+#endif
+
+#ifndef RELAY_BLE_OBSERVER_PRIO
+#define RELAY_BLE_OBSERVER_PRIO 3 /**< 中继模块的BLE观察者优先级。 */
+#endif
+
+#define RELAY_FILE_ID 0x5200       /**< 中继设置的FDS文件ID。 */
+#define RELAY_RECORD_KEY 0x0001    /**< 中继设置的FDS记录键。 */
+#define RELAY_CMD_MAGIC 0xC8       /**< 中继命令的标记。 */
+#define RELAY_RESULT_MAGIC 0xC9    /**< 中继结果的标记。 */
+#define RELAY_FRAME_LEN 12         /**< 中继帧的长度（公司ID之后，字节）。 */
+#define RELAY_HOPS_MAX 4           /**< 命令带的跳数超过该值时按该值转发，结果以该跳数发出。 */
+#define RELAY_SEEN_MAX 16          /**< 记住的最近的帧数，重复收到的帧不再执行或转发。 */
+#define RELAY_TX_DEPTH 4           /**< 等待发出的帧数。 */
+#define RELAY_BURST_MS 1000        /**< 每个帧在广播中保持的时间。 */
+#define RELAY_BOOT_HOLDOFF_MS 5000 /**< 启动后该时间内只发出结果不执行，复位前收到的命令可能还在各跳之间转发。 */
+
+/**
+ * @brief 中继模式。
+ */
+typedef enum
+{
+    RELAY_MODE_OFF = 0,      /**< 不扫描中继帧。 */
+    RELAY_MODE_ENDPOINT = 1, /**< 执行发给本开关的中继命令并发出结果。 */
+    RELAY_MODE_FORWARD = 2,  /**< 同时转发发给其他开关的命令和结果。 */
+} relay_mode_t;
+
+typedef struct
+{
+    uint8_t  mode;       /**< @ref relay_mode_t */
+    uint32_t switch_id;  /**< 本开关的ID，设备地址的低32位。 */
+    uint32_t received;   /**< 收到的中继帧数（不含重复）。 */
+    uint32_t duplicates; /**< 重复收到的帧数。 */
+    uint32_t executed;   /**< 执行的命令数。 */
+    uint32_t forwarded;  /**< 在广播中发出的转发帧数。 */
+    uint32_t dropped;    /**< 发送队列满而丢弃的帧数。 */
+} relay_status_t;
+
+/**
+ * @brief 中继命令执行后的回调，在主循环中调用。
+ */
+typedef void (*relay_fired_handler_t)(uint16_t msg_id, uint8_t opcode, uint8_t channel, uint16_t duration_ms, ret_code_t result, uint64_t rx_ticks);
+
+ret_code_t relay_init(relay_fired_handler_t fired_handler);
+ret_code_t relay_mode_set(uint8_t mode);
+void       relay_status_get(relay_status_t *p_status);
+
+#endif
@@ -0,0 +1,120 @@
+#include "scan.h"
+
+#include "app_util.h"
+#include "ble_advdata.h"
+#include "ble_gap.h"
+#include "nrf_log.h"
+#include "nrf_sdh_ble.h"
+
+#include "phy_policy.h"
+#include "utils.h"
+
+#if PHY_POLICY_CODED_ENABLED
+#define SCAN_BUFFER_SIZE BLE_GAP_SCAN_BUFFER_EXTENDED_MIN
+#else
+#define SCAN_BUFFER_SIZE BLE_GAP_SCAN_BUFFER_MIN
+#endif
+
+static scan_report_handler_t m_handlers[SCAN_USER_COUNT];
+static uint8_t               m_users;   /**< 需要扫描的使用者，按位。 */
+static volatile bool         m_running;
+static uint8_t               m_buffer_data[SCAN_BUFFER_SIZE];
+static ble_data_t            m_buffer = {m_buffer_data, SCAN_BUFFER_SIZE};
+
+/**
+ * @brief 被动扫描。使用Coded PHY广播时开关之间的中继也在Coded PHY上，同时扫描两种PHY。
+ */
+static ble_gap_scan_params_t const m_scan_params = {
+#if PHY_POLICY_CODED_ENABLED
+    .extended = 1,
+    .scan_phys = BLE_GAP_PHY_1MBPS | BLE_GAP_PHY_CODED,
+#else
+    .scan_phys = BLE_GAP_PHY_1MBPS,
+#endif
+    .active = 0,
+    .interval = MSEC_TO_UNITS(SCAN_INTERVAL_MS, UNIT_0_625_MS),
+    .window = MSEC_TO_UNITS(SCAN_WINDOW_MS, UNIT_0_625_MS),
+    .timeout = BLE_GAP_SCAN_TIMEOUT_UNLIMITED,
+    .filter_policy = BLE_GAP_SCAN_FP_ACCEPT_ALL,
+};
+
+/**
+ * @brief 取出广播报告中的厂商数据，交给各使用者。
+ */
+static void adv_report_handle(ble_gap_evt_adv_report_t const *p_report)
+{
+    uint16_t offset = 0;
+    uint16_t len = ble_advdata_search(p_report->data.p_data, p_report->data.len, &offset, BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA);
+
+    if (len <= 2 || uint16_decode(&p_report->data.p_data[offset]) != SCAN_COMPANY_ID)
+    {
+        return;
+    }
+
+    for (uint8_t i = 0; i < SCAN_USER_COUNT; i++)
+    {
+        if (m_handlers[i] != NULL)
+        {
+            m_handlers[i](&p_report->data.p_data[offset + 2], len - 2);
+        }
+    }
+}
+
+static void scan_on_ble_evt(ble_evt_t const *p_ble_evt, void *p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    if (p_ble_evt->header.evt_id != BLE_GAP_EVT_ADV_REPORT)
+    {
+        return;
+    }
+
+    adv_report_handle(&p_ble_evt->evt.gap_evt.params.adv_report);
+
+    // 每个广播报告之后扫描暂停，需要交回缓冲区继续。
+    if (m_running)
+    {
+        (void)sd_ble_gap_scan_start(NULL, &m_buffer);
+    }
+}
+
+NRF_SDH_BLE_OBSERVER(m_scan_observer, SCAN_BLE_OBSERVER_PRIO, scan_on_ble_evt, NULL);
+
+void scan_handler_set(scan_user_t user, scan_report_handler_t handler)
+{
+    m_handlers[user] = handler;
+}
+
+/**
+ * @brief 设置一个使用者是否需要扫描，有使用者需要时扫描，都不需要时停止以节省功耗。在主循环中调用。
+ */
+void scan_user_set(scan_user_t user, bool enabled)
+{
+    ret_code_t err_code = NRF_SUCCESS;
+
+    if (enabled)
+    {
+        m_users |= (1 << user);
+    }
+    else
+    {
+        m_users &= ~(1 << user);
+    }
+
+    if (m_users != 0 && !m_running)
+    {
+        err_code = sd_ble_gap_scan_start(&m_scan_params, &m_buffer);
+        m_running = (err_code == NRF_SUCCESS);
+    }
+    else if (m_users == 0 && m_running)
+    {
+        m_running = false;
+        err_code = sd_ble_gap_scan_stop();
+    }
+    LOG_ERROR("Scan", err_code);
+}
+
+bool scan_is_running(void)
+{
+    return m_running;
+}
@@ -0,0 +1,36 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#ifndef SCAN_BLE_OBSERVER_PRIO
+#define SCAN_BLE_OBSERVER_PRIO 3 /**< 扫描模块的BLE观察者优先级。 */
+#endif
+
+#define SCAN_COMPANY_ID 0x0059     /**< 只处理该公司ID的厂商数据。 */
+#define SCAN_INTERVAL_MS 200       /**< 扫描间隔。 */
+#define SCAN_WINDOW_MS 20          /**< 扫描窗口，占空比10%。 */
+
+/**
+ * @brief 扫描的使用者，任一使用者需要时扫描。
+ */
+typedef enum
+{
+    SCAN_USER_GROUP, /**< 分组广播命令。 */
+    SCAN_USER_RELAY, /**< 中继命令和结果。 */
+    SCAN_USER_COUNT
+} scan_user_t;
+
+/**
+ * @brief 收到厂商数据后的回调，数据从公司ID之后开始，在BLE事件中断上下文中调用。
+ */
+typedef void (*scan_report_handler_t)(uint8_t const *p_data, uint16_t len);
+
+void scan_handler_set(scan_user_t user, scan_report_handler_t handler);
+void scan_user_set(scan_user_t user, bool enabled);
+bool scan_is_running(void);
+
+#endif
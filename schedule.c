@@ -0,0 +1,315 @@
+#include "schedule.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include "nrf_log.h"
+
+#include "channel.h"
+#include "record_store.h"
+#include "time_sync.h"
+#include "utils.h"
+
+#define SCHEDULE_TABLE_VERSION 1
+#define MAX_ARM_TICKS (APP_TIMER_MAX_CNT_VAL / 2) /**< 单次定时的最大长度，更远的规则分段等待。 */
+#define SECONDS_PER_DAY 86400UL
+#define US_PER_SECOND 1000000ULL
+#define EPOCH_WEEKDAY 4 /**< 1970-01-01是星期四。 */
+
+/**
+ * @brief 保存在FDS中的计划表。
+ */
+typedef struct
+{
+    uint16_t        version;
+    int16_t         tz_offset_min; /**< 本地时区相对UTC的偏移（分钟）。 */
+    schedule_rule_t rules[SCHEDULE_MAX_RULES];
+} schedule_table_t;
+
+STATIC_ASSERT(sizeof(schedule_rule_t) == SCHEDULE_RULE_WIRE_SIZE);
+STATIC_ASSERT(sizeof(schedule_table_t) % sizeof(uint32_t) == 0);
+STATIC_ASSERT(SCHEDULE_MAX_RULES <= 8);
+
+APP_TIMER_DEF(m_alarm_timer_id); /**< 计划表只使用一个RTC闹钟，指向下一个到期的规则。 */
+
+static schedule_table_t         m_table;
+static schedule_table_t         m_flash_table; /**< 写入FDS期间保持不变的副本。 */
+static uint64_t                 m_next_ticks[SCHEDULE_MAX_RULES]; /**< 在闹钟中断、FDS事件中断和主循环中访问，读写都在临界区内。 */
+static schedule_fired_handler_t m_fired_handler;
+static record_store_t           m_store = {
+    .file_id = SCHEDULE_FILE_ID,
+    .key = SCHEDULE_RECORD_KEY,
+    .version = SCHEDULE_TABLE_VERSION,
+    .length_words = sizeof(schedule_table_t) / sizeof(uint32_t),
+    .p_data = &m_table,
+    .p_flash = &m_flash_table,
+    .p_name = "Schedule save",
+};
+
+/**
+ * @brief 计算每天规则在指定主机时间之后的下一次执行时间（主机时间，秒）。
+ */
+static uint64_t daily_next_s(schedule_rule_t const *p_rule, uint64_t host_s)
+{
+    int64_t tz_s = (int64_t)m_table.tz_offset_min * 60;
+    int64_t local_s = (int64_t)host_s + tz_s;
+    int64_t day = local_s / SECONDS_PER_DAY;
+    uint8_t weekdays = (p_rule->weekdays == 0) ? 0x7F : p_rule->weekdays;
+
+    for (uint8_t i = 0; i <= 7; i++, day++)
+    {
+        int64_t candidate = day * SECONDS_PER_DAY + (int64_t)p_rule->minute_of_day * 60;
+        uint8_t weekday = (uint8_t)((day + EPOCH_WEEKDAY) % 7);
+
+        if (candidate > local_s && (weekdays & (1 << weekday)))
+        {
+            return (uint64_t)(candidate - tz_s);
+        }
+    }
+
+    return UINT64_MAX;
+}
+
+/**
+ * @brief 计算规则在当前时刻之后的下一次执行时间（本地tick），无法执行时返回UINT64_MAX。
+ */
+static uint64_t rule_next_ticks(schedule_rule_t const *p_rule, uint64_t now_ticks)
+{
+    uint64_t host_us;
+    uint64_t next_ticks;
+    bool     synced = time_sync_to_host_us(now_ticks, &host_us);
+
+    switch (p_rule->type)
+    {
+    case SCHEDULE_RULE_DAILY:
+    {
+        if (!synced || p_rule->minute_of_day >= 24 * 60)
+        {
+            return UINT64_MAX;
+        }
+        uint64_t next_s = daily_next_s(p_rule, host_us / US_PER_SECOND);
+        if (next_s == UINT64_MAX || !time_sync_from_host_us(next_s * US_PER_SECOND, &next_ticks))
+        {
+            return UINT64_MAX;
+        }
+        return next_ticks;
+    }
+
+    case SCHEDULE_RULE_INTERVAL:
+    {
+        if (p_rule->interval_s == 0)
+        {
+            return UINT64_MAX;
+        }
+        uint64_t interval_us = (uint64_t)p_rule->interval_s * US_PER_SECOND;
+        if (synced)
+        {
+            uint64_t next_host_us = (host_us / interval_us + 1) * interval_us;
+            return time_sync_from_host_us(next_host_us, &next_ticks) ? next_ticks : UINT64_MAX;
+        }
+        uint64_t local_us = time_sync_ticks_to_us(now_ticks);
+        return time_sync_us_to_ticks((local_us / interval_us + 1) * interval_us);
+    }
+
+    default:
+        return UINT64_MAX;
+    }
+}
+
+/**
+ * @brief 重新计算所有规则的下一次执行时间，并把闹钟设置到最早的一个。
+ *
+ * @details 计算和设置闹钟在同一个临界区内，其他上下文不会在两者之间修改规则，闹钟不会被设置到过时的时刻。
+ *          app_timer_start只把操作放入队列，可以在临界区内调用。
+ */
+static void alarm_rearm(void)
+{
+    uint64_t   now = time_sync_local_ticks();
+    uint64_t   earliest = UINT64_MAX;
+    ret_code_t err_code = NRF_SUCCESS;
+
+    CRITICAL_REGION_ENTER();
+    for (uint8_t i = 0; i < SCHEDULE_MAX_RULES; i++)
+    {
+        if (m_next_ticks[i] == UINT64_MAX)
+        {
+            m_next_ticks[i] = rule_next_ticks(&m_table.rules[i], now);
+        }
+        earliest = MIN(earliest, m_next_ticks[i]);
+    }
+
+    (void)app_timer_stop(m_alarm_timer_id);
+    if (earliest != UINT64_MAX)
+    {
+        uint64_t delay = (earliest > now) ? (earliest - now) : 0;
+
+        delay = MIN(delay, MAX_ARM_TICKS);
+        delay = MAX(delay, APP_TIMER_MIN_TIMEOUT_TICKS);
+        err_code = app_timer_start(m_alarm_timer_id, (uint32_t)delay, NULL);
+    }
+    CRITICAL_REGION_EXIT();
+
+    LOG_ERROR("Schedule alarm", err_code);
+}
+
+/**
+ * @brief 闹钟回调，执行所有到期的规则。
+ *
+ * @details 在临界区内取出到期的规则并计算下一次执行时间，输出和回调在临界区外执行。
+ */
+static void alarm_timeout_handler(void *p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    uint64_t        now = time_sync_local_ticks();
+    schedule_rule_t rules[SCHEDULE_MAX_RULES];
+    uint8_t         due = 0;
+
+    CRITICAL_REGION_ENTER();
+    for (uint8_t i = 0; i < SCHEDULE_MAX_RULES; i++)
+    {
+        if (m_next_ticks[i] == UINT64_MAX || m_next_ticks[i] > now)
+        {
+            continue;
+        }
+
+        due |= 1 << i;
+        rules[i] = m_table.rules[i];
+
+        // 从到期时刻之后开始计算，避免同一时刻重复执行。
+        m_next_ticks[i] = rule_next_ticks(&m_table.rules[i], MAX(now, m_next_ticks[i] + 1));
+    }
+    CRITICAL_REGION_EXIT();
+
+    for (uint8_t i = 0; i < SCHEDULE_MAX_RULES; i++)
+    {
+        if (!(due & (1 << i)))
+        {
+            continue;
+        }
+
+        ret_code_t result = channel_pulse(rules[i].channel, rules[i].duration_ms);
+        NRF_LOG_INFO("Schedule rule %d fired, result %d.", i, result);
+        m_fired_handler(i, &rules[i], result, now);
+    }
+
+    alarm_rearm();
+}
+
+static void fds_evt_handler(fds_evt_t const *p_evt)
+{
+    if (record_store_on_fds_evt(&m_store, p_evt))
+    {
+        schedule_time_changed();
+    }
+}
+
+/**
+ * @brief 初始化计划表，需要在fds_init之前调用，计划表在FDS初始化完成后读取。
+ */
+ret_code_t schedule_init(schedule_fired_handler_t fired_handler)
+{
+    ret_code_t err_code;
+
+    if (fired_handler == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    m_fired_handler = fired_handler;
+    m_table.version = SCHEDULE_TABLE_VERSION;
+    for (uint8_t i = 0; i < SCHEDULE_MAX_RULES; i++)
+    {
+        m_next_ticks[i] = UINT64_MAX;
+    }
+
+    err_code = app_timer_create(&m_alarm_timer_id, APP_TIMER_MODE_SINGLE_SHOT, alarm_timeout_handler);
+    VERIFY_SUCCESS(err_code);
+
+    return fds_register(fds_evt_handler);
+}
+
+/**
+ * @brief 设置一条规则并保存，类型为SCHEDULE_RULE_NONE时删除该规则。
+ */
+ret_code_t schedule_rule_set(uint8_t index, schedule_rule_t const *p_rule)
+{
+    if (index >= SCHEDULE_MAX_RULES || p_rule->type > SCHEDULE_RULE_INTERVAL)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (p_rule->type != SCHEDULE_RULE_NONE && (p_rule->channel >= CHANNEL_COUNT || p_rule->duration_ms == 0 || p_rule->duration_ms > CHANNEL_PULSE_MAX_MS))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    CRITICAL_REGION_ENTER();
+    m_table.rules[index] = *p_rule;
+    m_next_ticks[index] = UINT64_MAX;
+    CRITICAL_REGION_EXIT();
+
+    alarm_rearm();
+    record_store_save(&m_store);
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 读取一条规则及其下一次执行时间（本地tick，不会执行时为UINT64_MAX）。
+ */
+ret_code_t schedule_rule_get(uint8_t index, schedule_rule_t *p_rule, uint64_t *p_next_ticks)
+{
+    if (index >= SCHEDULE_MAX_RULES)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    CRITICAL_REGION_ENTER();
+    *p_rule = m_table.rules[index];
+    *p_next_ticks = m_next_ticks[index];
+    CRITICAL_REGION_EXIT();
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 设置本地时区，每天规则的时刻按本地时间计算。
+ */
+ret_code_t schedule_tz_set(int16_t tz_offset_min)
+{
+    if (tz_offset_min < -14 * 60 || tz_offset_min > 14 * 60)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_table.tz_offset_min = tz_offset_min;
+    schedule_time_changed();
+    record_store_save(&m_store);
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 时间基准发生变化（同步或时区修改）后重新计算所有规则。
+ *
+ * @details 每次时间采样都会调用。已经到期、闹钟还没有执行的规则保留原来的时间，重新设置的闹钟会立即执行它们，
+ *          否则按新的时间基准计算会跳到下一次。
+ */
+void schedule_time_changed(void)
+{
+    uint64_t now = time_sync_local_ticks();
+
+    CRITICAL_REGION_ENTER();
+    for (uint8_t i = 0; i < SCHEDULE_MAX_RULES; i++)
+    {
+        if (m_next_ticks[i] > now)
+        {
+            m_next_ticks[i] = UINT64_MAX;
+        }
+    }
+    CRITICAL_REGION_EXIT();
+
+    alarm_rearm();
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#define SCHEDULE_MAX_RULES 8        /**< 计划表的规则数量。 */
+#define SCHEDULE_FILE_ID 0x5C00     /**< 计划表的FDS文件ID。 */
+#define SCHEDULE_RECORD_KEY 0x0001  /**< 计划表的FDS记录键。 */
+#define SCHEDULE_RULE_WIRE_SIZE 12  /**< 规则在BLE协议中的长度（字节）。 */
+
+/**
+ * @brief 规则类型。
+ */
+typedef enum
+{
+    SCHEDULE_RULE_NONE = 0,     /**< 空规则。 */
+    SCHEDULE_RULE_DAILY = 1,    /**< 每天（或每周指定几天）的固定时刻。 */
+    SCHEDULE_RULE_INTERVAL = 2, /**< 固定间隔，按主机时间的整数倍对齐，未同步时按本地时间对齐。 */
+} schedule_rule_type_t;
+
+/**
+ * @brief 计划规则，与协议中的格式相同（小端序，12字节）。
+ */
+typedef struct
+{
+    uint8_t  type;          /**< @ref schedule_rule_type_t */
+    uint8_t  channel;       /**< 通道编号。 */
+    uint16_t duration_ms;   /**< 脉冲时长（毫秒）。 */
+    uint8_t  weekdays;      /**< 每天规则生效的星期，bit0为周日，0表示每天。 */
+    uint8_t  reserved;
+    uint16_t minute_of_day; /**< 每天规则的时刻（本地时间，0~1439）。 */
+    uint32_t interval_s;    /**< 间隔规则的间隔（秒）。 */
+} schedule_rule_t;
+
+/**
+ * @brief 规则执行后的回调，在RTC中断上下文中调用。
+ */
+typedef void (*schedule_fired_handler_t)(uint8_t index, schedule_rule_t const *p_rule, ret_code_t result, uint64_t fired_ticks);
+
+ret_code_t schedule_init(schedule_fired_handler_t fired_handler);
+ret_code_t schedule_rule_set(uint8_t index, schedule_rule_t const *p_rule);
+ret_code_t schedule_rule_get(uint8_t index, schedule_rule_t *p_rule, uint64_t *p_next_ticks);
+ret_code_t schedule_tz_set(int16_t tz_offset_min);
+void       schedule_time_changed(void);
+
+#endif
\ No newline at end of file
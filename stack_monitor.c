@@ -0,0 +1,65 @@
+#include "stack_monitor.h"
+
+#include <stdbool.h>
+
+#include "nrf.h"
+#include "nrf_log.h"
+
+#include "metrics.h"
+
+extern uint32_t __StackLimit; /**< 栈底（最低地址），由启动文件按__STACK_SIZE定义。 */
+extern uint32_t __StackTop;   /**< 栈顶（初始栈指针）。 */
+
+static bool m_overflow_reported;
+
+/**
+ * @brief 用固定值填充还未使用的栈，需要在main开始时最先调用。
+ *
+ * @details 所有中断共用主栈（MSP），SoftDevice的中断也在这个栈上运行，所以统计的是所有上下文嵌套后的最大用量。
+ */
+void stack_monitor_init(void)
+{
+#if STACK_MONITOR_ENABLED
+    uint32_t *p_word = &__StackLimit;
+    uint32_t *p_end = (uint32_t *)(__get_MSP() - STACK_MONITOR_MARGIN);
+
+    while (p_word < p_end)
+    {
+        *p_word++ = STACK_MONITOR_PAINT;
+    }
+#endif
+}
+
+/**
+ * @brief 从栈底向上查找第一个被改写的字，更新栈最大用量指标，返回最大用量（字节）。
+ *
+ * @details 已使用的部分不会再变回填充值，扫描长度为剩余的栈空间，4 KB的栈最多约1000个字。
+ */
+uint32_t stack_monitor_update(void)
+{
+#if STACK_MONITOR_ENABLED
+    uint32_t const *p_word = &__StackLimit;
+    uint32_t        size = (uint32_t)&__StackTop - (uint32_t)&__StackLimit;
+
+    while (p_word < &__StackTop && *p_word == STACK_MONITOR_PAINT)
+    {
+        p_word++;
+    }
+
+    uint32_t used = (uint32_t)&__StackTop - (uint32_t)p_word;
+
+    if (p_word == &__StackLimit && !m_overflow_reported)
+    {
+        // 栈底已被改写，栈可能已经溢出到.bss或堆。
+        m_overflow_reported = true;
+        NRF_LOG_ERROR("Stack limit reached (%d bytes).", size);
+    }
+
+    metrics_gauge_max(METRIC_STACK_HIGH_WATER, used);
+    metrics_gauge_set(METRIC_STACK_SIZE, size);
+
+    return used;
+#else
+    return 0;
+#endif
+}
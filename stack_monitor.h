@@ -0,0 +1,16 @@
+#ifndef STACK_MONITOR_H
+#define STACK_MONITOR_H
+
+#include <stdint.h>
+
+#ifndef STACK_MONITOR_ENABLED
+#define STACK_MONITOR_ENABLED 1 /**< 启动时填充栈并统计最大用量，关闭后不占用启动时间。 */
+#endif
+
+#define STACK_MONITOR_PAINT 0x5AA5C33C /**< 填充值，与常见的0、0xFF和地址值都不同。 */
+#define STACK_MONITOR_MARGIN 64        /**< 填充时在当前栈指针之下保留的字节数，留给填充函数自己。 */
+
+void     stack_monitor_init(void);
+uint32_t stack_monitor_update(void);
+
+#endif
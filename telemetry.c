@@ -0,0 +1,223 @@
+#include "telemetry.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "app_timer.h"
+#include "app_util.h"
+#include "nrf_log.h"
+
+#include "archive_spim.h"
+#include "boot_time.h"
+#include "event_queue.h"
+#include "metrics.h"
+#include "time_sync.h"
+#include "utils.h"
+
+#define RECORD_TIME_SIZE 8 /**< [运行时间s:u32][主机时间s:u32] */
+
+STATIC_ASSERT(RECORD_TIME_SIZE + METRICS_RECORD_SIZE <= ARCHIVE_RECORD_MAX_LEN);
+
+/**
+ * @brief 在中断中产生的短记录，投递到主循环中追加。
+ */
+typedef struct
+{
+    uint8_t type;
+    uint8_t len;
+    uint8_t data[RECORD_TIME_SIZE + 8];
+} record_t;
+
+STATIC_ASSERT(sizeof(record_t) <= EVENT_QUEUE_BACKGROUND_SLOT_SIZE);
+
+static void op_done_event_handler(void *p_event_data, uint16_t event_size);
+
+APP_TIMER_DEF(m_metrics_timer_id);
+EVENT_QUEUE_WORK_DEF(m_op_done_work, EVENT_LANE_BACKGROUND, op_done_event_handler);
+
+static archive_t           m_archive;
+static archive_backend_t   m_backend;
+static uint8_t             m_metrics_count; /**< 上次写入未满的页之后记录的指标快照数。 */
+static volatile ret_code_t m_op_result;     /**< 后端完成的操作的结果，同一时间只有一个操作。 */
+
+static void time_encode(uint64_t ticks, uint8_t *p_data)
+{
+    uint64_t host_us = 0;
+
+    (void)time_sync_to_host_us(ticks, &host_us);
+    uint32_encode((uint32_t)(time_sync_ticks_to_us(ticks) / 1000000), &p_data[0]);
+    uint32_encode((uint32_t)(host_us / 1000000), &p_data[4]);
+}
+
+static void op_done_event_handler(void *p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+
+    ret_code_t result = m_op_result;
+
+    archive_op_done(&m_archive, result);
+    if (result != NRF_SUCCESS)
+    {
+        NRF_LOG_WARNING("Archive write failed, error %d.", result);
+    }
+}
+
+/**
+ * @brief 后端在SPIM或app_timer中断中完成写入，交给主循环处理。
+ *
+ * @details 丢失完成事件后存档会一直等待，使用不占用通道槽的工作项，不会被通道中的记录挤掉。
+ */
+static void op_done_handler(ret_code_t result)
+{
+    m_op_result = result;
+    event_queue_work_submit(&m_op_done_work);
+}
+
+static void record_event_handler(void *p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(event_size);
+
+    record_t const *p_record = (record_t const *)p_event_data;
+
+    (void)archive_append(&m_archive, p_record->type, p_record->data, p_record->len);
+}
+
+static void record_put(uint8_t type, uint8_t const *p_data, uint8_t len, uint64_t ticks)
+{
+    record_t record = {.type = type, .len = RECORD_TIME_SIZE + len};
+
+    time_encode(ticks, record.data);
+    memcpy(&record.data[RECORD_TIME_SIZE], p_data, len);
+
+    (void)event_queue_put(EVENT_LANE_BACKGROUND, &record, offsetof(record_t, data) + record.len, record_event_handler);
+}
+
+/**
+ * @brief 存档写入失败后重新挂载，在记录指标快照和主机要求写入时重试。
+ */
+static void remount_if_failed(void)
+{
+    archive_status_t status;
+    ret_code_t       err_code;
+
+    archive_status_get(&m_archive, &status);
+    if (status.state != ARCHIVE_FAILED)
+    {
+        return;
+    }
+
+    err_code = archive_remount(&m_archive);
+    if (err_code == NRF_SUCCESS)
+    {
+        archive_status_get(&m_archive, &status);
+        NRF_LOG_INFO("Archive remounted, head %d.", status.head);
+    }
+    LOG_ERROR("Archive remount", err_code);
+}
+
+/**
+ * @brief 记录指标快照，每TELEMETRY_FLUSH_EVERY次把没有填满的页写入flash。
+ */
+static void metrics_event_handler(void *p_event_data, uint16_t event_size)
+{
+    uint8_t  data[RECORD_TIME_SIZE + METRICS_RECORD_SIZE];
+    uint16_t len;
+
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+
+    remount_if_failed();
+
+    time_encode(time_sync_local_ticks(), data);
+    len = metrics_snapshot(&data[RECORD_TIME_SIZE], METRICS_RECORD_SIZE);
+    (void)archive_append(&m_archive, TELEMETRY_RECORD_METRICS, data, (uint8_t)(RECORD_TIME_SIZE + len));
+
+    if (++m_metrics_count >= TELEMETRY_FLUSH_EVERY)
+    {
+        m_metrics_count = 0;
+        (void)archive_flush(&m_archive);
+    }
+}
+
+static void metrics_timeout_handler(void *p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    (void)event_queue_put(EVENT_LANE_BACKGROUND, NULL, 0, metrics_event_handler);
+}
+
+/**
+ * @brief 挂载外部flash上的存档并记录一次启动，需要在app_timer_init之后调用。
+ *
+ * @details 挂载时读取所有扇区头，1 MB的flash约需10 ms，在广播开始之后的初始化中调用。
+ */
+ret_code_t telemetry_init(void)
+{
+    ret_code_t       err_code;
+    boot_time_t      boot_time;
+    archive_status_t status;
+    uint8_t          boot[8];
+
+    err_code = archive_spim_init(&m_backend, op_done_handler);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = archive_init(&m_archive, &m_backend);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = app_timer_create(&m_metrics_timer_id, APP_TIMER_MODE_REPEATED, metrics_timeout_handler);
+    VERIFY_SUCCESS(err_code);
+    err_code = app_timer_start(m_metrics_timer_id, APP_TIMER_TICKS(TELEMETRY_METRICS_INTERVAL_S * 1000), NULL);
+    VERIFY_SUCCESS(err_code);
+
+    archive_status_get(&m_archive, &status);
+    NRF_LOG_INFO("Archive mounted, records %d..%d.", status.oldest, status.head);
+
+    boot_time_get(&boot_time);
+    uint32_encode(boot_time.reset_reason, &boot[0]);
+    uint32_encode(APP_VERSION, &boot[4]);
+    record_put(TELEMETRY_RECORD_BOOT, boot, sizeof(boot), time_sync_local_ticks());
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 记录一次输出动作，可以在中断中调用。
+ */
+void telemetry_actuation(uint8_t source, uint8_t opcode, uint8_t channel, ret_code_t result, uint64_t ticks)
+{
+    uint8_t data[4] = {source, opcode, channel, (uint8_t)result};
+
+    record_put(TELEMETRY_RECORD_ACTUATION, data, sizeof(data), ticks);
+}
+
+void telemetry_power_state(bool host_on, uint32_t power_mw, uint64_t ticks)
+{
+    uint8_t data[5] = {host_on};
+
+    uint32_encode(power_mw, &data[1]);
+    record_put(TELEMETRY_RECORD_POWER_STATE, data, sizeof(data), ticks);
+}
+
+/**
+ * @brief 从游标处读取记录，参见archive_read。
+ */
+ret_code_t telemetry_read(uint32_t *p_cursor, uint8_t *p_data, uint16_t *p_len)
+{
+    return archive_read(&m_archive, p_cursor, p_data, p_len);
+}
+
+/**
+ * @brief 把没有填满的页写入flash，存档失败时先重新挂载。
+ */
+ret_code_t telemetry_flush(void)
+{
+    remount_if_failed();
+
+    return archive_flush(&m_archive);
+}
+
+void telemetry_status_get(archive_status_t *p_status)
+{
+    archive_status_get(&m_archive, p_status);
+}
@@ -0,0 +1,49 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#include "archive.h"
+
+#ifndef TELEMETRY_ENABLED
+#define TELEMETRY_ENABLED 1 /**< 外部flash上的遥测存档，由Makefile的FEATURE_TELEMETRY控制。 */
+#endif
+
+#define TELEMETRY_METRICS_INTERVAL_S 900 /**< 记录指标快照的间隔（秒）。 */
+#define TELEMETRY_FLUSH_EVERY 4          /**< 每记录几次指标快照，把没有填满的页写入flash。 */
+
+/**
+ * @brief 记录类型。每条记录的数据以[运行时间s:u32][主机时间s:u32]开始，未同步时主机时间为0。
+ */
+typedef enum
+{
+    TELEMETRY_RECORD_BOOT = 0x01,        /**< [复位原因:u32][应用版本:u32]，每次启动记录一次。 */
+    TELEMETRY_RECORD_ACTUATION = 0x02,   /**< [来源:u8][操作码:u8][通道:u8][结果:u8]。 */
+    TELEMETRY_RECORD_POWER_STATE = 0x03, /**< [主机开机:u8][功率mW:u32]，时间为第一个越过阈值的样本。 */
+    TELEMETRY_RECORD_METRICS = 0x04,     /**< 指标快照，格式与指标特征值相同。 */
+} telemetry_record_t;
+
+/**
+ * @brief 输出动作的来源。
+ */
+typedef enum
+{
+    TELEMETRY_SOURCE_COMMAND,  /**< BLE命令。 */
+    TELEMETRY_SOURCE_TIMED,    /**< 定时脉冲。 */
+    TELEMETRY_SOURCE_SCHEDULE, /**< 计划规则。 */
+    TELEMETRY_SOURCE_BUTTON,   /**< 本地按键，与动作日志的编号保持一致。 */
+    TELEMETRY_SOURCE_GROUP,    /**< 分组广播命令。 */
+    TELEMETRY_SOURCE_RELAY,    /**< 中继命令。 */
+} telemetry_source_t;
+
+ret_code_t telemetry_init(void);
+void       telemetry_actuation(uint8_t source, uint8_t opcode, uint8_t channel, ret_code_t result, uint64_t ticks);
+void       telemetry_power_state(bool host_on, uint32_t power_mw, uint64_t ticks);
+ret_code_t telemetry_read(uint32_t *p_cursor, uint8_t *p_data, uint16_t *p_len);
+ret_code_t telemetry_flush(void);
+void       telemetry_status_get(archive_status_t *p_status);
+
+#endif
@@ -0,0 +1,200 @@
+#include "time_sync.h"
+
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include "nrf_log.h"
+
+#define RTC_COUNTER_BITS 24 /**< RTC计数器位宽。 */
+#define PPB 1000000000LL
+
+static uint32_t m_last_cnt; /**< 上一次读取的RTC计数值。 */
+static uint64_t m_cnt_high; /**< 扩展后的高位。 */
+
+static bool     m_synced;
+static uint64_t m_ref_local_us;    /**< 当前模型的参考点（本地时间）。 */
+static int64_t  m_offset_us;       /**< 参考点处的主机时间减本地时间。 */
+static int32_t  m_drift_ppb;
+static bool     m_drift_valid;
+static uint64_t m_anchor_local_us; /**< 用于估计漂移的锚点（本地时间）。 */
+static int64_t  m_anchor_offset_us;
+static uint32_t m_rtt_us;
+static uint32_t m_samples;
+
+/**
+ * @brief 获取64位的本地RTC计数值。
+ *
+ * @details RTC1只有24位，每1024秒溢出一次（16384Hz），这里通过记录上一次的计数值扩展为64位，
+ *          因此两次调用的间隔不能超过一个溢出周期，由主循环中的秒定时器保证。
+ */
+uint64_t time_sync_local_ticks(void)
+{
+    uint64_t ticks;
+
+    CRITICAL_REGION_ENTER();
+    uint32_t cnt = app_timer_cnt_get();
+    if (cnt < m_last_cnt)
+    {
+        m_cnt_high += (1ULL << RTC_COUNTER_BITS);
+    }
+    m_last_cnt = cnt;
+    ticks = m_cnt_high | cnt;
+    CRITICAL_REGION_EXIT();
+
+    return ticks;
+}
+
+uint64_t time_sync_ticks_to_us(uint64_t ticks)
+{
+    return ticks * 1000000ULL / APP_TIMER_CLOCK_FREQ;
+}
+
+uint64_t time_sync_us_to_ticks(uint64_t local_us)
+{
+    return local_us * APP_TIMER_CLOCK_FREQ / 1000000ULL;
+}
+
+/**
+ * @brief 加入一次时间戳交换的结果，更新偏移和漂移估计。
+ *
+ * @details 与NTP相同的四个时间戳：主机发送时间t1，设备接收时间t2，设备发送时间t3，主机接收时间t4。
+ *          偏移取两个方向的平均值，漂移由相隔足够远的两个样本的偏移变化估计，并做指数平滑。
+ *
+ * @retval NRF_ERROR_INVALID_PARAM 时间戳顺序不正确。
+ * @retval NRF_ERROR_INVALID_DATA  往返时间过长，样本被丢弃。
+ */
+ret_code_t time_sync_sample_add(uint64_t t1_host_us, uint64_t t2_ticks, uint64_t t3_ticks, uint64_t t4_host_us)
+{
+    uint64_t t2_us = time_sync_ticks_to_us(t2_ticks);
+    uint64_t t3_us = time_sync_ticks_to_us(t3_ticks);
+
+    if (t4_host_us < t1_host_us || t3_us < t2_us)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    int64_t rtt_us = (int64_t)(t4_host_us - t1_host_us) - (int64_t)(t3_us - t2_us);
+    if (rtt_us < 0)
+    {
+        rtt_us = 0;
+    }
+    if (rtt_us > TIME_SYNC_MAX_RTT_US)
+    {
+        NRF_LOG_DEBUG("Time sync sample dropped, rtt %u us.", (uint32_t)rtt_us);
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    int64_t  offset_us = (((int64_t)t1_host_us - (int64_t)t2_us) + ((int64_t)t4_host_us - (int64_t)t3_us)) / 2;
+    uint64_t local_us = t2_us + (t3_us - t2_us) / 2;
+
+    CRITICAL_REGION_ENTER();
+    if (!m_synced)
+    {
+        m_anchor_local_us = local_us;
+        m_anchor_offset_us = offset_us;
+        m_drift_valid = false;
+        m_drift_ppb = 0;
+        m_samples = 0;
+    }
+    else if (local_us > m_anchor_local_us && local_us - m_anchor_local_us >= TIME_SYNC_MIN_DRIFT_SPAN_US)
+    {
+        int64_t  delta_us = offset_us - m_anchor_offset_us;
+        uint64_t span_us = local_us - m_anchor_local_us;
+        // 先检查偏移变化是否超过上限，主机时钟跳变时偏移变化乘以PPB会溢出。上限先除后乘，不会溢出。
+        int64_t max_delta_us = (int64_t)(span_us / PPB * TIME_SYNC_MAX_DRIFT_PPB + span_us % PPB * TIME_SYNC_MAX_DRIFT_PPB / PPB);
+
+        if (delta_us > max_delta_us || delta_us < -max_delta_us)
+        {
+            // 主机时钟发生了跳变，重新开始估计。
+            m_drift_valid = false;
+            m_drift_ppb = 0;
+        }
+        else
+        {
+            // 偏移变化不超过上限时，按毫秒计算的乘积在任何跨度下都不会溢出。
+            int32_t drift_ppb = (int32_t)(delta_us * (PPB / 1000) / (int64_t)(span_us / 1000));
+
+            if (m_drift_valid)
+            {
+                m_drift_ppb += (drift_ppb - m_drift_ppb) / (1 << TIME_SYNC_DRIFT_FILTER_SHIFT);
+            }
+            else
+            {
+                m_drift_ppb = drift_ppb;
+                m_drift_valid = true;
+            }
+        }
+
+        m_anchor_local_us = local_us;
+        m_anchor_offset_us = offset_us;
+    }
+
+    m_ref_local_us = local_us;
+    m_offset_us = offset_us;
+    m_rtt_us = (uint32_t)rtt_us;
+    m_samples++;
+    m_synced = true;
+    CRITICAL_REGION_EXIT();
+
+    NRF_LOG_INFO("Time synced, rtt %u us, drift %d ppb.", (uint32_t)rtt_us, m_drift_ppb);
+
+    return NRF_SUCCESS;
+}
+
+/**
+ * @brief 将本地RTC计数值转换为主机时间。
+ *
+ * @return 未同步时返回false。
+ */
+bool time_sync_to_host_us(uint64_t ticks, uint64_t *p_host_us)
+{
+    bool synced;
+
+    CRITICAL_REGION_ENTER();
+    synced = m_synced;
+    if (synced)
+    {
+        uint64_t local_us = time_sync_ticks_to_us(ticks);
+        int64_t  elapsed_us = (int64_t)(local_us - m_ref_local_us);
+
+        *p_host_us = (uint64_t)((int64_t)local_us + m_offset_us + elapsed_us * m_drift_ppb / PPB);
+    }
+    CRITICAL_REGION_EXIT();
+
+    return synced;
+}
+
+/**
+ * @brief 将主机时间转换为本地RTC计数值。
+ *
+ * @return 未同步或该时间早于本地时间零点时返回false。
+ */
+bool time_sync_from_host_us(uint64_t host_us, uint64_t *p_ticks)
+{
+    bool valid;
+
+    CRITICAL_REGION_ENTER();
+    int64_t local_us = (int64_t)host_us - m_offset_us;
+
+    // 漂移很小，做一次修正即可。
+    local_us -= (local_us - (int64_t)m_ref_local_us) * m_drift_ppb / PPB;
+
+    valid = m_synced && local_us >= 0;
+    if (valid)
+    {
+        *p_ticks = time_sync_us_to_ticks((uint64_t)local_us);
+    }
+    CRITICAL_REGION_EXIT();
+
+    return valid;
+}
+
+void time_sync_status_get(time_sync_status_t *p_status)
+{
+    CRITICAL_REGION_ENTER();
+    p_status->synced = m_synced;
+    p_status->offset_us = m_offset_us;
+    p_status->drift_ppb = m_drift_ppb;
+    p_status->rtt_us = m_rtt_us;
+    p_status->samples = m_samples;
+    CRITICAL_REGION_EXIT();
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#define TIME_SYNC_MAX_RTT_US 250000          /**< 往返时间超过该值的样本被丢弃（微秒）。 */
+#define TIME_SYNC_MIN_DRIFT_SPAN_US 10000000 /**< 两个样本至少相隔该时间才用于估计漂移（微秒）。 */
+#define TIME_SYNC_DRIFT_FILTER_SHIFT 2       /**< 漂移估计的指数平滑系数（1/4）。 */
+#define TIME_SYNC_MAX_DRIFT_PPB 500000       /**< 漂移估计的上限（十亿分之一），超过则认为样本异常。 */
+
+/**
+ * @brief 时间同步状态。
+ */
+typedef struct
+{
+    bool     synced;    /**< 是否已经同步。 */
+    int64_t  offset_us; /**< 最近一次样本时刻，主机时间减本地时间（微秒）。 */
+    int32_t  drift_ppb; /**< 本地RTC相对主机时钟的漂移（十亿分之一）。 */
+    uint32_t rtt_us;    /**< 最近一次被接受样本的往返时间（微秒）。 */
+    uint32_t samples;   /**< 被接受的样本数。 */
+} time_sync_status_t;
+
+uint64_t   time_sync_local_ticks(void);
+uint64_t   time_sync_ticks_to_us(uint64_t ticks);
+uint64_t   time_sync_us_to_ticks(uint64_t local_us);
+ret_code_t time_sync_sample_add(uint64_t t1_host_us, uint64_t t2_ticks, uint64_t t3_ticks, uint64_t t4_host_us);
+bool       time_sync_to_host_us(uint64_t ticks, uint64_t *p_host_us);
+bool       time_sync_from_host_us(uint64_t host_us, uint64_t *p_ticks);
+void       time_sync_status_get(time_sync_status_t *p_status);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "timed_action.h"
+
+#include <stdbool.h>
+
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include "nrf_log.h"
+
+#include "channel.h"
+#include "time_sync.h"
+#include "utils.h"
+
+#define MAX_ARM_TICKS (APP_TIMER_MAX_CNT_VAL / 2) /**< 单次定时的最大长度，更远的动作分段等待。 */
+
+typedef struct
+{
+    bool     used;
+    uint16_t tag;
+    uint8_t  channel;
+    uint16_t duration_ms;
+    uint64_t target_ticks;
+} timed_action_t;
+
+APP_TIMER_DEF(m_action_timer_id); /**< 所有定时动作共用一个RTC比较定时器，总是指向最早的动作。 */
+
+static timed_action_t               m_actions[TIMED_ACTION_MAX];
+static timed_action_fired_handler_t m_fired_handler;
+
+/**
+ * @brief 按最早的动作重新设置定时器。
+ *
+ * @details 定时器与time_sync使用同一个RTC1，因此计划时间不需要换算。在主循环和定时器中断中调用，
+ *          查找最早的动作和设置定时器在同一个临界区内，中断不会在两者之间执行动作并设置定时器，
+ *          之后又被主循环用过时的动作覆盖。app_timer_start只把操作放入队列，可以在临界区内调用。
+ */
+static void timer_rearm(void)
+{
+    ret_code_t err_code = NRF_SUCCESS;
+
+    CRITICAL_REGION_ENTER();
+    uint64_t earliest = timed_action_next_ticks();
+
+    (void)app_timer_stop(m_action_timer_id);
+    if (earliest != UINT64_MAX)
+    {
+        uint64_t now = time_sync_local_ticks();
+        uint64_t delay = (earliest > now) ? (earliest - now) : 0;
+
+        delay = MIN(delay, MAX_ARM_TICKS);
+        delay = MAX(delay, APP_TIMER_MIN_TIMEOUT_TICKS);
+        err_code = app_timer_start(m_action_timer_id, (uint32_t)delay, NULL);
+    }
+    CRITICAL_REGION_EXIT();
+
+    LOG_ERROR("Timed action timer", err_code);
+}
+
+/**
+ * @brief 定时器回调，执行所有已到期的动作。
+ */
+static void action_timeout_handler(void *p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    for (uint8_t i = 0; i < TIMED_ACTION_MAX; i++)
+    {
+        if (!m_actions[i].used)
+        {
+            continue;
+        }
+
+        uint64_t now = time_sync_local_ticks();
+        if (m_actions[i].target_ticks > now)
+        {
+            continue;
+        }
+
+        timed_action_t action = m_actions[i];
+        m_actions[i].used = false;
+
+        ret_code_t result = channel_pulse(action.channel, action.duration_ms);
+        m_fired_handler(action.tag, action.channel, action.duration_ms, result, action.target_ticks, now);
+    }
+
+    timer_rearm();
+}
+
+ret_code_t timed_action_init(timed_action_fired_handler_t fired_handler)
+{
+    if (fired_handler == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    m_fired_handler = fired_handler;
+
+    return app_timer_create(&m_action_timer_id, APP_TIMER_MODE_SINGLE_SHOT, action_timeout_handler);
+}
+
+/**
+ * @brief 计划在指定的本地时间输出一个脉冲。
+ *
+ * @details 相同tag的动作会被替换。
+ *
+ * @retval NRF_ERROR_INVALID_PARAM 通道无效或计划时间已过去太久。
+ * @retval NRF_ERROR_NO_MEM        等待中的动作已满。
+ */
+ret_code_t timed_action_add(uint16_t tag, uint8_t channel, uint16_t duration_ms, uint64_t target_ticks)
+{
+    if (channel >= CHANNEL_COUNT || duration_ms == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    uint64_t now = time_sync_local_ticks();
+    if (target_ticks + APP_TIMER_TICKS(TIMED_ACTION_LATE_TOLERANCE_MS) < now)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    ret_code_t err_code = NRF_ERROR_NO_MEM;
+
+    CRITICAL_REGION_ENTER();
+    timed_action_t *p_free = NULL;
+    for (uint8_t i = 0; i < TIMED_ACTION_MAX; i++)
+    {
+        if (m_actions[i].used && m_actions[i].tag == tag)
+        {
+            p_free = &m_actions[i];
+            break;
+        }
+        if (!m_actions[i].used && p_free == NULL)
+        {
+            p_free = &m_actions[i];
+        }
+    }
+
+    if (p_free != NULL)
+    {
+        p_free->used = true;
+        p_free->tag = tag;
+        p_free->channel = channel;
+        p_free->duration_ms = duration_ms;
+        p_free->target_ticks = target_ticks;
+        err_code = NRF_SUCCESS;
+    }
+    CRITICAL_REGION_EXIT();
+
+    if (err_code == NRF_SUCCESS)
+    {
+        timer_rearm();
+    }
+
+    return err_code;
+}
+
+/**
+ * @brief 取消一个等待中的动作。
+ */
+ret_code_t timed_action_cancel(uint16_t tag)
+{
+    ret_code_t err_code = NRF_ERROR_NOT_FOUND;
+
+    CRITICAL_REGION_ENTER();
+    for (uint8_t i = 0; i < TIMED_ACTION_MAX; i++)
+    {
+        if (m_actions[i].used && m_actions[i].tag == tag)
+        {
+            m_actions[i].used = false;
+            err_code = NRF_SUCCESS;
+        }
+    }
+    CRITICAL_REGION_EXIT();
+
+    if (err_code == NRF_SUCCESS)
+    {
+        timer_rearm();
+    }
+
+    return err_code;
+}
+
+/**
+ * @brief 最早的等待中动作的计划时间（本地时间），没有时为UINT64_MAX。
+ *
+ * @details 可以在主循环中调用，动作在定时器中断中执行后释放，64位的计划时间需要在临界区中读取。
+ */
+uint64_t timed_action_next_ticks(void)
+{
+    uint64_t earliest = UINT64_MAX;
+
+    CRITICAL_REGION_ENTER();
+    for (uint8_t i = 0; i < TIMED_ACTION_MAX; i++)
+    {
+        if (m_actions[i].used && m_actions[i].target_ticks < earliest)
+        {
+            earliest = m_actions[i].target_ticks;
+        }
+    }
+    CRITICAL_REGION_EXIT();
+
+    return earliest;
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef TIMED_ACTION_H
+#define TIMED_ACTION_H
+
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#define TIMED_ACTION_MAX 8                /**< 同时等待执行的定时动作数量。 */
+#define TIMED_ACTION_LATE_TOLERANCE_MS 50 /**< 目标时间已过去不超过该值时立即执行，否则拒绝（毫秒）。 */
+
+/**
+ * @brief 定时动作执行后的回调，在RTC中断上下文中调用。
+ *
+ * @param[in] tag          主机指定的标识。
+ * @param[in] channel      通道编号。
+ * @param[in] duration_ms  脉冲时长（毫秒）。
+ * @param[in] result       channel_pulse的返回值。
+ * @param[in] target_ticks 计划执行的本地时间。
+ * @param[in] fired_ticks  实际执行的本地时间。
+ */
+typedef void (*timed_action_fired_handler_t)(uint16_t tag, uint8_t channel, uint16_t duration_ms, ret_code_t result, uint64_t target_ticks, uint64_t fired_ticks);
+
+ret_code_t timed_action_init(timed_action_fired_handler_t fired_handler);
+ret_code_t timed_action_add(uint16_t tag, uint8_t channel, uint16_t duration_ms, uint64_t target_ticks);
+ret_code_t timed_action_cancel(uint16_t tag);
+uint64_t   timed_action_next_ticks(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""Decode the telemetry archive, from a dump of the external flash or from EVT_ARCHIVE_DATA.
+
+A flash dump is walked sector by sector in sequence order. Pages whose CRC does not match (a
+write interrupted by a reset) are reported and skipped, the same way the firmware skips them.
+The records of EVT_ARCHIVE_DATA events can be concatenated into one file and read with
+--records.
+
+    archive_read.py flash.bin
+    archive_read.py --records events.bin
+    archive_read.py --records 0212e8030000000000000102030400
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+from metrics_decode import decode as metrics_decode, load_names
+
+MAGIC = 0x31435241  # "ARC1"
+PAGE_SIZE = 256
+SECTOR_SIZE = 4096
+SECTOR_HEADER = struct.Struct("<II")
+PAGE_DATA_END = PAGE_SIZE - 2
+TYPE_FREE = 0xFF
+
+TIME = struct.Struct("<II")
+SOURCES = ("command", "timed", "schedule", "button", "group", "relay")
+OPCODES = {0x01: "pulse", 0x02: "press", 0x03: "release", 0x04: "pulse_at"}
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE, the same as crc16_compute() in the SDK."""
+    crc = 0xFFFF
+    for b in data:
+        crc = ((crc >> 8) | (crc << 8)) & 0xFFFF
+        crc ^= b
+        crc ^= (crc & 0xFF) >> 4
+        crc ^= (crc << 12) & 0xFFFF
+        crc ^= (crc & 0xFF) << 5
+    return crc
+
+
+def split_records(data, start=0, end=None):
+    """Yield (offset, type, payload) until the free marker or the end of data."""
+    end = len(data) if end is None else end
+    offset = start
+    while offset + 2 <= end and data[offset] != TYPE_FREE:
+        length = data[offset + 1]
+        if offset + 2 + length > end:
+            break
+        yield offset, data[offset], data[offset + 2:offset + 2 + length]
+        offset += 2 + length
+
+
+def flash_records(image):
+    """Yield (cursor, type, payload) from a flash dump, oldest first."""
+    sectors = []
+    for index in range(len(image) // SECTOR_SIZE):
+        magic, seq = SECTOR_HEADER.unpack_from(image, index * SECTOR_SIZE)
+        if magic == MAGIC and seq % (len(image) // SECTOR_SIZE) == index:
+            sectors.append((seq, index * SECTOR_SIZE))
+
+    for seq, base in sorted(sectors):
+        for page in range(0, SECTOR_SIZE, PAGE_SIZE):
+            data = image[base + page:base + page + PAGE_SIZE]
+            if data == b"\xff" * PAGE_SIZE:
+                break
+            if crc16(data[:PAGE_DATA_END]) != struct.unpack_from("<H", data, PAGE_DATA_END)[0]:
+                print("# sector %d page %d: bad CRC, skipped" % (seq, page // PAGE_SIZE), file=sys.stderr)
+                continue
+            start = SECTOR_HEADER.size if page == 0 else 0
+            for offset, kind, payload in split_records(data, start, PAGE_DATA_END):
+                yield seq * SECTOR_SIZE + page + offset, kind, payload
+
+
+def describe(kind, payload, names):
+    if len(payload) < TIME.size:
+        return "type 0x%02x: %s" % (kind, payload.hex())
+    uptime_s, host_s = TIME.unpack_from(payload)
+    body = payload[TIME.size:]
+    stamp = "%8d s" % uptime_s + ("  host %d" % host_s if host_s else "")
+
+    if kind == 0x01 and len(body) >= 8:
+        reset, version = struct.unpack_from("<II", body)
+        text = "boot version %d reset 0x%08x" % (version, reset)
+    elif kind == 0x02 and len(body) >= 4:
+        source = SOURCES[body[0]] if body[0] < len(SOURCES) else str(body[0])
+        result = "ok" if body[3] == 0 else "error %d" % body[3]
+        text = "%s %s channel %d: %s" % (source, OPCODES.get(body[1], "0x%02x" % body[1]), body[2], result)
+    elif kind == 0x03 and len(body) >= 5:
+        text = "host %s at %d mW" % ("on" if body[0] else "off", struct.unpack_from("<I", body, 1)[0])
+    elif kind == 0x04:
+        try:
+            _, values = metrics_decode(body, names)
+            text = "metrics " + " ".join("%s=%d" % v for v in values)
+        except ValueError as e:
+            text = "metrics: %s" % e
+    else:
+        text = "type 0x%02x: %s" % (kind, body.hex())
+    return "%s  %s" % (stamp, text)
+
+
+def main():
+    default_header = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "metrics.h")
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--header", default=default_header, help="metrics.h to take metric names from")
+    parser.add_argument("--records", action="store_true", help="input is a record stream, not a flash dump")
+    parser.add_argument("input", help="binary file, or hex string with --records")
+    args = parser.parse_args()
+
+    if os.path.isfile(args.input):
+        with open(args.input, "rb") as f:
+            data = f.read()
+    else:
+        data = bytes.fromhex(args.input.replace(":", "").replace(" ", ""))
+
+    names = load_names(args.header)
+    records = split_records(data) if args.records else flash_records(data)
+    for cursor, kind, payload in records:
+        print("%10d  %s" % (cursor, describe(kind, payload, names)))
+
+
+if __name__ == "__main__":
+    main()
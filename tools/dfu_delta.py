@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""Create and apply delta DFU patches for ble_computer_switch.
+
+The patch format matches dfu_delta.h:
+
+    header (24 bytes, little endian)
+        magic "DDLT", version u16, reserved u16,
+        old_size u32, old_crc32 u32, new_size u32, new_crc32 u32
+    ops
+        0x01 COPY   src_offset u32, length u32   copy from the old image
+        0x02 INSERT length u16, data             literal bytes
+
+Usage:
+    dfu_delta.py diff  old.bin new.bin patch.bin
+    dfu_delta.py apply old.bin patch.bin out.bin
+    dfu_delta.py info  patch.bin
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+MAGIC = 0x544C4444
+VERSION = 1
+HEADER = struct.Struct("<IHHIIII")
+
+OP_COPY = 0x01
+OP_INSERT = 0x02
+
+KEY_LEN = 8          # bytes hashed to find copy candidates
+MIN_COPY = 16        # shorter matches are cheaper as literals
+MAX_CANDIDATES = 32  # candidates checked per position
+MAX_INSERT = 0xFFFF
+
+
+def crc32(data):
+    return zlib.crc32(data) & 0xFFFFFFFF
+
+
+def build_index(old):
+    index = {}
+    for i in range(len(old) - KEY_LEN + 1):
+        bucket = index.setdefault(old[i:i + KEY_LEN], [])
+        if len(bucket) < MAX_CANDIDATES:
+            bucket.append(i)
+    return index
+
+
+def match_len(old, src, new, pos):
+    n = 0
+    limit = min(len(old) - src, len(new) - pos)
+    while n < limit and old[src + n] == new[pos + n]:
+        n += 1
+    return n
+
+
+def diff(old, new):
+    index = build_index(old)
+    ops = []
+    literal = bytearray()
+    pos = 0
+    next_src = None  # continuing the previous copy is free to check
+
+    def flush_literal():
+        for i in range(0, len(literal), MAX_INSERT):
+            chunk = bytes(literal[i:i + MAX_INSERT])
+            ops.append(struct.pack("<BH", OP_INSERT, len(chunk)) + chunk)
+        literal.clear()
+
+    while pos < len(new):
+        best_src, best_len = 0, 0
+        candidates = list(index.get(new[pos:pos + KEY_LEN], ()))
+        if next_src is not None and next_src < len(old):
+            candidates.insert(0, next_src)
+        for src in candidates:
+            n = match_len(old, src, new, pos)
+            if n > best_len:
+                best_src, best_len = src, n
+
+        if best_len >= MIN_COPY:
+            flush_literal()
+            ops.append(struct.pack("<BII", OP_COPY, best_src, best_len))
+            pos += best_len
+            next_src = best_src + best_len
+        else:
+            literal.append(new[pos])
+            pos += 1
+            if next_src is not None:
+                next_src += 1
+
+    flush_literal()
+
+    header = HEADER.pack(MAGIC, VERSION, 0, len(old), crc32(old), len(new), crc32(new))
+    return header + b"".join(ops)
+
+
+def parse_header(patch):
+    if len(patch) < HEADER.size:
+        raise ValueError("patch too short")
+    magic, version, _, old_size, old_crc, new_size, new_crc = HEADER.unpack_from(patch)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("not a delta patch")
+    return old_size, old_crc, new_size, new_crc
+
+
+def apply(old, patch):
+    old_size, old_crc, new_size, new_crc = parse_header(patch)
+    if len(old) != old_size or crc32(old) != old_crc:
+        raise ValueError("patch was made for a different old image")
+
+    out = bytearray()
+    pos = HEADER.size
+    while pos < len(patch):
+        op = patch[pos]
+        if op == OP_COPY:
+            src, length = struct.unpack_from("<II", patch, pos + 1)
+            if src + length > len(old):
+                raise ValueError("copy outside the old image at %d" % pos)
+            out += old[src:src + length]
+            pos += 9
+        elif op == OP_INSERT:
+            (length,) = struct.unpack_from("<H", patch, pos + 1)
+            out += patch[pos + 3:pos + 3 + length]
+            pos += 3 + length
+        else:
+            raise ValueError("unknown op 0x%02x at %d" % (op, pos))
+        if len(out) > new_size:
+            raise ValueError("output exceeds new image size")
+
+    if len(out) != new_size or crc32(out) != new_crc:
+        raise ValueError("new image CRC mismatch")
+    return bytes(out)
+
+
+def read(path):
+    with open(path, "rb") as f:
+        return f.read()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    p = sub.add_parser("diff")
+    p.add_argument("old")
+    p.add_argument("new")
+    p.add_argument("patch")
+    p = sub.add_parser("apply")
+    p.add_argument("old")
+    p.add_argument("patch")
+    p.add_argument("out")
+    p = sub.add_parser("info")
+    p.add_argument("patch")
+    args = parser.parse_args()
+
+    if args.cmd == "diff":
+        old, new = read(args.old), read(args.new)
+        patch = diff(old, new)
+        if apply(old, patch) != new:
+            sys.exit("internal error: patch does not reproduce the new image")
+        with open(args.patch, "wb") as f:
+            f.write(patch)
+        print("%d -> %d bytes, patch %d bytes (%.1f%%)" % (len(old), len(new), len(patch), 100.0 * len(patch) / len(new)))
+    elif args.cmd == "apply":
+        out = apply(read(args.old), read(args.patch))
+        with open(args.out, "wb") as f:
+            f.write(out)
+        print("wrote %d bytes" % len(out))
+    else:
+        old_size, old_crc, new_size, new_crc = parse_header(read(args.patch))
+        print("old %d bytes crc 0x%08x, new %d bytes crc 0x%08x" % (old_size, old_crc, new_size, new_crc))
+
+
+if __name__ == "__main__":
+    main()
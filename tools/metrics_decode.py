@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""Decode a metrics snapshot read from the Switch Service metrics characteristic.
+
+Metric names are taken from the metric_id_t enum in metrics.h, so the tool stays in step with
+the firmware it was checked out with.
+
+Usage:
+    metrics_decode.py 0112000034120000...
+    metrics_decode.py --header path/to/metrics.h snapshot.bin
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+VERSION = 1
+HEADER = struct.Struct("<BBHI")
+GAUGES = ("METRIC_RSSI", "METRIC_CONN_TX_POWER")  # signed values
+
+
+def load_names(path):
+    with open(path) as f:
+        text = f.read()
+    body = re.search(r"typedef enum\s*\{(.*?)\}\s*metric_id_t;", text, re.S)
+    if body is None:
+        raise ValueError("metric_id_t not found in %s" % path)
+    names = re.findall(r"^\s*(METRIC_\w+)", body.group(1), re.M)
+    return [n for n in names if n != "METRIC_COUNT"]
+
+
+def decode(data, names):
+    if len(data) < HEADER.size:
+        raise ValueError("snapshot too short")
+    version, count, _, uptime_s = HEADER.unpack_from(data)
+    if version != VERSION:
+        raise ValueError("unsupported snapshot version %d" % version)
+    if len(data) < HEADER.size + 4 * count:
+        raise ValueError("snapshot truncated: %d values announced" % count)
+
+    values = struct.unpack_from("<%dI" % count, data, HEADER.size)
+    result = []
+    for i, value in enumerate(values):
+        name = names[i] if i < len(names) else "METRIC_%d" % i
+        if name in GAUGES and value & 0x80000000:
+            value -= 1 << 32
+        result.append((name[len("METRIC_"):].lower(), value))
+    return uptime_s, result
+
+
+def main():
+    default_header = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "metrics.h")
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--header", default=default_header, help="metrics.h to take names from")
+    parser.add_argument("snapshot", help="hex string or binary file")
+    args = parser.parse_args()
+
+    if os.path.isfile(args.snapshot):
+        with open(args.snapshot, "rb") as f:
+            data = f.read()
+    else:
+        data = bytes.fromhex(args.snapshot.replace(":", "").replace(" ", ""))
+
+    try:
+        uptime_s, values = decode(data, load_names(args.header))
+    except ValueError as e:
+        sys.exit(str(e))
+
+    print("uptime %d s" % uptime_s)
+    for name, value in values:
+        print("%-20s %d" % (name, value))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,254 @@
+#!/usr/bin/env python3
+"""Flash and RAM attribution for ble_computer_switch from the linker map.
+
+Every input section kept by the linker in an allocated output section is charged to its object
+file (and archive, for libraries) as .text, .rodata, .data or .bss. .data counts against both
+flash and RAM. Debug information, .comment and .ARM.attributes are not loaded and are skipped, and
+alignment padding is listed as *fill*, so the totals agree with arm-none-eabi-size -A.
+
+    size_report.py _build/ble_computer_switch.map
+    size_report.py _build/ble_computer_switch.map --by archive
+    size_report.py _build/ble_computer_switch.map --by symbol --elf _build/ble_computer_switch.out
+    size_report.py MAP --save-baseline tools/size_baseline.json
+    size_report.py MAP --baseline tools/size_baseline.json --budget tools/size_budget.json
+
+With --baseline the table shows the change of each row and of the totals. With --budget the
+script exits with 1 when the flash or RAM total, or a per-object limit, is exceeded.
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+
+RAM_START = 0x20000000
+KINDS = ("text", "rodata", "data", "bss")
+RAM_BSS_OUTPUTS = (".bss", ".heap", ".stack_dummy", ".noinit")
+# Output sections without SHF_ALLOC; they also sit at address 0, which no loaded section uses.
+NON_ALLOC_PREFIXES = (".debug", ".comment", ".ARM.attributes", ".gnu.attributes", ".stab", ".note.GNU-stack")
+
+INPUT_RE = re.compile(r"^ (\S+)?\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s*(.*)$")
+NAME_ONLY_RE = re.compile(r"^ (\S+)$")
+OUTPUT_RE = re.compile(r"^(\.\S+)(?:\s+0x([0-9a-f]+)\s+0x[0-9a-f]+)?")
+ADDRESS_RE = re.compile(r"^\s+0x([0-9a-f]+)\s+0x[0-9a-f]+")
+FILL = ("", "*fill*")
+ARCHIVE_RE = re.compile(r"^(.*?)([^/\\]+\.a)\((.+)\)$")
+
+NM_KINDS = {"t": "text", "w": "text", "r": "rodata", "d": "data", "b": "bss"}
+
+
+def classify(output, section, address):
+    if address >= RAM_START:
+        if output in RAM_BSS_OUTPUTS or section.startswith(".bss") or section == "COMMON":
+            return "bss"
+        return "data"
+    return "text" if section.startswith(".text") else "rodata"
+
+
+def allocated(output, address):
+    """Whether an output section is loaded; address is None when the map put it on the next line."""
+    return not output.startswith(NON_ALLOC_PREFIXES) and address != 0
+
+
+def split_origin(origin):
+    """Return (archive, object) for an input file name from the map."""
+    m = ARCHIVE_RE.match(origin)
+    if m:
+        return m.group(2), m.group(3)
+    return "", os.path.basename(origin)
+
+
+def parse_map(path):
+    """Map (archive, object) to byte counts per kind."""
+    sizes = {}
+    started = False
+    output = None
+    alloc = False
+    output_address_next = False
+    pending = None
+    with open(path) as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if not started:
+                started = line.startswith("Linker script and memory map")
+                continue
+            m = OUTPUT_RE.match(line)
+            if m:
+                output = m.group(1)
+                address = None if m.group(2) is None else int(m.group(2), 16)
+                alloc = allocated(output, address)
+                output_address_next = address is None
+                pending = None
+                continue
+            if output_address_next:
+                # Long output section names are followed by their address on the next line.
+                output_address_next = False
+                m = ADDRESS_RE.match(line)
+                if m:
+                    alloc = allocated(output, int(m.group(1), 16))
+                    continue
+            if not alloc:
+                continue
+            m = NAME_ONLY_RE.match(line)
+            if m and not line.strip().startswith("0x"):
+                pending = m.group(1)
+                continue
+            m = INPUT_RE.match(line)
+            if m is None:
+                continue
+            section = m.group(1) or pending
+            pending = None
+            address, size, origin = int(m.group(2), 16), int(m.group(3), 16), m.group(4).strip()
+            if section is None or size == 0 or (not origin and section != "*fill*"):
+                continue
+            key = FILL if section == "*fill*" else split_origin(origin)
+            row = sizes.setdefault(key, dict.fromkeys(KINDS, 0))
+            row[classify(output, section, address)] += size
+    if not started:
+        raise ValueError("%s does not look like a GNU ld map file" % path)
+    return sizes
+
+
+def parse_symbols(elf, nm):
+    """Map symbol name to byte counts per kind, using nm on the linked image."""
+    out = subprocess.run([nm, "-S", "-t", "d", elf], check=True, stdout=subprocess.PIPE, universal_newlines=True).stdout
+    sizes = {}
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) != 4:
+            continue
+        kind = NM_KINDS.get(parts[2].lower())
+        if kind is None:
+            continue
+        row = sizes.setdefault(("", parts[3]), dict.fromkeys(KINDS, 0))
+        row[kind] += int(parts[1])
+    return sizes
+
+
+def by_object(sizes):
+    """Key rows by "archive:object", or by the object name for files outside archives."""
+    return {(a + ":" if a else "") + o: row for (a, o), row in sizes.items()}
+
+
+def by_archive(objects):
+    grouped = {}
+    for name, row in objects.items():
+        archive = name.split(":", 1)[0] if ":" in name else "(objects)"
+        total = grouped.setdefault(archive, dict.fromkeys(KINDS, 0))
+        for k in KINDS:
+            total[k] += row[k]
+    return grouped
+
+
+def flash(row):
+    return row["text"] + row["rodata"] + row["data"]
+
+
+def ram(row):
+    return row["data"] + row["bss"]
+
+
+def totals(rows):
+    total = dict.fromkeys(KINDS, 0)
+    for row in rows.values():
+        for k in KINDS:
+            total[k] += row[k]
+    return total
+
+
+def print_table(rows, baseline, top):
+    def delta(name, value, field):
+        if baseline is None:
+            return ""
+        old = baseline.get(name)
+        old_value = 0 if old is None else (flash(old) if field == "flash" else ram(old))
+        return " %+7d" % (value - old_value) if value != old_value else " %7s" % ""
+
+    width = max([len(n) for n in rows] + [8])
+    if baseline is None:
+        print("%-*s %7s %7s %7s %7s %8s %7s" % (width, "name", "text", "rodata", "data", "bss", "flash", "ram"))
+    else:
+        print("%-*s %7s %7s %7s %7s %8s %7s %7s %7s" % (width, "name", "text", "rodata", "data", "bss", "flash", "change", "ram", "change"))
+    ordered = sorted(rows.items(), key=lambda item: -(flash(item[1]) + item[1]["bss"]))
+    for name, row in ordered[:top] if top else ordered:
+        print("%-*s %7d %7d %7d %7d %8d%s %7d%s" % (width, name, row["text"], row["rodata"], row["data"], row["bss"],
+                                                   flash(row), delta(name, flash(row), "flash"), ram(row), delta(name, ram(row), "ram")))
+    if baseline is not None:
+        for name in sorted(set(baseline) - set(rows)):
+            print("%-*s removed (flash %d, ram %d)" % (width, name, flash(baseline[name]), ram(baseline[name])))
+
+
+def check_budget(budget, rows, total):
+    failures = []
+    if "flash" in budget and flash(total) > budget["flash"]:
+        failures.append("flash %d > budget %d" % (flash(total), budget["flash"]))
+    if "ram" in budget and ram(total) > budget["ram"]:
+        failures.append("ram %d > budget %d" % (ram(total), budget["ram"]))
+    for name, limit in budget.get("objects", {}).items():
+        row = rows.get(name)
+        if row is not None and flash(row) > limit:
+            failures.append("%s flash %d > budget %d" % (name, flash(row), limit))
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("map")
+    parser.add_argument("--by", choices=("archive", "object", "symbol"), default="object")
+    parser.add_argument("--elf", help="linked image, needed for --by symbol")
+    parser.add_argument("--nm", default="arm-none-eabi-nm")
+    parser.add_argument("--top", type=int, default=0, help="print only the largest N rows")
+    parser.add_argument("--baseline", help="JSON written by --save-baseline; missing file is not an error")
+    parser.add_argument("--save-baseline", metavar="FILE", help="store the per-object table as the new baseline")
+    parser.add_argument("--budget", help="JSON with flash/ram totals and optional per-object flash limits")
+    args = parser.parse_args()
+
+    objects = by_object(parse_map(args.map))
+
+    baseline = None
+    if args.baseline and os.path.exists(args.baseline):
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+    elif args.baseline:
+        print("no baseline at %s, run make size_baseline to create one\n" % args.baseline)
+
+    if args.by == "symbol":
+        if not args.elf:
+            sys.exit("--by symbol needs --elf")
+        rows, row_baseline = by_object(parse_symbols(args.elf, args.nm)), None
+    elif args.by == "archive":
+        rows, row_baseline = by_archive(objects), None if baseline is None else by_archive(baseline)
+    else:
+        rows, row_baseline = objects, baseline
+
+    print_table(rows, row_baseline, args.top)
+
+    total = totals(objects)
+    line = "\ntotal: flash %d (text %d, rodata %d, data %d), ram %d (data %d, bss %d)" % (
+        flash(total), total["text"], total["rodata"], total["data"], ram(total), total["data"], total["bss"])
+    if baseline is not None:
+        old = totals(baseline)
+        line += ", change flash %+d, ram %+d" % (flash(total) - flash(old), ram(total) - ram(old))
+    print(line)
+
+    if args.save_baseline:
+        with open(args.save_baseline, "w") as f:
+            json.dump(objects, f, indent=1, sort_keys=True)
+            f.write("\n")
+        print("baseline saved to %s" % args.save_baseline)
+
+    if args.budget:
+        with open(args.budget) as f:
+            budget = json.load(f)
+        failures = check_budget(budget, objects, total)
+        for failure in failures:
+            print("over budget: %s" % failure)
+        if failures:
+            sys.exit(1)
+        print("within budget (flash %d of %d, ram %d of %d)" % (flash(total), budget.get("flash", 0), ram(total), budget.get("ram", 0)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+"""Worst-case stack depth per call chain for ble_computer_switch.
+
+Combines the per-function frame sizes that gcc writes with -fstack-usage (*.su next to each
+object file) with the call graph taken from the disassembly of the linked image:
+
+    stack_report.py _build/ble_computer_switch.out _build/ble_computer_switch
+
+Roots are main and every interrupt handler. Indirect calls are followed through two sources of
+edges: registrations found in the project's C files with --sources (event queue handlers, app_timer
+handlers, SoftDevice observers, FDS and scan handlers, each attached to the function that
+dispatches them), and caller:callee lines from --edges files or --edge. Functions without a .su
+entry (newlib, libgcc, assembly) count as zero and are listed.
+
+All interrupts share the main stack, so the nested worst case is main plus every interrupt root,
+plus the SoftDevice's own reservation. While a reached function still makes indirect calls that no
+edge covers, or a frame size is missing, the total is reported as a lower bound.
+"""
+
+import argparse
+import glob
+import os
+import re
+import subprocess
+import sys
+
+SOFTDEVICE_STACK = 1536  # S132 v7 worst case, from the SoftDevice specification
+
+FUNC_RE = re.compile(r"^([0-9a-f]+) <([^>]+)>:$")
+CALL_RE = re.compile(r"\s(bl|b|b\.w|b\.n)\s+[0-9a-f]+ <([^>+]+)>$")
+INDIRECT_RE = re.compile(r"\s(blx|bx)\s+(r\d+|ip|lr)$")
+
+# Registration call in the sources: (name, handler argument index, function that calls the handler).
+REGISTRATIONS = [
+    ("event_queue_put", -1, "event_queue_execute"),
+    ("EVENT_QUEUE_WORK_DEF", -1, "event_queue_execute"),
+    ("app_timer_create", -1, "timeout_handler_exec"),
+    ("NRF_SDH_BLE_OBSERVER", 2, "nrf_sdh_ble_evts_poll"),
+    ("NRF_SDH_SOC_OBSERVER", 2, "nrf_sdh_soc_evts_poll"),
+    ("fds_register", 0, "event_send"),
+    ("scan_handler_set", 1, "adv_report_handle"),
+]
+COMMENT_RE = re.compile(r"/\*.*?\*/|//[^\n]*", re.S)
+IDENT_RE = re.compile(r"^[A-Za-z_]\w*$")
+
+
+def load_frames(obj_dir):
+    """Map function name to the largest frame found in the .su files."""
+    frames, dynamic = {}, set()
+    for path in glob.glob(os.path.join(obj_dir, "**", "*.su"), recursive=True):
+        with open(path) as f:
+            for line in f:
+                parts = line.rstrip("\n").split("\t")
+                if len(parts) != 3:
+                    continue
+                name = parts[0].rsplit(":", 1)[-1]
+                size = int(parts[1])
+                frames[name] = max(frames.get(name, 0), size)
+                if parts[2].startswith("dynamic"):
+                    dynamic.add(name)
+    return frames, dynamic
+
+
+def load_calls(elf, objdump):
+    """Map function name to the set of direct callees and whether it makes indirect calls."""
+    out = subprocess.run([objdump, "-d", "--no-show-raw-insn", elf], check=True, stdout=subprocess.PIPE, universal_newlines=True).stdout
+    calls, indirect = {}, set()
+    current = None
+    for line in out.splitlines():
+        m = FUNC_RE.match(line)
+        if m:
+            current = m.group(2)
+            calls.setdefault(current, set())
+            continue
+        if current is None:
+            continue
+        m = CALL_RE.search(line)
+        if m:
+            if m.group(2) != current:
+                calls[current].add(m.group(2))
+            continue
+        m = INDIRECT_RE.search(line)
+        if m and not (m.group(1) == "bx" and m.group(2) == "lr"):
+            indirect.add(current)
+    return calls, indirect
+
+
+def load_edges(paths, extra):
+    """Return caller:callee pairs from edge files (# starts a comment) and --edge arguments."""
+    edges = []
+    for path in paths:
+        with open(path) as f:
+            for line in f:
+                line = line.split("#", 1)[0].strip()
+                if line:
+                    edges.append(line)
+    edges.extend(extra)
+    return [tuple(edge.split(":", 1)) for edge in edges]
+
+
+def call_args(text, start):
+    """Split the arguments of the call whose "(" is at text[start] on top-level commas."""
+    args, depth, begin = [], 0, start + 1
+    for i in range(start, len(text)):
+        c = text[i]
+        if c == "(":
+            depth += 1
+        elif c == ")":
+            depth -= 1
+            if depth == 0:
+                args.append(text[begin:i].strip())
+                return args
+        elif c == "," and depth == 1:
+            args.append(text[begin:i].strip())
+            begin = i + 1
+    return args
+
+
+def scan_sources(src_dir):
+    """Return (dispatcher, handler) pairs for the registrations found in src_dir/*.c and *.h.
+
+    Only handlers passed by name are found; a handler passed through a variable (a wrapper's own
+    parameter) needs an edge from the wrapper's callers.
+    """
+    edges = set()
+    for path in glob.glob(os.path.join(src_dir, "*.[ch]")):
+        with open(path, encoding="utf-8", errors="replace") as f:
+            text = COMMENT_RE.sub("", f.read())
+        for name, index, dispatcher in REGISTRATIONS:
+            for m in re.finditer(r"\b%s\s*\(" % name, text):
+                args = call_args(text, m.end() - 1)
+                if len(args) > max(index, -index - 1) and IDENT_RE.match(args[index]):
+                    edges.add((dispatcher, args[index]))
+    return sorted(edges)
+
+
+def worst_chain(root, calls, frames, memo, stack=()):
+    """Return (bytes, chain) of the deepest path from root; recursion is cut and reported."""
+    if root in memo:
+        return memo[root]
+    if root in stack:
+        return 0, [root + " (recursion)"]
+    best = (0, [])
+    for callee in calls.get(root, ()):
+        depth, chain = worst_chain(callee, calls, frames, memo, stack + (root,))
+        if depth > best[0] or not best[1]:
+            best = (depth, chain)
+    result = (frames.get(root, 0) + best[0], [root] + best[1])
+    memo[root] = result
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf")
+    parser.add_argument("obj_dir", help="directory searched recursively for .su files")
+    parser.add_argument("--objdump", default="arm-none-eabi-objdump")
+    parser.add_argument("--edge", action="append", default=[], metavar="CALLER:CALLEE", help="add an indirect call edge")
+    parser.add_argument("--edges", action="append", default=[], metavar="FILE", help="file of caller:callee lines")
+    parser.add_argument("--sources", metavar="DIR", help="find handler registrations in DIR/*.c and *.h")
+    parser.add_argument("--stack-size", type=int, help="__STACK_SIZE; exit with 1 when the nested worst case exceeds it")
+    parser.add_argument("--verbose", action="store_true", help="print the full chain of every root")
+    args = parser.parse_args()
+
+    frames, dynamic = load_frames(args.obj_dir)
+    if not frames:
+        sys.exit("no .su files under %s, build with -fstack-usage" % args.obj_dir)
+    calls, indirect = load_calls(args.elf, args.objdump)
+    edges = load_edges(args.edges, args.edge)
+    if args.sources:
+        edges.extend(scan_sources(args.sources))
+    missing_callers = sorted(set(caller for caller, callee in edges if caller not in calls and callee in calls))
+    resolved = set()
+    for caller, callee in edges:
+        # Handlers of modules or SDK libraries that are not linked in have no symbol.
+        if callee in calls:
+            calls.setdefault(caller, set()).add(callee)
+            resolved.add(caller)
+
+    roots = ["main"] + sorted(n for n in calls if n.endswith("_IRQHandler") or n in ("HardFault_Handler", "SysTick_Handler"))
+    memo = {}
+    results = [(root,) + worst_chain(root, calls, frames, memo) for root in roots if root in calls]
+
+    print("%-40s %6s  %s" % ("root", "bytes", "deepest frame"))
+    for root, depth, chain in sorted(results, key=lambda r: -r[1]):
+        print("%-40s %6d  %s" % (root, depth, chain[-1]))
+        if args.verbose:
+            for name in chain:
+                flags = "".join(f for f, s in (("D", dynamic), ("I", indirect)) if name in s)
+                print("    %6d %-2s %s" % (frames.get(name, 0), flags, name))
+
+    reached = set()
+    for _, _, chain in results:
+        reached.update(chain)
+    unknown = sorted(n for n in reached if n not in frames and not n.endswith("(recursion)"))
+    unresolved = sorted((reached & indirect) - resolved)
+    if unknown:
+        print("\nno frame size (counted as 0): %s" % ", ".join(unknown))
+    if unresolved:
+        print("\nindirect calls not followed (add edges): %s" % ", ".join(unresolved))
+    if missing_callers:
+        print("\nedge callers not in the image (renamed or inlined): %s" % ", ".join(missing_callers))
+
+    nested = sum(depth for _, depth, _ in results) + SOFTDEVICE_STACK
+    bound = "lower bound" if unknown or unresolved or missing_callers else "upper bound"
+    print("\nnested %s: %d bytes (all roots + %d SoftDevice)" % (bound, nested, SOFTDEVICE_STACK))
+    if args.stack_size is not None:
+        print("stack size %d bytes, margin %d" % (args.stack_size, args.stack_size - nested))
+        if nested > args.stack_size:
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
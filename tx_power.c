@@ -0,0 +1,197 @@
+#include "tx_power.h"
+
+#include <stdbool.h>
+
+#include "app_timer.h"
+#include "app_util.h"
+#include "ble.h"
+#include "ble_hci.h"
+#include "nrf_log.h"
+#include "nrf_sdh_ble.h"
+
+#include "ble_base.h"
+#include "metrics.h"
+#include "phy_policy.h"
+#include "time_sync.h"
+#include "utils.h"
+
+/**
+ * @brief nRF52832支持的发射功率（dBm），从低到高。
+ */
+static int8_t const m_levels[] = {-40, -20, -16, -12, -8, -4, 0, 3, 4};
+
+APP_TIMER_DEF(m_adjust_timer_id); /**< 连接期间RSSI稳定、没有RSSI事件时也定期重新评估。 */
+
+static uint16_t         m_conn_handle = BLE_CONN_HANDLE_INVALID;
+static uint8_t          m_adv_handle = BLE_GAP_ADV_SET_HANDLE_NOT_SET;
+static uint8_t          m_conn_level;
+static uint8_t          m_start_level;
+static uint64_t         m_last_step_ticks;
+static bool             m_rssi_seen; /**< 本次连接已经收到过RSSI，平均RSSI有效。 */
+static tx_power_stats_t m_stats = {.adv_dbm = TX_POWER_ADV_DEFAULT_DBM};
+
+/**
+ * @brief 查找发射功率对应的级别，不支持时返回ARRAY_SIZE(m_levels)。
+ */
+static uint8_t level_find(int8_t dbm)
+{
+    for (uint8_t i = 0; i < ARRAY_SIZE(m_levels); i++)
+    {
+        if (m_levels[i] == dbm)
+        {
+            return i;
+        }
+    }
+
+    return ARRAY_SIZE(m_levels);
+}
+
+static void conn_level_set(uint8_t level)
+{
+    ret_code_t err_code = sd_ble_gap_tx_power_set(BLE_GAP_TX_POWER_ROLE_CONN, m_conn_handle, m_levels[level]);
+    if (err_code == NRF_SUCCESS)
+    {
+        m_conn_level = level;
+        m_stats.conn_dbm = m_levels[level];
+        metrics_gauge_set(METRIC_CONN_TX_POWER, m_levels[level]);
+        m_last_step_ticks = time_sync_local_ticks();
+    }
+    LOG_ERROR("Conn TX power", err_code);
+}
+
+/**
+ * @brief 根据路径损耗调整连接发射功率。
+ *
+ * @details 本地RSSI只反映主机的发射功率，不随本机的发射功率变化。这里按假定的主机发射功率
+ *          算出路径损耗（主机发射功率 - RSSI），假设链路对称，估计主机收到本机的信号
+ *          （本机发射功率 - 路径损耗），使其保持在TX_POWER_PEER_RSSI_MIN之上并留有余量。
+ */
+static void conn_level_adjust(void)
+{
+    phy_policy_stats_t link;
+    int16_t            path_loss;
+    int16_t            peer_rssi;
+
+    if (time_sync_local_ticks() - m_last_step_ticks < APP_TIMER_TICKS(TX_POWER_DWELL_MS))
+    {
+        return;
+    }
+
+    phy_policy_stats_get(&link);
+    path_loss = TX_POWER_PEER_DBM - link.rssi;
+    peer_rssi = m_levels[m_conn_level] - path_loss;
+
+    if (peer_rssi < TX_POWER_PEER_RSSI_MIN && m_conn_level < ARRAY_SIZE(m_levels) - 1)
+    {
+        conn_level_set(m_conn_level + 1);
+        m_stats.steps_up++;
+    }
+    else if (m_conn_level > 0 && m_levels[m_conn_level - 1] - path_loss >= TX_POWER_PEER_RSSI_MIN + TX_POWER_MARGIN_DB)
+    {
+        conn_level_set(m_conn_level - 1);
+        m_stats.steps_down++;
+    }
+}
+
+/**
+ * @brief 定期重新评估，与SoftDevice事件中断的优先级相同，不会打断BLE事件中的调整。
+ */
+static void adjust_timeout_handler(void *p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    if (m_conn_handle != BLE_CONN_HANDLE_INVALID && m_rssi_seen)
+    {
+        conn_level_adjust();
+    }
+}
+
+static void tx_power_on_ble_evt(ble_evt_t const *p_ble_evt, void *p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    switch (p_ble_evt->header.evt_id)
+    {
+    case BLE_GAP_EVT_CONNECTED:
+        m_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+        m_rssi_seen = false;
+        conn_level_set(m_start_level);
+        // 起始功率不是一次调整，第一个RSSI样本到达时立即评估。
+        m_last_step_ticks = 0;
+        LOG_ERROR("TX power timer", app_timer_start(m_adjust_timer_id, APP_TIMER_TICKS(TX_POWER_DWELL_MS), NULL));
+        break;
+
+    case BLE_GAP_EVT_DISCONNECTED:
+        if (p_ble_evt->evt.gap_evt.params.disconnected.reason == BLE_HCI_CONNECTION_TIMEOUT)
+        {
+            // 链路丢失后，下一次连接从最大功率开始。
+            m_start_level = ARRAY_SIZE(m_levels) - 1;
+            m_stats.link_losses++;
+        }
+        else
+        {
+            m_start_level = level_find(TX_POWER_CONN_START_DBM);
+        }
+        m_conn_handle = BLE_CONN_HANDLE_INVALID;
+        m_stats.conn_dbm = 0;
+        (void)app_timer_stop(m_adjust_timer_id);
+        break;
+
+    case BLE_GAP_EVT_RSSI_CHANGED:
+        // RSSI测量由PHY策略模块开启，平均值也在那里计算。RSSI只在变化超过阈值时产生事件，稳定时由定时器评估。
+        m_rssi_seen = true;
+        conn_level_adjust();
+        break;
+
+    default:
+        break;
+    }
+}
+
+NRF_SDH_BLE_OBSERVER(m_tx_power_observer, TX_POWER_BLE_OBSERVER_PRIO, tx_power_on_ble_evt, NULL);
+
+STATIC_ASSERT(TX_POWER_MARGIN_DB > 0);
+
+/**
+ * @brief 在广播初始化之后设置广播发射功率，需要在app_timer_init之后调用。
+ */
+ret_code_t tx_power_adv_init(uint8_t adv_handle)
+{
+    ret_code_t err_code = app_timer_create(&m_adjust_timer_id, APP_TIMER_MODE_REPEATED, adjust_timeout_handler);
+    VERIFY_SUCCESS(err_code);
+
+    m_adv_handle = adv_handle;
+    m_start_level = level_find(TX_POWER_CONN_START_DBM);
+
+    return sd_ble_gap_tx_power_set(BLE_GAP_TX_POWER_ROLE_ADV, m_adv_handle, m_stats.adv_dbm);
+}
+
+/**
+ * @brief 修改广播发射功率，立即生效，同时更新广播数据中的发射功率字段。
+ *
+ * @retval NRF_ERROR_INVALID_PARAM 芯片不支持该发射功率。
+ */
+ret_code_t tx_power_adv_set(int8_t dbm)
+{
+    if (level_find(dbm) == ARRAY_SIZE(m_levels))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    ret_code_t err_code = sd_ble_gap_tx_power_set(BLE_GAP_TX_POWER_ROLE_ADV, m_adv_handle, dbm);
+    VERIFY_SUCCESS(err_code);
+
+    m_stats.adv_dbm = dbm;
+
+    return ble_base_adv_data_refresh();
+}
+
+int8_t tx_power_adv_get(void)
+{
+    return m_stats.adv_dbm;
+}
+
+void tx_power_stats_get(tx_power_stats_t *p_stats)
+{
+    *p_stats = m_stats;
+}
@@ -0,0 +1,33 @@
+#ifndef TX_POWER_H
+#define TX_POWER_H
+
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#ifndef TX_POWER_BLE_OBSERVER_PRIO
+#define TX_POWER_BLE_OBSERVER_PRIO 3 /**< 发射功率模块的BLE观察者优先级，需要在PHY策略模块更新平均RSSI之后。 */
+#endif
+
+#define TX_POWER_ADV_DEFAULT_DBM 0 /**< 默认的广播发射功率（dBm）。 */
+#define TX_POWER_CONN_START_DBM 0  /**< 连接建立时的发射功率（dBm）。 */
+#define TX_POWER_PEER_DBM 0        /**< 假定的主机发射功率（dBm），S132不能获取对端的发射功率。 */
+#define TX_POWER_PEER_RSSI_MIN -70 /**< 估计的主机接收信号低于该值时提高一级发射功率（dBm）。 */
+#define TX_POWER_MARGIN_DB 10      /**< 降低一级之后估计的主机接收信号仍高于最小值加该余量时才降低（dB）。 */
+#define TX_POWER_DWELL_MS 2000     /**< 两次调整之间的最短间隔（毫秒）。 */
+
+typedef struct
+{
+    int8_t   adv_dbm;     /**< 当前广播发射功率。 */
+    int8_t   conn_dbm;    /**< 当前连接发射功率，没有连接时为0。 */
+    uint16_t steps_down;  /**< 降低发射功率的次数。 */
+    uint16_t steps_up;    /**< 提高发射功率的次数。 */
+    uint16_t link_losses; /**< 连接超时断开的次数，之后的连接从最大功率开始。 */
+} tx_power_stats_t;
+
+ret_code_t tx_power_adv_init(uint8_t adv_handle);
+ret_code_t tx_power_adv_set(int8_t dbm);
+int8_t     tx_power_adv_get(void);
+void       tx_power_stats_get(tx_power_stats_t *p_stats);
+
+#endif
@@ -1,3 +1,5 @@
+#include <stdint.h>
+
 #include "nrf_log.h"
 
 /** @brief Check if the error code is equal to NRF_SUCCESS. If it is not, return the error code.
@@ -19,3 +21,27 @@
             return;                                                                                                                                            \
         }                                                                                                                                                      \
     } while (0)
+
+
+/** @brief Encode a 64-bit value in little-endian order, return the number of bytes written.
+ */
+static inline uint8_t uint64_le_encode(uint64_t value, uint8_t *p_encoded_data)
+{
+    for (uint8_t i = 0; i < sizeof(value); i++)
+    {
+        p_encoded_data[i] = (uint8_t)(value >> (8 * i));
+    }
+    return sizeof(value);
+}
+
+/** @brief Decode a little-endian 64-bit value.
+ */
+static inline uint64_t uint64_le_decode(uint8_t const *p_encoded_data)
+{
+    uint64_t value = 0;
+    for (uint8_t i = 0; i < sizeof(value); i++)
+    {
+        value |= (uint64_t)p_encoded_data[i] << (8 * i);
+    }
+    return value;
+}
\ No newline at end of file